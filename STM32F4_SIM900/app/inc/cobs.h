@@ -0,0 +1,45 @@
+/**
+ * @file:   cobs.h
+ * @brief:  Consistent Overhead Byte Stuffing.
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ * @details COBS removes all zeros from data at the cost of at most
+ * one byte per 254 bytes, so a zero byte can be used as an
+ * unambiguous frame delimiter.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef COBS_H_
+#define COBS_H_
+
+#include <inttypes.h>
+
+/**
+ * @defgroup  COBS COBS
+ * @brief     Consistent Overhead Byte Stuffing.
+ */
+
+/**
+ * @addtogroup COBS
+ * @{
+ */
+
+#define COBS_MAX_ENCODED(len) ((len) + (len) / 254 + 1) ///< Maximum encoded length
+
+uint16_t COBS_Encode (const uint8_t* src, uint16_t len, uint8_t* dst);
+uint16_t COBS_Decode (const uint8_t* src, uint16_t len, uint8_t* dst);
+
+/**
+ * @}
+ */
+
+#endif /* COBS_H_ */
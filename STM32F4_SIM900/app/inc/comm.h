@@ -19,10 +19,93 @@
 #define COMM_H_
 
 #include <inttypes.h>
+#include <fifo.h>
+#include <instance_hal.h>
+
+#define COMM_FRAME_LEN 255 ///< Maximum frame length (with terminator)
+#define COMM_MAX_ARGS  4   ///< Maximum number of command arguments
+#define COMM_PACKET_LEN (COMM_FRAME_LEN - 6) ///< Maximum packet payload (COBS, sequence, type and CRC take the rest)
+
+/**
+ * @brief Protocol modes.
+ */
+typedef enum {
+  COMM_MODE_TEXT,   ///< CR terminated text frames
+  COMM_MODE_BINARY, ///< COBS encoded packets with CRC
+} COMM_Mode_TypeDef;
+
+/**
+ * @brief State of the module (see instance_hal.h).
+ */
+typedef struct COMM_Context COMM_Context_TypeDef;
+
+/**
+ * @brief Packet types (binary mode).
+ */
+typedef enum {
+  COMM_PACKET_COMMAND   = 0x01, ///< Command, same as in text mode (PC -> device)
+  COMM_PACKET_TEXT      = 0x02, ///< Text output, e.g. printf (device -> PC)
+  COMM_PACKET_TEXT_MODE = 0x03, ///< Return to text mode (PC -> device)
+  COMM_PACKET_LOG       = 0x04, ///< Deferred log records, see log.h (device -> PC)
+  COMM_PACKET_TRACE     = 0x05, ///< Captured UART traffic, see trace.h (device -> PC)
+} COMM_Packet_TypeDef;
+
+/**
+ * @brief Parsed command argument.
+ */
+typedef union {
+  int32_t     i; ///< Integer argument ('i')
+  const char* s; ///< String ('s') or phone number ('p') argument
+} COMM_Arg_TypeDef;
+
+/**
+ * @brief Command table entry.
+ */
+typedef struct {
+  const char* name;  ///< Command name (without ':')
+  const char* args;  ///< Argument types: i - integer, s - string, p - phone number
+  void (*handler)(COMM_Arg_TypeDef* argv); ///< Gets parsed arguments
+} COMM_Command_TypeDef;
+
+/**
+ * @brief Registers a command sent from PC as ":name arg1 arg2...".
+ *
+ * @details Can be used in any source file, e.g.
+ * COMM_COMMAND(LED0, "s", handler) for ":LED0 ON". Each entry gets
+ * its own section and the linker script places them sorted by
+ * name (see sections.ld), so the table is sorted at build time.
+ *
+ * @param cmd Command name (identifier)
+ * @param types Argument types (string of 'i', 's', 'p')
+ * @param fun Handler
+ */
+#define COMM_COMMAND(cmd, types, fun)                                     \
+  static const COMM_Command_TypeDef COMM_Command_##cmd                     \
+  __attribute__((section(".comm_cmd." #cmd), used, aligned(4))) =         \
+  {#cmd, types, fun}
+
 
 void    COMM_Init(uint32_t baud);
-void    COMM_Putc(uint8_t c);
+uint8_t COMM_Putc(uint8_t c);
+uint16_t COMM_Write(const uint8_t* buf, uint16_t len);
+uint16_t COMM_TxSpace(void);
+void    COMM_SetTxPolicy(FIFO_Policy_TypeDef policy, uint32_t timeout);
 uint8_t COMM_Getc(void);
 uint8_t COMM_GetFrame(uint8_t* buf, uint8_t* len);
+uint8_t COMM_FramePending(void);
+void    COMM_SetFrameCallback(void (*callback)(void));
+uint8_t COMM_Dispatch(char* frame);
+void    COMM_SetMode(COMM_Mode_TypeDef newMode);
+COMM_Mode_TypeDef COMM_GetMode(void);
+uint8_t COMM_GetPacket(uint8_t* type, uint8_t* buf, uint8_t* len);
+uint8_t COMM_PutPacket(uint8_t type, const uint8_t* payload, uint8_t len);
+#if FIFO_STATS
+void    COMM_GetStats(FIFO_Stats_TypeDef* rx, FIFO_Stats_TypeDef* tx);
+#endif
+#if INSTANCE_CONTEXTS
+uint32_t COMM_ContextSize(void);
+void    COMM_ContextInit(COMM_Context_TypeDef* context);
+void    COMM_SetContext(COMM_Context_TypeDef* context);
+#endif
 
 #endif /* COMM_H_ */
@@ -0,0 +1,55 @@
+/**
+ * @file:   crc.h
+ * @brief:  CRC-32 calculation.
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ * @details CRC-32/MPEG-2 (polynomial 0x04c11db7, initial value
+ * 0xffffffff, no reflection, no final XOR) - the CRC calculated by
+ * the STM32 CRC unit. Data can be processed in parts:
+ * @verbatim
+ * uint32_t crc = CRC_Start();
+ * crc = CRC_Update(crc, part1, len1);
+ * crc = CRC_Update(crc, part2, len2);
+ * crc = CRC_Finish(crc);
+ * @endverbatim
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include <inttypes.h>
+
+/**
+ * @defgroup  CRC CRC
+ * @brief     CRC-32 calculation.
+ */
+
+/**
+ * @addtogroup CRC
+ * @{
+ */
+
+#define CRC_CHECK 0x0376e6e7 ///< CRC of "123456789"
+
+void     CRC_Init       (void);
+uint32_t CRC_Start      (void);
+uint32_t CRC_Update     (uint32_t crc, const void* data, uint32_t len);
+uint32_t CRC_SoftUpdate (uint32_t crc, const void* data, uint32_t len);
+uint32_t CRC_Finish     (uint32_t crc);
+uint32_t CRC_Calc       (const void* data, uint32_t len);
+
+/**
+ * @}
+ */
+
+#endif /* CRC_H_ */
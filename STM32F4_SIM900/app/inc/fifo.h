@@ -30,21 +30,192 @@
  * @{
  */
 
+#ifndef FIFO_STATS
+  #define FIFO_STATS 1 ///< Nonzero compiles in the FIFO statistics counters
+#endif
+
+#if FIFO_STATS
+/**
+ * @brief FIFO statistics typedef.
+ *
+ * @details Every counter has a single writer: the popped count
+ * belongs to the consumer, the rest to the producer.
+ */
+typedef struct {
+  uint32_t pushed;    ///< Total number of bytes pushed
+  uint32_t popped;    ///< Total number of bytes popped
+  uint32_t dropped;   ///< Bytes lost because FIFO was full
+  uint32_t overflows; ///< Number of pushes that hit a full FIFO
+  uint16_t highWater; ///< Maximum number of bytes held at once
+} FIFO_Stats_TypeDef;
+#endif
+
 /**
  * @brief FIFO structure typedef.
+ *
+ * @details The FIFO is a single-producer/single-consumer ring.
+ * Head is written only by the producer and tail only by the consumer,
+ * so one side may run in an ISR and the other in the main loop
+ * without disabling interrupts. Both indices run freely and are
+ * masked with (len - 1) on access, so len has to be a power of two
+ * (at most 32768).
  */
 typedef struct {
-  uint16_t head;   ///< Head
-  uint16_t tail;   ///< Tail
-  uint8_t* buf;    ///< Pointer to buffer
-  uint16_t len;    ///< Maximum length of FIFO
-  uint16_t count;  ///< Current number of data elements
+  volatile uint16_t head;   ///< Head (write index, owned by producer)
+  volatile uint16_t tail;   ///< Tail (read index, owned by consumer)
+  uint8_t* buf;             ///< Pointer to buffer
+  uint16_t len;             ///< Maximum length of FIFO (power of two)
+#if FIFO_STATS
+  FIFO_Stats_TypeDef stats; ///< Statistics counters
+#endif
 } FIFO_TypeDef;
 
+/**
+ * @brief Orders buffer accesses against index updates.
+ * @details The producer has to store the data before publishing the
+ * new head and the consumer has to read the data before releasing
+ * the slot with the new tail.
+ */
+#define FIFO_BARRIER() __sync_synchronize()
+
+/**
+ * @brief What to do when data doesn't fit in a FIFO.
+ */
+typedef enum {
+  FIFO_POLICY_DROP_NEWEST, ///< Put as much as fits, drop the rest
+  FIFO_POLICY_DROP_OLDEST, ///< Drop oldest data to make space
+  FIFO_POLICY_BLOCK,       ///< Wait for space (with timeout)
+  FIFO_POLICY_ERROR,       ///< Put nothing if all data doesn't fit
+} FIFO_Policy_TypeDef;
+
+#if FIFO_STATS
+/**
+ * @brief Updates producer statistics after a push.
+ * @param fifo Pointer to FIFO structure
+ * @param pushed Number of elements pushed
+ * @param dropped Number of elements which didn't fit
+ */
+static inline void FIFO_PushStats(FIFO_TypeDef* fifo, uint16_t pushed,
+    uint16_t dropped) {
+
+  fifo->stats.pushed += pushed;
+
+  if (dropped) {
+    fifo->stats.dropped += dropped;
+    fifo->stats.overflows++;
+  }
+
+  // Consumer can only make it smaller, so this is the real peak
+  uint16_t count = fifo->head - fifo->tail;
+
+  if (count > fifo->stats.highWater) {
+    fifo->stats.highWater = count;
+  }
+}
+/**
+ * @brief Updates consumer statistics after a pop.
+ * @param fifo Pointer to FIFO structure
+ * @param popped Number of elements popped
+ */
+static inline void FIFO_PopStats(FIFO_TypeDef* fifo, uint16_t popped) {
+  fifo->stats.popped += popped;
+}
+#else
+  #define FIFO_PushStats(fifo, pushed, dropped) (void)0
+  #define FIFO_PopStats(fifo, popped) (void)0
+#endif
+
+/**
+ * @brief Defines a FIFO type with a fixed element type and size.
+ *
+ * @details Generates the name##_TypeDef structure holding the FIFO
+ * header and its storage, together with inline functions
+ * name##_Init, name##_Push, name##_Pop and name##_Count.
+ * As the size is a compile time constant, the index mask
+ * is folded into the generated code. Instances are usually
+ * static and initialized with FIFO_INIT:
+ *
+ * @code
+ * FIFO_DEFINE(EVENT_Fifo, EVENT_TypeDef, 16)
+ * static EVENT_Fifo_TypeDef events = FIFO_INIT(events);
+ * @endcode
+ *
+ * Elements can be of any type. The generic FIFO_* functions
+ * work on the embedded header (&var.fifo), but only for
+ * uint8_t instances.
+ *
+ * @param name Name prefix of the generated type and functions
+ * @param type Element type
+ * @param size Number of elements (power of two, at most 32768)
+ */
+#define FIFO_DEFINE(name, type, size)                                         \
+                                                                              \
+_Static_assert(((size) & ((size) - 1)) == 0 && (size) <= 0x8000,              \
+    #name " size has to be a power of two");                                  \
+                                                                              \
+typedef struct {                                                              \
+  FIFO_TypeDef fifo;      /* Header - indices and statistics */               \
+  type storage[(size)];   /* Elements */                                      \
+} name##_TypeDef;                                                             \
+                                                                              \
+static inline void name##_Init(name##_TypeDef* f) {                           \
+  f->fifo.buf = (uint8_t*)f->storage;                                         \
+  f->fifo.len = (size);                                                       \
+  FIFO_Add(&f->fifo);                                                         \
+}                                                                             \
+                                                                              \
+static inline uint8_t name##_Push(name##_TypeDef* f, type e) {                \
+  uint16_t head = f->fifo.head;                                               \
+  if ((uint16_t)(head - f->fifo.tail) == (size)) {                            \
+    FIFO_PushStats(&f->fifo, 0, 1);                                           \
+    return 1;                                                                 \
+  }                                                                           \
+  f->storage[head & ((size) - 1)] = e;                                        \
+  FIFO_BARRIER();                                                             \
+  f->fifo.head = head + 1;                                                    \
+  FIFO_PushStats(&f->fifo, 1, 0);                                             \
+  return 0;                                                                   \
+}                                                                             \
+                                                                              \
+static inline uint8_t name##_Pop(name##_TypeDef* f, type* e) {                \
+  uint16_t tail = f->fifo.tail;                                               \
+  if (f->fifo.head == tail) {                                                 \
+    return 1;                                                                 \
+  }                                                                           \
+  FIFO_BARRIER();                                                             \
+  *e = f->storage[tail & ((size) - 1)];                                       \
+  FIFO_BARRIER();                                                             \
+  f->fifo.tail = tail + 1;                                                    \
+  FIFO_PopStats(&f->fifo, 1);                                                 \
+  return 0;                                                                   \
+}                                                                             \
+                                                                              \
+static inline uint16_t name##_Count(name##_TypeDef* f) {                      \
+  return (uint16_t)(f->fifo.head - f->fifo.tail);                             \
+}
+
+/**
+ * @brief Static initializer for FIFOs generated with FIFO_DEFINE.
+ * @param var The FIFO variable being initialized
+ */
+#define FIFO_INIT(var) { .fifo = {                                            \
+  .buf = (uint8_t*)(var).storage,                                             \
+  .len = sizeof((var).storage) / sizeof((var).storage[0]) } }
+
 uint8_t FIFO_Add      (FIFO_TypeDef* fifo);
 uint8_t FIFO_Push     (FIFO_TypeDef* fifo, uint8_t c);
 uint8_t FIFO_Pop      (FIFO_TypeDef* fifo, uint8_t* c);
 uint8_t FIFO_IsEmpty  (FIFO_TypeDef* fifo);
+uint16_t FIFO_PushBlock (FIFO_TypeDef* fifo, const uint8_t* data, uint16_t len);
+uint16_t FIFO_PopBlock  (FIFO_TypeDef* fifo, uint8_t* data, uint16_t len);
+uint16_t FIFO_Find      (FIFO_TypeDef* fifo, uint8_t c);
+uint16_t FIFO_PeekContiguous (FIFO_TypeDef* fifo, uint8_t** data);
+void     FIFO_Consume        (FIFO_TypeDef* fifo, uint16_t len);
+uint16_t FIFO_Space          (FIFO_TypeDef* fifo);
+uint16_t FIFO_DropOldest     (FIFO_TypeDef* fifo, uint16_t skip, uint16_t len);
+#if FIFO_STATS
+void     FIFO_GetStats       (FIFO_TypeDef* fifo, FIFO_Stats_TypeDef* stats);
+#endif
 
 /**
  * @}
@@ -38,5 +38,7 @@ typedef enum {
 
 void KEYS_Init(void);
 uint8_t KEYS_Update(void);
+uint8_t KEYS_IsIdle(void);
+void KEYS_Sleep(void (*wakeupCallback)(void));
 
 #endif /* KEYS_H_ */
@@ -0,0 +1,179 @@
+/**
+ * @file:   log.h
+ * @brief:  Deferred formatting log
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details Log calls don't format anything on the target. A record
+ * holds only the ID of the format string (its offset in the log_fmt
+ * section, which isn't loaded to flash), a timestamp and the raw
+ * arguments. Records are put in a RAM ring, which is sent to the PC
+ * as COMM_PACKET_LOG packets by LOG_Flush. The text is rebuilt from
+ * the ELF file by tools/log_decode.py.
+ *
+ * Arguments are stored as 32 bits (floats as their bit pattern),
+ * strings (char*) are copied into the record, up to LOG_MAX_STR bytes.
+ * Calls above LOG_LEVEL are removed at compile time.
+ *
+ * LOG_DEBUG_HEX writes a buffer, which is printed in hex after the text
+ * (the record holds the buffer length and up to LOG_MAX_HEX bytes).
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+/**
+ * @defgroup  LOG LOG
+ * @brief     Deferred formatting log
+ */
+
+/**
+ * @addtogroup LOG
+ * @{
+ */
+
+#define LOG_LEVEL_NONE  0 ///< Logging disabled
+#define LOG_LEVEL_ERROR 1 ///< Errors only
+#define LOG_LEVEL_WARN  2 ///< Errors and warnings
+#define LOG_LEVEL_INFO  3 ///< Normal messages
+#define LOG_LEVEL_DEBUG 4 ///< Everything
+
+#ifndef LOG_LEVEL
+  #define LOG_LEVEL LOG_LEVEL_INFO ///< Calls above this level are compiled out
+#endif
+
+#ifndef LOG_DEFERRED
+  #define LOG_DEFERRED 1 ///< Nonzero - binary records, zero - plain printf (terminal without decoder)
+#endif
+
+#define LOG_MAX_ARGS   6   ///< Maximum number of arguments of a log call
+#define LOG_MAX_STR    32  ///< Maximum length of a string argument
+#define LOG_MAX_RECORD 128 ///< Maximum length of a record
+#define LOG_HEADER_LEN 8   ///< Record header: ID, length, level/argc, timestamp
+#define LOG_ID_DROPPED 0xffff ///< ID of record with number of lost records
+#define LOG_ARGC_HEX   0x0f  ///< Number of arguments field of a hex dump record
+/// Maximum number of bytes in a hex dump record (longer buffers are cut)
+#define LOG_MAX_HEX    (LOG_MAX_RECORD - LOG_HEADER_LEN - 4)
+
+/**
+ * @brief Log call argument.
+ */
+typedef struct {
+  uint32_t    value; ///< Integer value (unused for strings)
+  const char* str;   ///< String to copy (0 for other types)
+} LOG_Arg_TypeDef;
+
+static inline LOG_Arg_TypeDef LOG_ArgInt(uint32_t value) {
+  return (LOG_Arg_TypeDef){value, 0};
+}
+static inline LOG_Arg_TypeDef LOG_ArgPtr(const void* ptr) {
+  return (LOG_Arg_TypeDef){(uint32_t)(uintptr_t)ptr, 0};
+}
+static inline LOG_Arg_TypeDef LOG_ArgFloat(float value) {
+  union {float f; uint32_t u;} bits = {value};
+  return (LOG_Arg_TypeDef){bits.u, 0};
+}
+static inline LOG_Arg_TypeDef LOG_ArgStr(const char* str) {
+  return (LOG_Arg_TypeDef){0, str ? str : "(null)"};
+}
+
+/**
+ * @brief Converts a log call argument depending on its type.
+ */
+#define LOG_ARG(x) , _Generic((x),                                           \
+    char*:          LOG_ArgStr,                                              \
+    const char*:    LOG_ArgStr,                                              \
+    float:          LOG_ArgFloat,                                            \
+    double:         LOG_ArgFloat,                                            \
+    void*:          LOG_ArgPtr,                                              \
+    const void*:    LOG_ArgPtr,                                              \
+    uint8_t*:       LOG_ArgPtr,                                              \
+    const uint8_t*: LOG_ArgPtr,                                              \
+    default:        LOG_ArgInt)(x)
+
+#define LOG_ARGS_0(m)
+#define LOG_ARGS_1(m, a) m(a)
+#define LOG_ARGS_2(m, a, b) m(a) m(b)
+#define LOG_ARGS_3(m, a, b, c) m(a) m(b) m(c)
+#define LOG_ARGS_4(m, a, b, c, d) m(a) m(b) m(c) m(d)
+#define LOG_ARGS_5(m, a, b, c, d, e) m(a) m(b) m(c) m(d) m(e)
+#define LOG_ARGS_6(m, a, b, c, d, e, f) m(a) m(b) m(c) m(d) m(e) m(f)
+#define LOG_ARGS_N(_0, _1, _2, _3, _4, _5, _6, n, ...) LOG_ARGS_##n
+/**
+ * @brief Applies macro m to each argument (at most LOG_MAX_ARGS).
+ */
+#define LOG_ARGS(m, args...)                                                 \
+  LOG_ARGS_N(0, ##args, 6, 5, 4, 3, 2, 1, 0)(m, ##args)
+
+#if LOG_DEFERRED
+/**
+ * @brief Writes a record. The format string goes to the log_fmt
+ * section, only its offset is written.
+ */
+#define LOG_RECORD(level, fmt, args...) do {                                  \
+    static const char LOG_fmt[] __attribute__((section("log_fmt"))) = fmt;    \
+    const LOG_Arg_TypeDef LOG_argv[] = {{0, 0} LOG_ARGS(LOG_ARG, ##args)};    \
+    LOG_Write(level, LOG_fmt, &LOG_argv[1],                                   \
+        sizeof(LOG_argv) / sizeof(LOG_argv[0]) - 1);                          \
+  } while (0)
+/**
+ * @brief Writes a hex dump record.
+ */
+#define LOG_RECORD_HEX(level, fmt, buf, len) do {                             \
+    static const char LOG_fmt[] __attribute__((section("log_fmt"))) = fmt;    \
+    LOG_WriteHex(level, LOG_fmt, buf, len);                                   \
+  } while (0)
+#else
+#define LOG_RECORD(level, fmt, args...) printf(fmt "\r\n", ##args)
+#define LOG_RECORD_HEX(level, fmt, buf, len) LOG_PrintHex(fmt, buf, len)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+  #define LOG_ERROR(fmt, args...) LOG_RECORD(LOG_LEVEL_ERROR, fmt, ##args)
+#else
+  #define LOG_ERROR(fmt, args...) (void)0
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+  #define LOG_WARN(fmt, args...) LOG_RECORD(LOG_LEVEL_WARN, fmt, ##args)
+#else
+  #define LOG_WARN(fmt, args...) (void)0
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+  #define LOG_INFO(fmt, args...) LOG_RECORD(LOG_LEVEL_INFO, fmt, ##args)
+#else
+  #define LOG_INFO(fmt, args...) (void)0
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  #define LOG_DEBUG(fmt, args...) LOG_RECORD(LOG_LEVEL_DEBUG, fmt, ##args)
+  #define LOG_DEBUG_HEX(fmt, buf, len) LOG_RECORD_HEX(LOG_LEVEL_DEBUG, fmt, buf, len)
+#else
+  #define LOG_DEBUG(fmt, args...) (void)0
+  #define LOG_DEBUG_HEX(fmt, buf, len) (void)0
+#endif
+
+void     LOG_Write        (uint8_t level, const char* fmt, const LOG_Arg_TypeDef* argv, uint8_t argc);
+void     LOG_WriteHex     (uint8_t level, const char* fmt, const uint8_t* buf, uint16_t len);
+void     LOG_PrintHex     (const char* fmt, const uint8_t* buf, uint16_t len);
+uint8_t  LOG_Flush        (void);
+uint8_t  LOG_Pending      (void);
+void     LOG_SetCallback  (void (*callback)(void));
+uint32_t LOG_GetDropped   (void);
+
+/**
+ * @}
+ */
+
+#endif /* LOG_H_ */
@@ -0,0 +1,48 @@
+/**
+ * @file:   scheduler.h
+ * @brief:  Cooperative event-driven scheduler.
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ * @details Tasks run to completion in the main loop, only when
+ * an event was posted for them. Events can be posted from interrupts.
+ * Each task has a unique priority, which is also its ID - when
+ * several tasks are pending, the one with the lowest number runs first.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <inttypes.h>
+
+/**
+ * @defgroup  SCHED SCHED
+ * @brief     Cooperative event-driven scheduler.
+ */
+
+/**
+ * @addtogroup SCHED
+ * @{
+ */
+
+#define SCHED_MAX_TASKS 32 ///< Maximum number of tasks (bits in pending mask)
+
+uint8_t SCHED_AddTask (uint8_t prio, void (*task)(void));
+void    SCHED_Post    (uint8_t prio);
+uint8_t SCHED_Pending (void);
+void    SCHED_Run     (void);
+
+/**
+ * @}
+ */
+
+#endif /* SCHEDULER_H_ */
@@ -19,9 +19,49 @@
 #define INC_SIM900_H_
 
 #include <inttypes.h>
+#include <fifo.h>
+#include <instance_hal.h>
+
+#define SIM900_FRAME_LEN 255 ///< Maximum frame length (with terminator)
+
+/**
+ * @brief Final results of AT commands (flags).
+ */
+typedef enum {
+  SIM900_RESULT_OK      = 0x01, ///< OK
+  SIM900_RESULT_ERROR   = 0x02, ///< ERROR
+  SIM900_RESULT_CME     = 0x04, ///< +CME ERROR or +CMS ERROR
+  SIM900_RESULT_PROMPT  = 0x08, ///< "> " prompt - modem waits for data
+  SIM900_RESULT_TIMEOUT = 0x10, ///< No result in time
+} SIM900_Result_TypeDef;
+
+/**
+ * @brief State of the module (see instance_hal.h).
+ */
+typedef struct SIM900_Context SIM900_Context_TypeDef;
 
 void SIM900_Init(uint32_t baud);
 uint8_t SIM900_GetFrame(uint8_t* buf, uint8_t* len);
-void SIM900_PutFrame(char* buf);
+uint8_t SIM900_FramePending(void);
+void    SIM900_SetFrameCallback(void (*callback)(void));
+uint16_t SIM900_PutFrame(char* buf);
+uint8_t  SIM900_Putc(uint8_t c);
+uint16_t SIM900_Write(const uint8_t* buf, uint16_t len);
+void     SIM900_SetTxPolicy(FIFO_Policy_TypeDef policy, uint32_t timeout);
+uint8_t SIM900_SendCommand(const char* cmd, uint8_t expect, uint32_t timeout,
+    void (*callback)(uint8_t result, void* ctx), void* ctx);
+uint8_t SIM900_SendCommandData(const char* cmd, const char* data,
+    uint8_t expect, uint32_t timeout,
+    void (*callback)(uint8_t result, void* ctx), void* ctx);
+void SIM900_SetLineCallback(void (*callback)(char* line, uint8_t len));
+void SIM900_Update(void);
+#if FIFO_STATS
+void SIM900_GetStats(FIFO_Stats_TypeDef* rx, FIFO_Stats_TypeDef* tx);
+#endif
+#if INSTANCE_CONTEXTS
+uint32_t SIM900_ContextSize(void);
+void SIM900_ContextInit(SIM900_Context_TypeDef* context);
+void SIM900_SetContext(SIM900_Context_TypeDef* context);
+#endif
 
 #endif /* INC_SIM900_H_ */
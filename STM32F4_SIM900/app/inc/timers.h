@@ -22,6 +22,7 @@
 #define TIMERS_H_
 
 #include <inttypes.h>
+#include <instance_hal.h>
 
 /**
  * @defgroup  TIMER TIMER
@@ -33,6 +34,26 @@
  * @{
  */
 
+/**
+ * @brief Soft timer structure.
+ *
+ * @details Allocated by the user (usually statically) and initialized
+ * with TIMER_SoftTimerInit. Fields are managed by the TIMER module.
+ */
+typedef struct TIMER_Soft {
+  struct TIMER_Soft*  next;       ///< Next timer in wheel slot
+  struct TIMER_Soft** pprev;      ///< Pointer to link pointing at this timer (NULL - timer stopped)
+  uint32_t expiry;                ///< System time of next expiry
+  uint32_t period;                ///< Period (0 - one-shot timer)
+  void (*callback)(void* ctx);    ///< Function called on expiry
+  void* ctx;                      ///< Argument for callback
+} TIMER_Soft_TypeDef;
+
+/**
+ * @brief State of the module (see instance_hal.h).
+ */
+typedef struct TIMER_Context TIMER_Context_TypeDef;
+
 void      TIMER_Init              (uint32_t freq);
 void      TIMER_DelayUS           (uint32_t us);
 void      TIMER_Delay             (uint32_t ms);
@@ -41,6 +62,19 @@ int8_t    TIMER_AddSoftTimer      (uint32_t maxVal, void (*fun)(void));
 void      TIMER_StartSoftTimer    (uint8_t id);
 void      TIMER_SoftTimersUpdate  (void);
 uint32_t  TIMER_GetTime           (void);
+uint32_t  TIMER_GetTimeUS         (void);
+void      TIMER_SoftTimerInit     (TIMER_Soft_TypeDef* timer, void (*callback)(void*), void* ctx);
+void      TIMER_SoftTimerStart    (TIMER_Soft_TypeDef* timer, uint32_t delay, uint32_t period);
+void      TIMER_SoftTimerStop     (TIMER_Soft_TypeDef* timer);
+uint8_t   TIMER_SoftTimerIsActive (TIMER_Soft_TypeDef* timer);
+void      TIMER_Idle              (uint8_t (*workPending)(void));
+void      TIMER_SetExpiryCallback (void (*callback)(void));
+void      TIMER_GetIdleStats      (uint32_t* sleeps, uint32_t* ticks);
+#if INSTANCE_CONTEXTS
+uint32_t  TIMER_ContextSize       (void);
+void      TIMER_ContextInit       (TIMER_Context_TypeDef* context);
+void      TIMER_SetContext        (TIMER_Context_TypeDef* context);
+#endif
 /**
  * @}
  */
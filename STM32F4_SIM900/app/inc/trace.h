@@ -0,0 +1,71 @@
+/**
+ * @file:   trace.h
+ * @brief:  Capture of UART traffic
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details Every block received or transmitted on USART2 (PC) and
+ * USART3 (SIM900) is recorded by the UART interrupts (see trace_hal.h)
+ * with a microsecond timestamp. Records are kept in a RAM ring:
+ * - TRACE_MODE_RAM - until the ring is full, TRACE_Send sends it later,
+ * - TRACE_MODE_COMM - sent right away as COMM_PACKET_TRACE packets
+ *   (USART2 TX isn't recorded then - it carries the trace itself).
+ *
+ * Record format: channel (2 high bits) and data length - 1 (6 low
+ * bits), time since previous record in us (unsigned LEB128, the first
+ * record counts from TRACE_Start), data. A trace is the concatenation
+ * of the records (payloads of the packets). The POSIX port replays
+ * traces (hal/posix/src/replay.c), tools/trace_dump.py prints them.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <inttypes.h>
+#include <trace_hal.h>
+
+/**
+ * @defgroup  TRACE TRACE
+ * @brief     Capture of UART traffic
+ */
+
+/**
+ * @addtogroup TRACE
+ * @{
+ */
+
+#define TRACE_MAX_DATA 64 ///< Maximum data length of a record (longer blocks are split)
+#define TRACE_ALL ((1 << TRACE_HAL_CHANNELS) - 1) ///< All channels
+
+/**
+ * @brief Capture mode.
+ */
+typedef enum {
+  TRACE_MODE_OFF,  ///< Nothing is recorded
+  TRACE_MODE_RAM,  ///< Records stay in RAM (until TRACE_Send)
+  TRACE_MODE_COMM, ///< Records are sent to PC right away
+} TRACE_Mode_TypeDef;
+
+void     TRACE_Start      (TRACE_Mode_TypeDef mode, uint8_t channels);
+void     TRACE_Stop       (void);
+void     TRACE_Send       (void);
+uint8_t  TRACE_Flush      (void);
+uint8_t  TRACE_Pending    (void);
+void     TRACE_SetCallback(void (*callback)(void));
+void     TRACE_GetStats   (uint32_t* recorded, uint32_t* dropped);
+
+/**
+ * @}
+ */
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,53 @@
+/**
+ * @file:   urc.h
+ * @brief:  Unsolicited result code dispatcher.
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ * @details Lines received from the modem are matched against a table
+ * of prefixes (e.g. "RING", "+CMTI:") and passed to the handler
+ * of the longest matching prefix. The table is compiled into a trie
+ * once, so matching costs O(length of prefix), whatever the number
+ * of handlers.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef URC_H_
+#define URC_H_
+
+#include <inttypes.h>
+
+/**
+ * @defgroup  URC URC
+ * @brief     Unsolicited result code dispatcher.
+ */
+
+/**
+ * @addtogroup URC
+ * @{
+ */
+
+/**
+ * @brief URC table entry.
+ */
+typedef struct {
+  const char* prefix; ///< Line prefix
+  void (*handler)(const char* args, uint8_t len); ///< Gets the rest of the line
+} URC_Entry_TypeDef;
+
+uint8_t URC_Init     (const URC_Entry_TypeDef* table, uint8_t count);
+uint8_t URC_Dispatch (const char* line, uint8_t len);
+
+/**
+ * @}
+ */
+
+#endif /* URC_H_ */
@@ -25,30 +25,79 @@
 #include <comm.h>
 #include <keys.h>
 #include <sim900.h>
-#include <utils.h>
+#include <scheduler.h>
+#include <urc.h>
+#include <crc.h>
+#include <log.h>
+#include <trace.h>
 
 #define SYSTICK_FREQ 1000 ///< Frequency of the SysTick set at 1kHz.
 #define COMM_BAUD_RATE 115200UL ///< Baud rate for communication with PC
 #define SIM900_BAUD_RATE 115200UL ///< Baud rate for communication with SIM900
 
+#define KEYS_SCAN_PERIOD 5 ///< Keyboard scanning period in ms
+#define LOG_RETRY_PERIOD 10 ///< Log flush retry period when PC link is busy (ms)
+#define TRACE_RETRY_PERIOD 10 ///< Trace flush retry period when PC link is busy (ms)
+
 void softTimerCallback(void);
+static void ledTimerCallback(void* ctx);
+static void keysTimerCallback(void* ctx);
+static void logTimerCallback(void* ctx);
+static void traceTimerCallback(void* ctx);
+static void commTask(void);
+static void sim900Task(void);
+static void logTask(void);
+static void traceTask(void);
+static void keysTask(void);
+static void commFrameCallback(void);
+static void sim900FrameCallback(void);
+static void logCallback(void);
+static void traceCallback(void);
+static void keysWakeupCallback(void);
+static void sim900LineCallback(char* line, uint8_t len);
+static void urcPrint(const char* args, uint8_t len);
+static void urcRing(const char* args, uint8_t len);
+static void urcNewSms(const char* args, uint8_t len);
 
-#define DEBUG
+/**
+ * @brief Handled unsolicited result codes.
+ */
+static const URC_Entry_TypeDef urcTable[] = {
+  {"RING",    urcRing},
+  {"+CLIP:",  urcPrint},
+  {"+CMTI:",  urcNewSms},
+  {"+CREG:",  urcPrint},
+  {"+CPIN:",  urcPrint},
+  {"Call Ready", urcPrint},
+};
+static void timerExpiryCallback(void);
 
-#ifdef DEBUG
-#define print(str, args...) printf(""str"%s",##args,"")
-#define println(str, args...) printf("MAIN--> "str"%s",##args,"\r\n")
-#else
-#define print(str, args...) (void)0
-#define println(str, args...) (void)0
-#endif
+/**
+ * @brief Task priorities (lower number runs first).
+ */
+enum {
+  TASK_SIM900,  ///< Modem lines - shortest latency
+  TASK_COMM,    ///< Commands from PC
+  TASK_TIMERS,  ///< Soft timers
+  TASK_KEYS,    ///< Key pressed - starts scanning the keyboard
+  TASK_LOG,     ///< Sending log records - whenever there is nothing else to do
+  TASK_TRACE,   ///< Sending captured UART traffic
+};
+
+static uint8_t buf[COMM_FRAME_LEN]; ///< Buffer for receiving frames from PC and SIM900
+static TIMER_Soft_TypeDef logTimer; ///< Retries sending log records
+static TIMER_Soft_TypeDef traceTimer; ///< Retries sending trace records
+static TIMER_Soft_TypeDef keysTimer; ///< Scans the keyboard while a key is pressed
 
 
 int main(void) {
 
   COMM_Init(COMM_BAUD_RATE); // initialize communication with PC
+#ifdef TRACE_BOOT_MODE
+  TRACE_Start(TRACE_BOOT_MODE, TRACE_ALL); // capture modem traffic from power up
+#endif
   SIM900_Init(SIM900_BAUD_RATE);
-  println("Starting program"); // Print a string to terminal
+  LOG_INFO("MAIN--> Starting program"); // Print a string to terminal
 
   TIMER_Init(SYSTICK_FREQ); // Initialize timer
 
@@ -65,64 +114,236 @@ int main(void) {
 
   KEYS_Init(); // Initialize matrix keyboard
 
-  uint8_t buf[255]; // buffer for receiving commands from PC
-  uint8_t len;      // length of command
+  CRC_Init(); // Initialize CRC calculation
+
+  // Timers wake up the core from idle sleep, so periodic work runs from them
+  static TIMER_Soft_TypeDef ledTimer;
+  TIMER_SoftTimerInit(&ledTimer, ledTimerCallback, 0);
+  TIMER_SoftTimerStart(&ledTimer, 1000, 1000);
+  TIMER_SoftTimerInit(&keysTimer, keysTimerCallback, 0);
+  TIMER_SoftTimerStart(&keysTimer, KEYS_SCAN_PERIOD, KEYS_SCAN_PERIOD);
+  TIMER_SoftTimerInit(&logTimer, logTimerCallback, 0);
+  TIMER_SoftTimerInit(&traceTimer, traceTimerCallback, 0);
+
+  URC_Init(urcTable, sizeof(urcTable) / sizeof(urcTable[0]));
+  SIM900_SetLineCallback(sim900LineCallback);
+  SIM900_SendCommand("AT\r", SIM900_RESULT_OK, 1000, 0, 0);
 
-  // test another way of measuring time delays
-  uint32_t softTimer = TIMER_GetTime(); // get start time for delay
+  SCHED_AddTask(TASK_SIM900, sim900Task);
+  SCHED_AddTask(TASK_COMM, commTask);
+  SCHED_AddTask(TASK_TIMERS, TIMER_SoftTimersUpdate);
+  SCHED_AddTask(TASK_KEYS, keysTask);
+  SCHED_AddTask(TASK_LOG, logTask);
+  SCHED_AddTask(TASK_TRACE, traceTask);
 
-  SIM900_PutFrame("AT\r\n");
-  TIMER_Delay(100);
+  // interrupts post events for the tasks
+  SIM900_SetFrameCallback(sim900FrameCallback);
+  COMM_SetFrameCallback(commFrameCallback);
+  TIMER_SetExpiryCallback(timerExpiryCallback);
+  LOG_SetCallback(logCallback);
+  TRACE_SetCallback(traceCallback);
 
+  // frames (and log records) could have arrived before callbacks were set
+  SCHED_Post(TASK_SIM900);
+  SCHED_Post(TASK_COMM);
+  SCHED_Post(TASK_LOG);
+  SCHED_Post(TASK_TRACE);
 
   while (1) {
+    SCHED_Run(); // run tasks with pending events
+    TIMER_Idle(SCHED_Pending); // sleep until next timer or interrupt
+  }
+}
 
-    // test delay method
-    if (TIMER_DelayTimer(1000, softTimer)) {
-      LED_Toggle(LED3);
-      softTimer = TIMER_GetTime(); // get start time for delay
-    }
+/**
+ * @brief Handles frames received from PC.
+ */
+static void commTask(void) {
 
-    // check for new frames from PC
-    if (!COMM_GetFrame(buf, &len)) {
-      println("Got frame of length %d: >%s<", (int)len, (char*)buf);
-      hexdump(buf, len);
-      char* tmp = strtok((char*)buf, " "); // get command
-
-      println("Command %s", tmp);
-
-      // control LED0 from terminal
-      if (!strcmp((char*)tmp, ":LED0")) {
-        tmp = strtok(0, " "); // get parameter
-        println("Parameter %s", tmp);
-        if(!strcmp(tmp, "ON")) {
-          LED_ChangeState(LED0, LED_ON);
-        } else if (!strcmp(tmp, "OFF")) {
-          LED_ChangeState(LED0, LED_OFF);
-        }
-      }
-      if (!strcmp((char*)tmp, ":SMS")) {
-        tmp = strtok(0, " "); // get parameter (phone number)
-        println("Parameter %s", tmp);
-        // send SMS
-        SIM900_PutFrame("AT+CMGF=1\r\n");
-        TIMER_Delay(100);
-        SIM900_PutFrame("AT+CMGS=\"+48");
-        SIM900_PutFrame(tmp);
-        SIM900_PutFrame("\"\r\n");
-        TIMER_Delay(100);
-        SIM900_PutFrame("Hello. This is your STM32.\x1a\r\n");
-      }
+  uint8_t len; // length of command
+  uint8_t ret;
+  uint8_t type = COMM_PACKET_COMMAND;
+
+  // handle all frames received from PC (mode can change meanwhile)
+  while (1) {
 
+    if (COMM_GetMode() == COMM_MODE_BINARY) {
+      ret = COMM_GetPacket(&type, buf, &len);
+    } else {
+      ret = COMM_GetFrame(buf, &len);
+      type = COMM_PACKET_COMMAND;
     }
 
-    if (!SIM900_GetFrame(buf, &len)) {
-      println("SIM900: length %d: %s", (int)len, (char*)buf);
-      hexdump(buf, len);
+    if (ret == 1) {
+      break; // no more frames
+    } else if (ret) {
+      continue; // frame with errors - skip it
     }
 
-    TIMER_SoftTimersUpdate(); // run timers
-    KEYS_Update(); // run keyboard
+    if (type == COMM_PACKET_TEXT_MODE) {
+      COMM_SetMode(COMM_MODE_TEXT);
+      LOG_INFO("MAIN--> Text mode");
+      continue;
+    } else if (type != COMM_PACKET_COMMAND) {
+      continue;
+    }
+
+    buf[len] = 0; // packets aren't null terminated
+    LOG_INFO("MAIN--> Got frame of length %d: >%s<", (int)len, (char*)buf);
+    LOG_DEBUG_HEX("MAIN--> Frame:", buf, len);
+
+    COMM_Dispatch((char*)buf); // commands are in commands.c
+  }
+}
+/**
+ * @brief Handles frames received from SIM900.
+ */
+static void sim900Task(void) {
+
+  SIM900_Update();
+}
+/**
+ * @brief Sends log records to PC.
+ */
+static void logTask(void) {
+
+  if (LOG_Flush()) { // PC link busy - try again later
+    TIMER_SoftTimerStart(&logTimer, LOG_RETRY_PERIOD, 0);
+  }
+}
+/**
+ * @brief Sends captured UART traffic to PC.
+ */
+static void traceTask(void) {
+
+  if (TRACE_Flush()) { // PC link busy - try again later
+    TIMER_SoftTimerStart(&traceTimer, TRACE_RETRY_PERIOD, 0);
+  }
+}
+/**
+ * @brief Starts scanning the keyboard after a key press woke it up.
+ */
+static void keysTask(void) {
+
+  if (!TIMER_SoftTimerIsActive(&keysTimer)) {
+    TIMER_SoftTimerStart(&keysTimer, KEYS_SCAN_PERIOD, KEYS_SCAN_PERIOD);
+  }
+}
+/**
+ * @brief Handles lines received from SIM900 (other than command results).
+ */
+static void sim900LineCallback(char* line, uint8_t len) {
+
+  if (!URC_Dispatch(line, len)) {
+    return; // unsolicited result code
+  }
+
+  LOG_INFO("MAIN--> SIM900: length %d: %s", (int)len, line);
+  LOG_DEBUG_HEX("MAIN--> SIM900:", (uint8_t*)line, len);
+}
+/**
+ * @brief Prints unsolicited result code parameters.
+ */
+static void urcPrint(const char* args, uint8_t len) {
+
+  LOG_INFO("MAIN--> URC: %.*s", (int)len, args);
+}
+/**
+ * @brief Incoming call.
+ */
+static void urcRing(const char* args, uint8_t len) {
+
+  LOG_INFO("MAIN--> Incoming call");
+  LED_Toggle(LED2);
+}
+/**
+ * @brief New SMS stored (+CMTI: "SM",index) - reads it.
+ */
+static void urcNewSms(const char* args, uint8_t len) {
+
+  const char* index = memchr(args, ',', len);
+  char cmd[16];
+
+  if (index) {
+    index++;
+    snprintf(cmd, sizeof(cmd), "AT+CMGR=%.*s\r", (int)(args + len - index), index);
+    SIM900_SendCommand(cmd, SIM900_RESULT_OK, 5000, 0, 0);
+  }
+}
+/**
+ * @brief Posts frame event for COMM task (interrupt context).
+ */
+static void commFrameCallback(void) {
+
+  SCHED_Post(TASK_COMM);
+}
+/**
+ * @brief Posts frame event for SIM900 task (interrupt context).
+ */
+static void sim900FrameCallback(void) {
+
+  SCHED_Post(TASK_SIM900);
+}
+/**
+ * @brief Posts log record event (any context).
+ */
+static void logCallback(void) {
+
+  SCHED_Post(TASK_LOG);
+}
+/**
+ * @brief Posts trace record event (interrupt context).
+ */
+static void traceCallback(void) {
+
+  SCHED_Post(TASK_TRACE);
+}
+/**
+ * @brief Posts key press event (interrupt context).
+ */
+static void keysWakeupCallback(void) {
+
+  SCHED_Post(TASK_KEYS);
+}
+/**
+ * @brief Posts timer event (interrupt context).
+ */
+static void timerExpiryCallback(void) {
+
+  SCHED_Post(TASK_TIMERS);
+}
+/**
+ * @brief Toggles LED3 every second.
+ */
+static void ledTimerCallback(void* ctx) {
+
+  LED_Toggle(LED3);
+}
+/**
+ * @brief Retries sending log records.
+ */
+static void logTimerCallback(void* ctx) {
+
+  SCHED_Post(TASK_LOG);
+}
+/**
+ * @brief Retries sending trace records.
+ */
+static void traceTimerCallback(void* ctx) {
+
+  SCHED_Post(TASK_TRACE);
+}
+/**
+ * @brief Scans the keyboard, stops scanning when no key is pressed
+ * (so idle sleep isn't cut to the scan period).
+ */
+static void keysTimerCallback(void* ctx) {
+
+  KEYS_Update();
+
+  if (KEYS_IsIdle()) {
+    TIMER_SoftTimerStop(&keysTimer);
+    KEYS_Sleep(keysWakeupCallback);
   }
 }
 
@@ -0,0 +1,105 @@
+/**
+ * @file:   cobs.c
+ * @brief:  Consistent Overhead Byte Stuffing.
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ * @details COBS removes all zeros from data at the cost of at most
+ * one byte per 254 bytes, so a zero byte can be used as an
+ * unambiguous frame delimiter.
+ *
+ * Data is split into blocks ending with a zero (or with the end of
+ * data, or after 254 non-zero bytes). Each block is sent as a code
+ * byte equal to the block length + 1 followed by the non-zero bytes.
+ * Code 0xff means a block of 254 bytes without the trailing zero.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <cobs.h>
+
+/**
+ * @addtogroup COBS
+ * @{
+ */
+
+/**
+ * @brief Encodes data.
+ * @param src Data
+ * @param len Data length
+ * @param dst Buffer for encoded data (COBS_MAX_ENCODED(len) bytes,
+ * can't overlap src)
+ * @return Encoded length (without the zero delimiter)
+ */
+uint16_t COBS_Encode(const uint8_t* src, uint16_t len, uint8_t* dst) {
+
+  uint16_t out = 1;     // output index
+  uint16_t codePos = 0; // index of code byte of current block
+  uint8_t  code = 1;    // current block length + 1
+
+  for (uint16_t i = 0; i < len; i++) {
+
+    if (src[i] == 0) {
+      dst[codePos] = code; // end block at zero
+      codePos = out++;
+      code = 1;
+    } else {
+      dst[out++] = src[i];
+      if (++code == 0xff) { // maximum block length
+        dst[codePos] = code;
+        codePos = out++;
+        code = 1;
+      }
+    }
+  }
+
+  dst[codePos] = code;
+
+  return out;
+}
+/**
+ * @brief Decodes data.
+ * @param src Encoded data (without the zero delimiter)
+ * @param len Encoded length
+ * @param dst Buffer for decoded data (len bytes, can be the same
+ * as src - data is decoded in place)
+ * @return Decoded length (0 - invalid data)
+ */
+uint16_t COBS_Decode(const uint8_t* src, uint16_t len, uint8_t* dst) {
+
+  uint16_t in = 0;
+  uint16_t out = 0;
+
+  while (in < len) {
+
+    uint8_t code = src[in++];
+
+    if (code == 0 || in + code - 1 > len) {
+      return 0; // zero in data or block past the end
+    }
+
+    for (uint8_t i = 1; i < code; i++) {
+      if (src[in] == 0) {
+        return 0;
+      }
+      dst[out++] = src[in++];
+    }
+
+    if (code != 0xff && in < len) {
+      dst[out++] = 0; // block ended with zero
+    }
+  }
+
+  return out;
+}
+
+/**
+ * @}
+ */
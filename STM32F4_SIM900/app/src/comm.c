@@ -17,21 +17,15 @@
 
 #include <comm.h>
 #include <fifo.h>
+#include <cobs.h>
+#include <timers.h>
 // HAL
 #include <uart2.h>
 #include <stdio.h>
-
-#ifndef DEBUG
-  #define DEBUG
-#endif
-
-#ifdef DEBUG
-  #define print(str, args...) printf("COMM--> "str"%s",##args,"\r")
-  #define println(str, args...) printf("COMM--> "str"%s",##args,"\r\n")
-#else
-  #define print(str, args...) (void)0
-  #define println(str, args...) (void)0
-#endif
+#include <stdlib.h>
+#include <string.h>
+#include <log.h>
+#include <instance_hal.h>
 
 /**
  * @defgroup  COMM COMM
@@ -44,18 +38,69 @@
  */
 
 #define COMM_BUF_LEN     2048    ///< COMM buffer lengths
-#define COMM_TERMINATOR '\r'     ///< COMM frame terminator character
+#define COMM_MAX_FRAMES  16      ///< Maximum number of frames waiting in RX FIFO
+#define COMM_TERMINATOR '\r'     ///< COMM frame terminator character (text mode)
+#define COMM_DELIMITER  0x00     ///< COMM packet delimiter (binary mode)
 
-static uint8_t rxBuffer[COMM_BUF_LEN]; ///< Buffer for received data.
-static uint8_t txBuffer[COMM_BUF_LEN]; ///< Buffer for transmitted data.
+#ifndef COMM_TX_POLICY
+  #define COMM_TX_POLICY  FIFO_POLICY_DROP_NEWEST ///< Default TX FIFO back-pressure policy
+#endif
+#define COMM_TX_TIMEOUT 10 ///< Default TX waiting time in ms (FIFO_POLICY_BLOCK)
 
-static FIFO_TypeDef rxFifo; ///< RX FIFO
-static FIFO_TypeDef txFifo; ///< TX FIFO
+#ifndef COMM_USE_TX_DMA
+  #define COMM_USE_TX_DMA 1 ///< Nonzero sends data using DMA (if HAL supports it)
+#endif
 
-static uint8_t gotFrame;  ///< Nonzero signals a new frame (number of received frames)
+FIFO_DEFINE(COMM_Fifo, uint8_t, COMM_BUF_LEN)
+
+/**
+ * @brief Descriptor of a frame received in RX FIFO.
+ */
+typedef struct {
+  uint16_t start; ///< RX FIFO index of the first byte of frame
+  uint16_t len;   ///< Frame length (with terminator)
+  uint8_t  error; ///< Nonzero if part of the frame was lost
+} COMM_Frame_TypeDef;
+
+FIFO_DEFINE(COMM_FrameFifo, COMM_Frame_TypeDef, COMM_MAX_FRAMES)
+
+/**
+ * @brief State of the module (one per instance of the application).
+ */
+struct COMM_Context {
+  COMM_Fifo_TypeDef rxFifo;        ///< RX FIFO
+  COMM_Fifo_TypeDef txFifo;        ///< TX FIFO
+  COMM_FrameFifo_TypeDef rxFrames; ///< Received frames
+  uint16_t frameStart; ///< RX FIFO index where current frame started (ISR only)
+  uint8_t  frameError; ///< Nonzero if current frame lost data (ISR only)
+  void (*frameCallback)(void); ///< Function called when a frame is received
+  volatile uint8_t terminator; ///< Current frame terminator
+  COMM_Mode_TypeDef mode;      ///< Current protocol mode
+  FIFO_Policy_TypeDef txPolicy; ///< What to do when TX FIFO is full
+  uint32_t txTimeout;          ///< Waiting time for FIFO_POLICY_BLOCK
+  uint8_t rxSeq;               ///< Expected sequence number of next packet
+  uint8_t txSeq;               ///< Sequence number of next sent packet
+};
+
+/**
+ * @brief Context of the board - statically initialized, so the
+ * FIFOs are ready before the interrupts are enabled.
+ */
+static COMM_Context_TypeDef commDefault = {
+  .rxFifo     = FIFO_INIT(commDefault.rxFifo),
+  .txFifo     = FIFO_INIT(commDefault.txFifo),
+  .rxFrames   = FIFO_INIT(commDefault.rxFrames),
+  .terminator = COMM_TERMINATOR,
+  .txPolicy   = COMM_TX_POLICY,
+  .txTimeout  = COMM_TX_TIMEOUT,
+};
+
+INSTANCE_POINTER(COMM_Context_TypeDef, comm, &commDefault); ///< Current instance
 
 uint8_t COMM_TxCallback(uint8_t* c);
 void    COMM_RxCallback(uint8_t c);
+uint16_t COMM_TxPeekCallback(uint8_t** data);
+void     COMM_TxDoneCallback(uint16_t len);
 
 /**
  * @brief Initialize communication terminal interface.
@@ -69,34 +114,359 @@ void COMM_Init(uint32_t baud) {
   // transmitted data
   COMM_HAL_Init(baud, COMM_RxCallback, COMM_TxCallback);
 
-  // Initialize RX FIFO
-  rxFifo.buf = rxBuffer;
-  rxFifo.len = COMM_BUF_LEN;
-  FIFO_Add(&rxFifo);
+#if COMM_USE_TX_DMA && defined(COMM_HAL_TX_DMA)
+  // send whole contiguous blocks of TX FIFO using DMA
+  COMM_HAL_TxDmaInit(COMM_TxPeekCallback, COMM_TxDoneCallback);
+#endif
+
+  // FIFOs of the default context are statically initialized,
+  // so they are ready before the interrupts are enabled
 
-  // Initialize TX FIFO
-  txFifo.buf = txBuffer;
-  txFifo.len = COMM_BUF_LEN;
-  FIFO_Add(&txFifo);
+}
+
+#if INSTANCE_CONTEXTS
+/**
+ * @brief Returns the size of a context, for allocating it.
+ * @return Size in bytes
+ */
+uint32_t COMM_ContextSize(void) {
 
+  return sizeof(COMM_Context_TypeDef);
 }
+/**
+ * @brief Initializes a context of another instance.
+ * @details The context starts in text mode with the default TX policy.
+ * The HAL isn't initialized - the instance exchanges data through
+ * the RX and TX callbacks.
+ * @param context Context (COMM_ContextSize bytes)
+ */
+void COMM_ContextInit(COMM_Context_TypeDef* context) {
+
+  memset(context, 0, sizeof(*context));
 
+  COMM_Fifo_Init(&context->rxFifo);
+  COMM_Fifo_Init(&context->txFifo);
+  COMM_FrameFifo_Init(&context->rxFrames);
+
+  context->terminator = COMM_TERMINATOR;
+  context->txPolicy   = COMM_TX_POLICY;
+  context->txTimeout  = COMM_TX_TIMEOUT;
+}
+/**
+ * @brief Switches the current instance of the calling thread.
+ * @param context Context (NULL - the default one)
+ */
+void COMM_SetContext(COMM_Context_TypeDef* context) {
+
+  comm = context ? context : &commDefault;
+}
+#endif
+
+/**
+ * @brief Sets function called when a frame is received.
+ * @details The function is called from interrupt context, so it
+ * should only signal the main loop (e.g. post a scheduler event).
+ * @param callback Frame function (NULL - none, frames have to be polled)
+ */
+void COMM_SetFrameCallback(void (*callback)(void)) {
+
+  comm->frameCallback = callback;
+}
+/**
+ * @brief Checks if there are received frames waiting.
+ * @details Can be called with interrupts disabled.
+ * @retval 1 Frame is waiting
+ * @retval 0 No frames
+ */
+uint8_t COMM_FramePending(void) {
+
+  return COMM_FrameFifo_Count(&comm->rxFrames) != 0;
+}
+/**
+ * @brief Command table, sorted by name (defined by linker script).
+ */
+extern const COMM_Command_TypeDef __comm_cmd_start[], __comm_cmd_end[];
+
+/**
+ * @brief Finds a command in the table (binary search).
+ * @param name Command name
+ * @return Command (NULL - not found)
+ */
+static const COMM_Command_TypeDef* COMM_FindCommand(const char* name) {
+
+  const COMM_Command_TypeDef* lo = __comm_cmd_start;
+  const COMM_Command_TypeDef* hi = __comm_cmd_end;
+
+  while (lo < hi) {
+
+    const COMM_Command_TypeDef* mid = lo + (hi - lo) / 2;
+    int cmp = strcmp(name, mid->name);
+
+    if (cmp == 0) {
+      return mid;
+    } else if (cmp < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  return NULL;
+}
+/**
+ * @brief Checks if string is a phone number (optional '+', 3-15 digits).
+ * @param str String
+ * @retval 1 Valid phone number
+ * @retval 0 Invalid
+ */
+static uint8_t COMM_IsPhone(const char* str) {
+
+  uint8_t digits = 0;
+
+  if (*str == '+') {
+    str++;
+  }
+
+  while (*str >= '0' && *str <= '9') {
+    str++;
+    digits++;
+  }
+
+  return *str == 0 && digits >= 3 && digits <= 15;
+}
+/**
+ * @brief Parses a frame and calls the handler of the command.
+ *
+ * @details Frame is split in place into space separated words, the
+ * first being the command (":name"). Arguments are converted according
+ * to the types given when the command was registered with COMM_COMMAND.
+ *
+ * @param frame Null terminated frame (modified)
+ * @retval 0 Command handled
+ * @retval 1 Unknown command
+ * @retval 2 Invalid arguments
+ */
+uint8_t COMM_Dispatch(char* frame) {
+
+  char* words[COMM_MAX_ARGS + 2];
+  COMM_Arg_TypeDef argv[COMM_MAX_ARGS];
+  uint8_t count = 0;
+
+  // split frame into words
+  while (*frame && count < COMM_MAX_ARGS + 2) {
+    while (*frame == ' ') {
+      *frame++ = 0;
+    }
+    if (*frame) {
+      words[count++] = frame;
+    }
+    while (*frame && *frame != ' ') {
+      frame++;
+    }
+  }
+
+  if (count == 0 || words[0][0] != ':') {
+    return 1;
+  }
+
+  const COMM_Command_TypeDef* cmd = COMM_FindCommand(&words[0][1]);
+
+  if (cmd == NULL) {
+    LOG_WARN("COMM--> Unknown command %s", words[0]);
+    return 1;
+  }
+
+  uint8_t argc = strlen(cmd->args);
+
+  if (count - 1 != argc || argc > COMM_MAX_ARGS) {
+    LOG_WARN("COMM--> Usage: :%s %s", cmd->name, cmd->args);
+    return 2;
+  }
+
+  for (uint8_t i = 0; i < argc; i++) {
+
+    char* word = words[i + 1];
+    char* end;
+
+    switch (cmd->args[i]) {
+    case 'i':
+      argv[i].i = strtol(word, &end, 0);
+      if (*end) {
+        LOG_WARN("COMM--> Argument %d is not a number", i + 1);
+        return 2;
+      }
+      break;
+    case 'p':
+      if (!COMM_IsPhone(word)) {
+        LOG_WARN("COMM--> Argument %d is not a phone number", i + 1);
+        return 2;
+      }
+      argv[i].s = word;
+      break;
+    default:
+      argv[i].s = word;
+      break;
+    }
+  }
+
+  cmd->handler(argv);
+
+  return 0;
+}
 /**
  * @brief Send a char to USART2.
  * @details This function can be called in stubs.c _write
  * function in order for printf to work
  *
  * @param c Char to send.
+ * @retval 1 Char accepted
+ * @retval 0 Char dropped (TX FIFO full)
+ */
+uint8_t COMM_Putc(uint8_t c) {
+  // No need to disable the IRQ - we are the only producer of txFifo
+  // and the TX interrupt is its only consumer.
+  return COMM_Write(&c, 1);
+}
+/**
+ * @brief Sets what happens when data doesn't fit in TX FIFO.
+ * @param policy Back-pressure policy
+ * @param timeout Maximum waiting time in ms (FIFO_POLICY_BLOCK only)
+ */
+void COMM_SetTxPolicy(FIFO_Policy_TypeDef policy, uint32_t timeout) {
+
+  comm->txPolicy  = policy;
+  comm->txTimeout = timeout;
+}
+/**
+ * @brief Puts data in TX FIFO, waiting for free space.
+ * @param buf Data
+ * @param len Data length
+ * @return Number of bytes put in TX FIFO (less than len after timeout)
+ */
+static uint16_t COMM_WriteBlocking(const uint8_t* buf, uint16_t len) {
+
+  uint16_t n = 0;
+  uint32_t start = TIMER_GetTime();
+
+  while (n < len) {
+
+    uint16_t space = FIFO_Space(&comm->txFifo.fifo);
+
+    if (space) {
+      if (space > len - n) {
+        space = len - n;
+      }
+      n += FIFO_PushBlock(&comm->txFifo.fifo, buf + n, space);
+      COMM_HAL_TxEnable(); // send it to free more space
+    } else if (TIMER_GetTime() - start >= comm->txTimeout) {
+      FIFO_PushStats(&comm->txFifo.fifo, 0, len - n); // the rest is lost
+      break;
+    }
+  }
+
+  return n;
+}
+/**
+ * @brief Send data to USART2.
+ * @details The data is put in TX FIFO with one block copy and the
+ * transmitter is enabled once, instead of once per character.
+ * If the data doesn't fit, the TX policy decides what to do
+ * (see COMM_SetTxPolicy). FIFO_POLICY_BLOCK can't be used
+ * from interrupts.
+ *
+ * @param buf Data
+ * @param len Data length
+ * @return Number of bytes accepted
  */
-void COMM_Putc(uint8_t c) {
-  // disable IRQ so it doesn't screw up FIFO count - leads to errors in transmission
-  COMM_HAL_IrqDisable;
+uint16_t COMM_Write(const uint8_t* buf, uint16_t len) {
+
+  uint16_t space = FIFO_Space(&comm->txFifo.fifo);
+  uint16_t n;
+
+  if (len > space) {
+
+    switch (comm->txPolicy) {
+
+    case FIFO_POLICY_ERROR: // all or nothing
+      FIFO_PushStats(&comm->txFifo.fifo, 0, len);
+      return 0;
+
+    case FIFO_POLICY_BLOCK:
+      return COMM_WriteBlocking(buf, len);
+
+    case FIFO_POLICY_DROP_OLDEST:
+      // data being sent by DMA has to stay in place
+      COMM_HAL_TxLock();
+      FIFO_DropOldest(&comm->txFifo.fifo, COMM_HAL_TxInFlight(), len - space);
+      COMM_HAL_TxUnlock();
+      break;
 
-  FIFO_Push(&txFifo,c); // Put data in TX buffer
-  COMM_HAL_TxEnable();  // Enable low level transmitter
+    default: // FIFO_POLICY_DROP_NEWEST - PushBlock drops what doesn't fit
+      break;
+    }
+  }
+
+  n = FIFO_PushBlock(&comm->txFifo.fifo, buf, len); // Put data in TX buffer
+  COMM_HAL_TxEnable(); // Enable low level transmitter
+
+  return n;
+}
+/**
+ * @brief Puts a whole frame in TX FIFO or nothing of it.
+ * @details A frame cut short by the TX policy would be lost at the PC
+ * anyway, and in binary mode it would corrupt the next frame too.
+ * FIFO_POLICY_BLOCK waits for the space (up to the timeout),
+ * FIFO_POLICY_DROP_OLDEST makes it, the other policies drop the frame.
+ * @param buf Frame
+ * @param len Frame length
+ * @retval 0 Frame queued
+ * @retval 1 Frame dropped (counted in TX FIFO statistics)
+ */
+static uint8_t COMM_WriteFrame(const uint8_t* buf, uint16_t len) {
+
+  uint16_t space = FIFO_Space(&comm->txFifo.fifo);
+  uint32_t start = TIMER_GetTime();
+
+  if (space < len) {
+
+    switch (comm->txPolicy) {
+
+    case FIFO_POLICY_BLOCK:
+      while ((space = FIFO_Space(&comm->txFifo.fifo)) < len &&
+          TIMER_GetTime() - start < comm->txTimeout) {
+        ; // transmitter frees space
+      }
+      break;
+
+    case FIFO_POLICY_DROP_OLDEST:
+      // data being sent by DMA has to stay in place
+      COMM_HAL_TxLock();
+      FIFO_DropOldest(&comm->txFifo.fifo, COMM_HAL_TxInFlight(), len - space);
+      COMM_HAL_TxUnlock();
+      space = FIFO_Space(&comm->txFifo.fifo);
+      break;
+
+    default:
+      break;
+    }
+
+    if (space < len) {
+      FIFO_PushStats(&comm->txFifo.fifo, 0, len);
+      return 1;
+    }
+  }
+
+  COMM_Write(buf, len);
+
+  return 0;
+}
+/**
+ * @brief Returns free space in TX FIFO.
+ * @return Number of bytes which can be written without applying the TX policy
+ */
+uint16_t COMM_TxSpace(void) {
 
-  // enable IRQ again
-  COMM_HAL_IrqEnable;
+  return FIFO_Space(&comm->txFifo.fifo);
 }
 /**
  * @brief Get a char from USART2
@@ -107,12 +477,10 @@ uint8_t COMM_Getc(void) {
 
   uint8_t c;
 
-  while (FIFO_IsEmpty(&rxFifo) == 1); // wait until buffer is not empty
-  // buffer not empty => char was received
-
 //  USART_ITConfig(USART2, USART_IT_RXNE, DISABLE); // disable RX interrupt
 
-  FIFO_Pop(&rxFifo,&c); // Get data from RX buffer
+  // Get data from RX buffer (wait until a char is received)
+  while (COMM_Fifo_Pop(&comm->rxFifo, &c) != 0);
 
 //  USART_ITConfig(USART2, USART_IT_RXNE, ENABLE); // enable RX interrupt
 
@@ -120,58 +488,242 @@ uint8_t COMM_Getc(void) {
 }
 /**
  * @brief Get a complete frame from USART2 (nonblocking)
- * @param buf Buffer for data (data will be null terminated for easier string manipulation)
+ *
+ * @details Frames are indexed by the RX callback as they arrive,
+ * so this is a descriptor lookup followed by one block copy.
+ *
+ * @param buf Buffer for data (at least COMM_FRAME_LEN bytes, data will be
+ * null terminated for easier string manipulation)
  * @param len Length not including terminator character
  * @retval 0 Received frame
  * @retval 1 No frame in buffer
- * @retval 2 Frame error
- * TODO Add maximum length checking so as not to overflow
+ * @retval 2 Frame error (part of the frame was lost)
+ * @retval 3 Frame too long (frame was dropped)
  */
 uint8_t COMM_GetFrame(uint8_t* buf, uint8_t* len) {
 
-  uint8_t c;
+  COMM_Frame_TypeDef frame;
   *len = 0; // zero out length variable
 
-  if (gotFrame) {
-    while (1) {
+  if (COMM_FrameFifo_Pop(&comm->rxFrames, &frame)) {
+    return 1; // no frame
+  }
 
-      // no more data and terminator wasn't reached => error
-      if (FIFO_IsEmpty(&rxFifo)) {
-        *len = 0;
-        println("Invalid frame");
-        return 2;
-      }
-      FIFO_Pop(&rxFifo, &c);
-      buf[(*len)++] = c;
-
-      // if end of frame
-      if (c == COMM_TERMINATOR) {
-        (*len)--; // length without terminator character
-        buf[*len] = 0; // USART terminator character converted to NULL terminator
-        break;
-      }
+  // Skip data which doesn't belong to any frame (frames which didn't
+  // fit in the descriptor FIFO)
+  int16_t skip = frame.start - comm->rxFifo.fifo.tail;
+  if (skip > 0) {
+    FIFO_Consume(&comm->rxFifo.fifo, skip);
+  }
+
+  if (frame.error) {
+    FIFO_Consume(&comm->rxFifo.fifo, frame.len);
+    LOG_WARN("COMM--> Invalid frame");
+    return 2;
+  }
+
+  if (frame.len > COMM_FRAME_LEN) {
+    FIFO_Consume(&comm->rxFifo.fifo, frame.len);
+    LOG_WARN("COMM--> Frame too long");
+    return 3;
+  }
+
+  FIFO_PopBlock(&comm->rxFifo.fifo, buf, frame.len); // copy whole frame at once
 
+  *len = frame.len - 1; // length without terminator character
+  buf[*len] = 0; // USART terminator character converted to NULL terminator
+
+  return 0;
+}
+/**
+ * @brief Calculates CRC-16/CCITT (polynomial 0x1021, initial value 0xffff).
+ * @param data Data
+ * @param len Data length
+ * @return CRC
+ */
+static uint16_t COMM_Crc16(const uint8_t* data, uint16_t len) {
+
+  uint16_t crc = 0xffff;
+
+  while (len--) {
+    crc ^= (uint16_t)*data++ << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
     }
-    gotFrame--;
-    return 0;
+  }
+
+  return crc;
+}
+/**
+ * @brief Changes protocol mode.
+ *
+ * @details In text mode frames are terminated with CR. In binary mode
+ * packets are COBS encoded and delimited with zeros - see COMM_GetPacket
+ * and COMM_PutPacket. Data is received the same way in both modes, only
+ * the frame terminator changes. When entering binary mode a delimiter is
+ * sent, so the PC starts decoding from a packet boundary.
+ *
+ * @param newMode New mode
+ */
+void COMM_SetMode(COMM_Mode_TypeDef newMode) {
 
+  comm->mode = newMode;
+
+  if (comm->mode == COMM_MODE_BINARY) {
+    comm->terminator = COMM_DELIMITER;
+    comm->rxSeq = 0;
+    comm->txSeq = 0;
+    COMM_Putc(COMM_DELIMITER);
   } else {
+    comm->terminator = COMM_TERMINATOR;
+  }
+}
+/**
+ * @brief Returns current protocol mode.
+ * @return Mode
+ */
+COMM_Mode_TypeDef COMM_GetMode(void) {
+
+  return comm->mode;
+}
+/**
+ * @brief Gets a received packet (binary mode, nonblocking).
+ *
+ * @details Packet format before COBS encoding: sequence number,
+ * type, payload, CRC-16/CCITT of the previous bytes (big endian).
+ *
+ * @param type Returns packet type
+ * @param buf Buffer for payload (at least COMM_FRAME_LEN bytes)
+ * @param len Returns payload length
+ * @retval 0 Received packet
+ * @retval 1 No packet
+ * @retval 2 Frame error (part of the packet was lost)
+ * @retval 3 Packet too long
+ * @retval 4 Invalid packet (encoding or CRC error)
+ */
+uint8_t COMM_GetPacket(uint8_t* type, uint8_t* buf, uint8_t* len) {
+
+  uint8_t ret;
+  uint8_t frameLen;
+  uint16_t n;
+
+  *len = 0;
+
+  do {
+    if ((ret = COMM_GetFrame(buf, &frameLen)) != 0) {
+      return ret;
+    }
+  } while (frameLen == 0); // skip delimiters between packets
+
+  n = COBS_Decode(buf, frameLen, buf); // decode in place
+
+  if (n < 4 || COMM_Crc16(buf, n - 2) != ((buf[n - 2] << 8) | buf[n - 1])) {
+    LOG_WARN("COMM--> Invalid packet");
+    return 4;
+  }
+
+  if (buf[0] != comm->rxSeq) {
+    LOG_WARN("COMM--> Lost %d packets", (uint8_t)(buf[0] - comm->rxSeq));
+  }
+
+  comm->rxSeq = buf[0] + 1;
+  *type = buf[1];
+  *len  = n - 4;
+  memmove(buf, &buf[2], *len);
 
+  return 0;
+}
+/**
+ * @brief Sends a packet.
+ * @details In text mode the packet is preceded with a delimiter too,
+ * so the PC can tell it apart from the surrounding text (used
+ * by the deferred log).
+ * @param type Packet type
+ * @param payload Packet data
+ * @param len Payload length (up to COMM_PACKET_LEN)
+ * @retval 0 Packet sent
+ * @retval 1 Payload too long
+ * @retval 2 Packet dropped - it didn't fit in TX FIFO (see COMM_SetTxPolicy)
+ */
+uint8_t COMM_PutPacket(uint8_t type, const uint8_t* payload, uint8_t len) {
+
+  uint8_t packet[COMM_PACKET_LEN + 4];
+  uint8_t frame[COBS_MAX_ENCODED(COMM_PACKET_LEN + 4) + 2];
+  uint16_t n;
+  uint16_t crc;
+
+  if (len > COMM_PACKET_LEN) {
     return 1;
   }
 
+  packet[0] = comm->txSeq++;
+  packet[1] = type;
+  memcpy(&packet[2], payload, len);
+  crc = COMM_Crc16(packet, len + 2);
+  packet[len + 2] = crc >> 8;
+  packet[len + 3] = crc & 0xff;
+
+  if (comm->mode == COMM_MODE_TEXT) {
+    frame[0] = COMM_DELIMITER;
+    n = COBS_Encode(packet, len + 4, &frame[1]) + 1;
+  } else {
+    n = COBS_Encode(packet, len + 4, frame);
+  }
+  frame[n++] = COMM_DELIMITER;
+
+  if (COMM_WriteFrame(frame, n)) {
+    return 2; // the PC sees a gap in sequence numbers
+  }
+
+  return 0;
+}
+
+#if FIFO_STATS
+/**
+ * @brief Get statistics of the COMM FIFOs.
+ * @param rx Returns RX FIFO statistics
+ * @param tx Returns TX FIFO statistics
+ */
+void COMM_GetStats(FIFO_Stats_TypeDef* rx, FIFO_Stats_TypeDef* tx) {
+
+  FIFO_GetStats(&comm->rxFifo.fifo, rx);
+  FIFO_GetStats(&comm->txFifo.fifo, tx);
 }
+#endif
 /**
  * @brief Callback for receiving data from PC.
  * @param c Data sent from lower layer software.
  */
 void COMM_RxCallback(uint8_t c) {
 
-  uint8_t res = FIFO_Push(&rxFifo, c); // Put data in RX buffer
+  if (COMM_Fifo_Push(&comm->rxFifo, c)) { // Put data in RX buffer
+    comm->frameError = 1; // overflow - frame is incomplete
+  }
+
+  if (c == comm->terminator) {
+
+    COMM_Frame_TypeDef frame;
+    uint16_t head = comm->rxFifo.fifo.head;
+
+    frame.start = comm->frameStart;
+    frame.len   = head - comm->frameStart;
+    frame.error = comm->frameError;
 
-  // Checking res to ensure no buffer overflow occurred
-  if ((c == COMM_TERMINATOR) && (res == 0)) {
-    gotFrame++;
+#if LOG_DEFERRED // only records can be written from interrupts
+    if (comm->frameError) {
+      LOG_WARN("COMM--> RX overflow, %u byte frame lost", (unsigned)frame.len);
+    }
+#endif
+
+    // If the descriptor FIFO is full, the frame is skipped by GetFrame
+    COMM_FrameFifo_Push(&comm->rxFrames, frame);
+
+    if (comm->frameCallback) {
+      comm->frameCallback();
+    }
+
+    comm->frameStart = head; // next frame starts here
+    comm->frameError = 0;
   }
 }
 /**
@@ -182,13 +734,32 @@ void COMM_RxCallback(uint8_t c) {
  */
 uint8_t COMM_TxCallback(uint8_t* c) {
 
-  if (FIFO_Pop(&txFifo, c) == 0) { // If buffer not empty
+  if (COMM_Fifo_Pop(&comm->txFifo, c) == 0) { // If buffer not empty
     return 1;
   } else {
     return 0;
   }
 
 }
+/**
+ * @brief Callback for DMA transmission - returns data to send.
+ * @details The data stays in TX FIFO until COMM_TxDoneCallback
+ * is called, so the DMA can read it in place.
+ * @param data Returns pointer to data
+ * @return Number of contiguous bytes to send (0 - nothing to send)
+ */
+uint16_t COMM_TxPeekCallback(uint8_t** data) {
+
+  return FIFO_PeekContiguous(&comm->txFifo.fifo, data);
+}
+/**
+ * @brief Callback for DMA transmission - releases sent data.
+ * @param len Number of bytes sent
+ */
+void COMM_TxDoneCallback(uint16_t len) {
+
+  FIFO_Consume(&comm->txFifo.fifo, len);
+}
 
 /**
  * @}
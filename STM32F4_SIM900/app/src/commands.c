@@ -0,0 +1,178 @@
+/**
+ * @file:   commands.c
+ * @brief:  Commands sent from PC.
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ * @details Commands are registered with COMM_COMMAND and
+ * dispatched by COMM_Dispatch, so adding a command only
+ * needs a handler and an entry here (or in any other file).
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <comm.h>
+#include <led.h>
+#include <sim900.h>
+#include <crc.h>
+#include <timers.h>
+#include <log.h>
+#include <trace.h>
+
+#define SMS_TIMEOUT 60000 ///< Maximum time of sending SMS in ms
+#define CRC_BENCH_LEN 4096 ///< Size of CRC benchmark buffer
+#define CRC_BENCH_RUNS 64  ///< Number of CRC benchmark runs
+
+/**
+ * @brief Controls LED0 (:LED0 ON, :LED0 OFF).
+ */
+static void CMD_Led0(COMM_Arg_TypeDef* argv) {
+
+  if (!strcmp(argv[0].s, "ON")) {
+    LED_ChangeState(LED0, LED_ON);
+  } else if (!strcmp(argv[0].s, "OFF")) {
+    LED_ChangeState(LED0, LED_OFF);
+  }
+}
+COMM_COMMAND(LED0, "s", CMD_Led0);
+
+/**
+ * @brief Switches to binary protocol (:BINARY).
+ * @details The PC returns to text mode with a COMM_PACKET_TEXT_MODE packet.
+ */
+static void CMD_Binary(COMM_Arg_TypeDef* argv) {
+
+  LOG_INFO("CMD--> Binary mode");
+  COMM_SetMode(COMM_MODE_BINARY);
+}
+COMM_COMMAND(BINARY, "", CMD_Binary);
+
+/**
+ * @brief Called when sending SMS completes.
+ */
+static void CMD_SmsCallback(uint8_t result, void* ctx) {
+
+  if (result == SIM900_RESULT_OK) {
+    LOG_INFO("CMD--> SMS sent");
+  } else {
+    LOG_WARN("CMD--> SMS not sent (result %d)", result);
+  }
+}
+/**
+ * @brief Sends test SMS (:SMS number, +48 is added to numbers without '+').
+ */
+static void CMD_Sms(COMM_Arg_TypeDef* argv) {
+
+  char cmd[32];
+
+  // commands are queued, result comes in CMD_SmsCallback
+  snprintf(cmd, sizeof(cmd), "AT+CMGS=\"%s%s\"\r",
+      argv[0].s[0] == '+' ? "" : "+48", argv[0].s);
+  SIM900_SendCommand("AT+CMGF=1\r", SIM900_RESULT_OK, 1000, 0, 0);
+  SIM900_SendCommandData(cmd, "Hello. This is your STM32.",
+      SIM900_RESULT_OK, SMS_TIMEOUT, CMD_SmsCallback, 0);
+}
+COMM_COMMAND(SMS, "p", CMD_Sms);
+
+/**
+ * @brief Measures CRC speed of the CRC unit and of software (:CRCBENCH).
+ */
+static void CMD_CrcBench(COMM_Arg_TypeDef* argv) {
+
+  static uint32_t data[CRC_BENCH_LEN / 4];
+  uint32_t crc[2];
+  uint32_t time[2];
+
+  for (uint32_t i = 0; i < CRC_BENCH_LEN / 4; i++) {
+    data[i] = i * 2654435761UL; // some data
+  }
+
+  for (uint8_t backend = 0; backend < 2; backend++) {
+
+    uint32_t start = TIMER_GetTimeUS();
+
+    crc[backend] = CRC_Start();
+    for (uint16_t run = 0; run < CRC_BENCH_RUNS; run++) {
+      crc[backend] = backend ?
+          CRC_SoftUpdate(crc[backend], data, CRC_BENCH_LEN) :
+          CRC_Update(crc[backend], data, CRC_BENCH_LEN);
+    }
+
+    time[backend] = TIMER_GetTimeUS() - start;
+    if (time[backend] == 0) {
+      time[backend] = 1;
+    }
+  }
+
+  // bytes per us = MB/s
+  LOG_INFO("CMD--> CRC_Update     %08lx %lu.%02lu MB/s", (unsigned long)crc[0],
+      (unsigned long)(CRC_BENCH_LEN * CRC_BENCH_RUNS / time[0]),
+      (unsigned long)(CRC_BENCH_LEN * CRC_BENCH_RUNS * 100UL / time[0] % 100));
+  LOG_INFO("CMD--> CRC_SoftUpdate %08lx %lu.%02lu MB/s", (unsigned long)crc[1],
+      (unsigned long)(CRC_BENCH_LEN * CRC_BENCH_RUNS / time[1]),
+      (unsigned long)(CRC_BENCH_LEN * CRC_BENCH_RUNS * 100UL / time[1] % 100));
+}
+COMM_COMMAND(CRCBENCH, "", CMD_CrcBench);
+
+/**
+ * @brief Captures UART traffic (:TRACE RAM, :TRACE COMM, :TRACE OFF, :TRACE SEND).
+ * @details RAM keeps the records until SEND, COMM sends them right away.
+ */
+static void CMD_Trace(COMM_Arg_TypeDef* argv) {
+
+  if (!strcmp(argv[0].s, "RAM")) {
+    TRACE_Start(TRACE_MODE_RAM, TRACE_ALL);
+  } else if (!strcmp(argv[0].s, "COMM")) {
+    TRACE_Start(TRACE_MODE_COMM, TRACE_ALL);
+  } else if (!strcmp(argv[0].s, "OFF")) {
+    TRACE_Stop();
+  } else if (!strcmp(argv[0].s, "SEND")) {
+    TRACE_Send();
+  }
+}
+COMM_COMMAND(TRACE, "s", CMD_Trace);
+
+#if FIFO_STATS
+/**
+ * @brief Prints FIFO statistics, for sizing the buffers, and idle
+ * statistics (:STATS).
+ */
+static void CMD_Stats(COMM_Arg_TypeDef* argv) {
+
+  FIFO_Stats_TypeDef stats[4];
+  const char* names[4] = {"COMM RX", "COMM TX", "SIM900 RX", "SIM900 TX"};
+
+  COMM_GetStats(&stats[0], &stats[1]);
+  SIM900_GetStats(&stats[2], &stats[3]);
+
+  for (int i = 0; i < 4; i++) {
+    LOG_INFO("CMD--> %s: pushed %lu popped %lu dropped %lu overflows %lu peak %u",
+        names[i], (unsigned long)stats[i].pushed,
+        (unsigned long)stats[i].popped, (unsigned long)stats[i].dropped,
+        (unsigned long)stats[i].overflows, (unsigned)stats[i].highWater);
+  }
+
+  LOG_INFO("CMD--> LOG: lost %lu records", (unsigned long)LOG_GetDropped());
+
+  uint32_t recorded, dropped;
+  TRACE_GetStats(&recorded, &dropped);
+  LOG_INFO("CMD--> TRACE: recorded %lu bytes lost %lu bytes",
+      (unsigned long)recorded, (unsigned long)dropped);
+
+  uint32_t sleeps, ticks;
+  TIMER_GetIdleStats(&sleeps, &ticks);
+  LOG_INFO("CMD--> IDLE: %lu sleeps in %lu ms, %lu ms requested",
+      (unsigned long)sleeps, (unsigned long)TIMER_GetTime(),
+      (unsigned long)ticks);
+}
+COMM_COMMAND(STATS, "", CMD_Stats);
+#endif
@@ -0,0 +1,158 @@
+/**
+ * @file:   crc.c
+ * @brief:  CRC-32 calculation.
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ * @details Uses the CRC unit if the HAL has one (CRC_HAL_HW),
+ * otherwise a slicing-by-8 table implementation. Both give
+ * the same results. Bytes which don't form whole aligned words
+ * are always processed in software.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <crc.h>
+#include <crc_hal.h>
+
+/**
+ * @addtogroup CRC
+ * @{
+ */
+
+#define CRC_POLY 0x04c11db7 ///< CRC-32 polynomial
+
+#ifndef CRC_USE_HW
+  #define CRC_USE_HW 1 ///< Nonzero uses the CRC unit (if HAL has one)
+#endif
+
+/**
+ * @brief Slicing-by-8 tables.
+ * @details crcTable[k][b] is the CRC of byte b followed by k zero bytes.
+ */
+static uint32_t crcTable[8][256];
+
+/**
+ * @brief Initializes CRC calculation (call before other functions).
+ */
+void CRC_Init(void) {
+
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i << 24;
+    for (uint8_t j = 0; j < 8; j++) {
+      c = (c & 0x80000000) ? (c << 1) ^ CRC_POLY : c << 1;
+    }
+    crcTable[0][i] = c;
+  }
+
+  for (uint32_t i = 0; i < 256; i++) {
+    for (uint8_t k = 1; k < 8; k++) {
+      uint32_t c = crcTable[k - 1][i];
+      crcTable[k][i] = (c << 8) ^ crcTable[0][c >> 24];
+    }
+  }
+
+#ifdef CRC_HAL_HW
+  CRC_HAL_Init();
+#endif
+}
+/**
+ * @brief Returns initial CRC value.
+ * @return CRC of empty data
+ */
+uint32_t CRC_Start(void) {
+
+  return 0xffffffff;
+}
+/**
+ * @brief Continues CRC calculation in software (slicing-by-8).
+ * @param crc CRC of previous data
+ * @param data Data
+ * @param len Data length
+ * @return CRC
+ */
+uint32_t CRC_SoftUpdate(uint32_t crc, const void* data, uint32_t len) {
+
+  const uint8_t* p = data;
+
+  while (len >= 8) {
+
+    uint32_t a = crc ^ ((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+        (uint32_t)p[2] << 8 | p[3]);
+
+    crc = crcTable[7][a >> 24] ^ crcTable[6][(a >> 16) & 0xff] ^
+          crcTable[5][(a >> 8) & 0xff] ^ crcTable[4][a & 0xff] ^
+          crcTable[3][p[4]] ^ crcTable[2][p[5]] ^
+          crcTable[1][p[6]] ^ crcTable[0][p[7]];
+
+    p   += 8;
+    len -= 8;
+  }
+
+  while (len--) {
+    crc = (crc << 8) ^ crcTable[0][(crc >> 24) ^ *p++];
+  }
+
+  return crc;
+}
+/**
+ * @brief Continues CRC calculation.
+ * @details Not reentrant when the CRC unit is used - don't
+ * call from interrupts.
+ * @param crc CRC of previous data (CRC_Start for first part)
+ * @param data Data
+ * @param len Data length
+ * @return CRC
+ */
+uint32_t CRC_Update(uint32_t crc, const void* data, uint32_t len) {
+
+#if CRC_USE_HW && defined(CRC_HAL_HW)
+  const uint8_t* p = data;
+
+  // CRC unit takes aligned words - start in software
+  while (len && ((uintptr_t)p & 3)) {
+    crc = (crc << 8) ^ crcTable[0][(crc >> 24) ^ *p++];
+    len--;
+  }
+
+  if (len >= 4) {
+    crc = CRC_HAL_Update(crc, (const uint32_t*)p, len / 4);
+    p   += len & ~3;
+    len &= 3;
+  }
+
+  return CRC_SoftUpdate(crc, p, len);
+#else
+  return CRC_SoftUpdate(crc, data, len);
+#endif
+}
+/**
+ * @brief Finishes CRC calculation.
+ * @param crc CRC of all data
+ * @return Final CRC (CRC-32/MPEG-2 has no final XOR)
+ */
+uint32_t CRC_Finish(uint32_t crc) {
+
+  return crc;
+}
+/**
+ * @brief Calculates CRC of data.
+ * @param data Data
+ * @param len Data length
+ * @return CRC
+ */
+uint32_t CRC_Calc(const void* data, uint32_t len) {
+
+  return CRC_Finish(CRC_Update(CRC_Start(), data, len));
+}
+
+/**
+ * @}
+ */
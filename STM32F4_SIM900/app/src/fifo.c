@@ -17,18 +17,8 @@
 
 #include <fifo.h>
 #include <stdio.h>
-
-#ifndef DEBUG
-  #define DEBUG
-#endif
-
-#ifdef DEBUG
-  #define print(str, args...) printf("FIFO--> "str"%s",##args,"\r")
-  #define println(str, args...) printf("FIFO--> "str"%s",##args,"\r\n")
-#else
-  #define print(str, args...) (void)0
-  #define println(str, args...) (void)0
-#endif
+#include <string.h>
+#include <log.h>
 
 /**
  * @addtogroup FIFO
@@ -45,17 +35,26 @@
  * @param fifo Pointer to FIFO structure
  * @retval 0 FIFO added successfully
  * @retval 1 Error: FIFO length is 0
+ * @retval 2 Error: FIFO length is not a power of two
  */
 uint8_t FIFO_Add(FIFO_TypeDef* fifo) {
 
   if (fifo->len == 0 ) {
-    println("Zero FIFO length");
+    LOG_ERROR("FIFO--> Zero FIFO length");
     return 1;
   }
 
+  if ((fifo->len & (fifo->len - 1)) || fifo->len > 0x8000) {
+    LOG_ERROR("FIFO--> FIFO length %d is not a power of two", (int)fifo->len);
+    return 2;
+  }
+
   fifo->tail  = 0;
   fifo->head  = 0;
-  fifo->count = 0;
+
+#if FIFO_STATS
+  memset(&fifo->stats, 0, sizeof(fifo->stats));
+#endif
 
   return 0;
 }
@@ -68,19 +67,21 @@ uint8_t FIFO_Add(FIFO_TypeDef* fifo) {
  */
 uint8_t FIFO_Push(FIFO_TypeDef* fifo, uint8_t c) {
 
-  // Check for overflow
-  if (fifo->count == fifo->len) {
-    println("FIFO overflow");
+  uint16_t head = fifo->head;
+
+  // Check for overflow (no printing here - this usually runs in an ISR
+  // and printf would make it a second producer on the COMM TX FIFO)
+  if ((uint16_t)(head - fifo->tail) == fifo->len) {
+    FIFO_PushStats(fifo, 0, 1);
     return 1;
   }
 
-  fifo->buf[fifo->head++] = c; // Put char in buffer
-  fifo->count++; // Increase counter
+  fifo->buf[head & (fifo->len - 1)] = c; // Put char in buffer
 
+  FIFO_BARRIER(); // data has to be stored before it is published
+  fifo->head = head + 1;
 
-  if (fifo->head == fifo->len) {
-    fifo->head = 0; // start from beginning
-  }
+  FIFO_PushStats(fifo, 1, 0);
 
   return 0;
 }
@@ -93,17 +94,21 @@ uint8_t FIFO_Push(FIFO_TypeDef* fifo, uint8_t c) {
  */
 uint8_t FIFO_Pop(FIFO_TypeDef* fifo, uint8_t* c) {
 
+  uint16_t tail = fifo->tail;
+
   // If FIFO is empty
-  if (fifo->count == 0) {
-//    println("FIFO is empty");
+  if (fifo->head == tail) {
+//    LOG_DEBUG("FIFO--> FIFO is empty");
     return 1;
   }
-  *c = fifo->buf[fifo->tail++];
-  fifo->count--;
 
-  if (fifo->tail == fifo->len) {
-    fifo->tail = 0; // start from beginning
-  }
+  FIFO_BARRIER(); // don't read data before checking head
+  *c = fifo->buf[tail & (fifo->len - 1)];
+
+  FIFO_BARRIER(); // data has to be read before the slot is released
+  fifo->tail = tail + 1;
+
+  FIFO_PopStats(fifo, 1);
 
   return 0;
 }
@@ -115,12 +120,235 @@ uint8_t FIFO_Pop(FIFO_TypeDef* fifo, uint8_t* c) {
  */
 uint8_t FIFO_IsEmpty(FIFO_TypeDef* fifo) {
 
-  if (fifo->count == 0) {
+  if (fifo->head == fifo->tail) {
     return 1;
   }
 
   return 0;
 }
+/**
+ * @brief Pushes a block of data to the FIFO.
+ *
+ * @details The data is copied in at most two contiguous
+ * segments (before and after the buffer wraps around).
+ *
+ * @param fifo Pointer to FIFO structure
+ * @param data Data to push
+ * @param len Number of bytes to push
+ * @return Number of bytes actually pushed (less than len if FIFO got full)
+ */
+uint16_t FIFO_PushBlock(FIFO_TypeDef* fifo, const uint8_t* data, uint16_t len) {
+
+  uint16_t head    = fifo->head;
+  uint16_t space   = fifo->len - (uint16_t)(head - fifo->tail);
+  uint16_t dropped = 0;
+
+  if (len > space) {
+    dropped = len - space;
+    len = space; // push as much as fits
+  }
+
+  uint16_t offset = head & (fifo->len - 1);
+  uint16_t first  = fifo->len - offset; // space up to the end of buffer
+
+  if (first > len) {
+    first = len;
+  }
+
+  memcpy(&fifo->buf[offset], data, first);
+  memcpy(fifo->buf, data + first, len - first); // wrapped part
+
+  FIFO_BARRIER(); // data has to be stored before it is published
+  fifo->head = head + len;
+
+  FIFO_PushStats(fifo, len, dropped);
+
+  return len;
+}
+/**
+ * @brief Pops a block of data from the FIFO.
+ *
+ * @details The data is copied out in at most two contiguous
+ * segments (before and after the buffer wraps around).
+ *
+ * @param fifo Pointer to FIFO structure
+ * @param data Buffer for data
+ * @param len Maximum number of bytes to pop
+ * @return Number of bytes actually popped
+ */
+uint16_t FIFO_PopBlock(FIFO_TypeDef* fifo, uint8_t* data, uint16_t len) {
+
+  uint8_t* p;
+  uint16_t popped = 0;
+
+  // at most two passes - before and after the buffer wraps around
+  while (popped < len) {
+
+    uint16_t n = FIFO_PeekContiguous(fifo, &p);
+
+    if (n == 0) {
+      break; // FIFO is empty
+    }
+    if (n > len - popped) {
+      n = len - popped;
+    }
+
+    memcpy(data + popped, p, n);
+    FIFO_Consume(fifo, n);
+    popped += n;
+  }
+
+  return popped;
+}
+/**
+ * @brief Finds the first occurrence of a byte in the FIFO.
+ *
+ * @details Only the consumer may call this function.
+ * The data is searched in place, nothing is removed from the FIFO.
+ *
+ * @param fifo Pointer to FIFO structure
+ * @param c Byte to look for
+ * @return Number of bytes up to and including c, 0 if c is not in FIFO
+ */
+uint16_t FIFO_Find(FIFO_TypeDef* fifo, uint8_t c) {
+
+  uint8_t* p;
+  uint16_t count = fifo->head - fifo->tail;
+  uint16_t first = FIFO_PeekContiguous(fifo, &p);
+
+  if (first > count) {
+    first = count; // producer pushed more data in the meantime
+  }
+
+  uint8_t* found = memchr(p, c, first);
+
+  if (found) {
+    return found - p + 1;
+  }
+
+  found = memchr(fifo->buf, c, count - first); // wrapped part
+
+  if (found) {
+    return first + (found - fifo->buf) + 1;
+  }
+
+  return 0;
+}
+/**
+ * @brief Returns the contiguous readable region of the FIFO.
+ *
+ * @details This allows the consumer to parse data in place,
+ * without copying it out of the FIFO. The region ends either
+ * at the head or at the end of the buffer (the rest of the data
+ * is then at the beginning of the buffer). Data stays in
+ * the FIFO until FIFO_Consume is called.
+ *
+ * @param fifo Pointer to FIFO structure
+ * @param data Returns pointer to the oldest data in FIFO
+ * @return Number of contiguous bytes available at data
+ */
+uint16_t FIFO_PeekContiguous(FIFO_TypeDef* fifo, uint8_t** data) {
+
+  uint16_t tail   = fifo->tail;
+  uint16_t count  = fifo->head - tail;
+  uint16_t offset = tail & (fifo->len - 1);
+
+  FIFO_BARRIER(); // don't read data before checking head
+
+  *data = &fifo->buf[offset];
+
+  if (count > fifo->len - offset) {
+    return fifo->len - offset; // data wraps around
+  }
+
+  return count;
+}
+/**
+ * @brief Removes data from the FIFO without copying it.
+ * @param fifo Pointer to FIFO structure
+ * @param len Number of bytes to remove (has to be available in FIFO)
+ */
+void FIFO_Consume(FIFO_TypeDef* fifo, uint16_t len) {
+
+  FIFO_BARRIER(); // data has to be read before the slots are released
+  fifo->tail += len;
+
+  FIFO_PopStats(fifo, len);
+}
+/**
+ * @brief Returns free space in the FIFO.
+ * @param fifo Pointer to FIFO structure
+ * @return Number of bytes which can be pushed
+ */
+uint16_t FIFO_Space(FIFO_TypeDef* fifo) {
+
+  return fifo->len - (uint16_t)(fifo->head - fifo->tail);
+}
+/**
+ * @brief Drops the oldest data to make space for new data.
+ *
+ * @details The first skip bytes (e.g. being sent by DMA right now)
+ * are kept in place, the bytes after them are dropped and the newer
+ * data is moved back to fill the gap. Without skipped bytes only the
+ * tail moves. Both indices are modified, so the consumer has to be
+ * stopped (its interrupts disabled) during the call.
+ *
+ * @param fifo Pointer to FIFO structure
+ * @param skip Number of oldest bytes to keep
+ * @param len Number of bytes to drop
+ * @return Number of bytes actually dropped
+ */
+uint16_t FIFO_DropOldest(FIFO_TypeDef* fifo, uint16_t skip, uint16_t len) {
+
+  uint16_t count = fifo->head - fifo->tail;
+  uint16_t mask  = fifo->len - 1;
+
+  if (skip > count) {
+    skip = count;
+  }
+
+  if (len > count - skip) {
+    len = count - skip;
+  }
+
+  if (skip == 0) {
+    fifo->tail += len;
+  } else {
+    uint16_t dst = fifo->tail + skip;
+    for (uint16_t src = dst + len; src != fifo->head; src++, dst++) {
+      fifo->buf[dst & mask] = fifo->buf[src & mask];
+    }
+    fifo->head -= len;
+  }
+
+  FIFO_PushStats(fifo, 0, len);
+
+  return len;
+}
+
+#if FIFO_STATS
+/**
+ * @brief Takes a consistent snapshot of FIFO statistics.
+ *
+ * @details The counters are updated from both the ISR and
+ * the main loop, so they are copied until two consecutive
+ * copies are identical.
+ *
+ * @param fifo Pointer to FIFO structure
+ * @param stats Returns the statistics
+ */
+void FIFO_GetStats(FIFO_TypeDef* fifo, FIFO_Stats_TypeDef* stats) {
+
+  FIFO_Stats_TypeDef check;
+
+  do {
+    memcpy(stats, &fifo->stats, sizeof(*stats));
+    FIFO_BARRIER();
+    memcpy(&check, &fifo->stats, sizeof(check));
+    FIFO_BARRIER();
+  } while (memcmp(stats, &check, sizeof(check)));
+}
+#endif
 
 /**
  * @}
@@ -17,22 +17,11 @@
 
 #include <keys.h>
 #include <timers.h>
-#include <stdio.h>
 #include <keys_hal.h>
-
-#ifndef DEBUG
-  #define DEBUG
-#endif
-
-#ifdef DEBUG
-  #define print(str, args...) printf("KEYS--> "str"%s",##args,"\r")
-  #define println(str, args...) printf("KEYS--> "str"%s",##args,"\r\n")
-#else
-  #define print(str, args...) (void)0
-  #define println(str, args...) (void)0
-#endif
+#include <log.h>
 
 #define DEBOUNCE_TIME 200 ///< Key debounce time in ms
+#define KEYS_COLUMNS  4   ///< Number of keyboard columns
 
 /**
  * Key structure typedef.
@@ -48,6 +37,8 @@ typedef struct {
 
 
 uint8_t currentColumn; ///< Selected keyboard column
+static uint8_t idleScans; ///< Scans without any key (up to KEYS_COLUMNS)
+static uint8_t sleeping;  ///< All columns selected, waiting for a key press
 
 void KEYS_Init(void) {
 
@@ -72,12 +63,18 @@ uint8_t KEYS_Update(void) {
 
   static uint32_t debounceTimer = 0; // timer for counting debounce time
 
+  if (sleeping) { // woken up - start scanning from the selected column
+    sleeping = 0;
+    KEYS_HAL_SelectColumn(currentColumn);
+    return KEY_NONE;
+  }
+
   int8_t row = KEYS_HAL_ReadRow();
 
   // if a keypress has been recongized
   if (row != -1) {
     currentKey = (currentColumn << 4) | row;
-//    println("You pressed a key in row %d, column %d.", row, currentColumn);
+//    LOG_DEBUG("KEYS--> You pressed a key in row %d, column %d.", row, currentColumn);
   }
 
   // if key value changed start debounce timer for new key
@@ -88,14 +85,23 @@ uint8_t KEYS_Update(void) {
   // if debounce finished, the key is valid
   if (keyId != KEY_NONE && TIMER_DelayTimer(DEBOUNCE_TIME, debounceTimer)) {
     keyValid = keyId;
-    println("You pressed a key 0x%02x.", keyValid);
+    LOG_INFO("KEYS--> You pressed a key 0x%02x.", keyValid);
     keyId = KEY_NONE;
   }
 
+  // no key in any column and nothing being debounced
+  if (row == -1 && keyId == KEY_NONE) {
+    if (idleScans < KEYS_COLUMNS) {
+      idleScans++;
+    }
+  } else {
+    idleScans = 0;
+  }
+
   // update column
   currentColumn++;
 
-  if (currentColumn == 4) {
+  if (currentColumn == KEYS_COLUMNS) {
     currentColumn = 0;
   }
 
@@ -104,5 +110,28 @@ uint8_t KEYS_Update(void) {
   // if key is valid return ID, if not returns KEY_NONE
   return keyValid;
 }
+/**
+ * @brief Checks if scanning can stop.
+ * @retval 1 No key is pressed in any column and nothing is being debounced
+ * @retval 0 Keep on scanning
+ */
+uint8_t KEYS_IsIdle(void) {
+
+  return idleScans == KEYS_COLUMNS;
+}
+/**
+ * @brief Stops scanning until a key is pressed.
+ * @details Stop calling KEYS_Update (e.g. stop its timer) and resume
+ * when the callback is called - the first update then selects the
+ * scanned column again.
+ * @param wakeupCallback Function called from interrupt on key press
+ */
+void KEYS_Sleep(void (*wakeupCallback)(void)) {
+
+  sleeping  = 1;
+  idleScans = 0;
+
+  KEYS_HAL_EnableWakeup(wakeupCallback);
+}
 
 
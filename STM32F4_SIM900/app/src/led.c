@@ -24,21 +24,9 @@
  *
  */
 
-#include <stdio.h>
 #include <led.h>
 #include <led_hal.h>
-
-#ifndef DEBUG
-  #define DEBUG
-#endif
-
-#ifdef DEBUG
-  #define print(str, args...) printf("LED--> "str"%s",##args,"\r")
-  #define println(str, args...) printf("LED--> "str"%s",##args,"\r\n")
-#else
-  #define print(str, args...) (void)0
-  #define println(str, args...) (void)0
-#endif
+#include <log.h>
 
 /**
  * @addtogroup LED
@@ -55,7 +43,7 @@ void LED_Init(LED_Number_TypeDef led) {
 
   // Check if LED number is correct.
   if (led >= MAX_LEDS) {
-    println("Error: Incorrect LED number %d!", (int)led);
+    LOG_ERROR("LED--> Incorrect LED number %d!", (int)led);
     return;
   }
 
@@ -71,12 +59,12 @@ void LED_Init(LED_Number_TypeDef led) {
 void LED_ChangeState(LED_Number_TypeDef led, LED_State_TypeDef state) {
 
   if (led >= MAX_LEDS) {
-    println("Error: Incorrect LED number %d!", (int)led);
+    LOG_ERROR("LED--> Incorrect LED number %d!", (int)led);
     return;
   }
 
   if (ledState[led] == LED_UNUSED) {
-    println("Error: Uninitialized LED %d!", (int)led);
+    LOG_ERROR("LED--> Uninitialized LED %d!", (int)led);
     return;
   } else {
     if (state == LED_OFF) {
@@ -96,12 +84,12 @@ void LED_ChangeState(LED_Number_TypeDef led, LED_State_TypeDef state) {
 void LED_Toggle(LED_Number_TypeDef led) {
 
   if (led >= MAX_LEDS) {
-    println("Error: Incorrect LED number %d!", (int)led);
+    LOG_ERROR("LED--> Incorrect LED number %d!", (int)led);
     return;
   }
 
   if (ledState[led] == LED_UNUSED) {
-    println("Error: Uninitialized LED %d!", (int)led);
+    LOG_ERROR("LED--> Uninitialized LED %d!", (int)led);
     return;
   } else {
     if (ledState[led] == LED_OFF) {
@@ -0,0 +1,261 @@
+/**
+ * @file:   log.c
+ * @brief:  Deferred formatting log
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <log.h>
+#include <log_hal.h>
+#include <fifo.h>
+#include <comm.h>
+#include <cobs.h>
+#include <timers.h>
+#include <string.h>
+
+/**
+ * @addtogroup LOG
+ * @{
+ */
+
+#define LOG_BUF_LEN 2048 ///< Size of the record ring (power of two)
+/// Maximum number of bytes a packet takes in COMM TX FIFO
+#define LOG_PACKET_MAX (COBS_MAX_ENCODED(COMM_PACKET_LEN + 4) + 2)
+
+FIFO_DEFINE(LOG_Fifo, uint8_t, LOG_BUF_LEN)
+
+static LOG_Fifo_TypeDef records = FIFO_INIT(records); ///< Ring of records
+static uint32_t dropped;          ///< Records lost since last report
+static uint32_t droppedTotal;     ///< Records lost since startup
+static void (*logCallback)(void); ///< Function called when a record is written
+
+/// Start of format strings (linker), record IDs are offsets from here
+extern const char __start_log_fmt[] __attribute__((weak));
+
+/**
+ * @brief Sets function called when a record is written
+ * (e.g. posting a task calling LOG_Flush).
+ * @param callback Callback (can be called from interrupts)
+ */
+void LOG_SetCallback(void (*callback)(void)) {
+
+  logCallback = callback;
+}
+/**
+ * @brief Checks whether there are records waiting to be sent.
+ * @retval 1 Records waiting
+ * @retval 0 Ring is empty
+ */
+uint8_t LOG_Pending(void) {
+
+  return !FIFO_IsEmpty(&records.fifo);
+}
+/**
+ * @brief Returns number of records lost since startup (ring full).
+ * @return Number of lost records
+ */
+uint32_t LOG_GetDropped(void) {
+
+  return droppedTotal;
+}
+/**
+ * @brief Puts a record in the ring.
+ * @details Called with interrupts disabled.
+ * @param rec Record
+ * @param len Record length
+ * @retval 0 Record written
+ * @retval 1 Ring full
+ */
+static uint8_t LOG_Push(const uint8_t* rec, uint8_t len) {
+
+  if (FIFO_Space(&records.fifo) < len) {
+    return 1;
+  }
+
+  FIFO_PushBlock(&records.fifo, rec, len);
+
+  return 0;
+}
+/**
+ * @brief Writes a record header.
+ * @param rec Record
+ * @param id Format string ID
+ * @param len Record length
+ * @param level Log level
+ * @param argc Number of arguments
+ */
+static void LOG_Header(uint8_t* rec, uint16_t id, uint8_t len,
+    uint8_t level, uint8_t argc) {
+
+  uint32_t time = TIMER_GetTime();
+
+  memcpy(&rec[0], &id, 2);
+  rec[2] = len;
+  rec[3] = (level << 4) | argc;
+  memcpy(&rec[4], &time, 4);
+}
+/**
+ * @brief Puts a finished record in the ring, reporting lost records first.
+ * @details Can be called from interrupts.
+ * @param rec Record
+ * @param len Record length
+ */
+static void LOG_Commit(const uint8_t* rec, uint8_t len) {
+
+  uint32_t state = LOG_HAL_Lock(); // records come from interrupts too
+
+  if (dropped) { // report lost records first
+    uint8_t lost[LOG_HEADER_LEN + 4];
+    LOG_Header(lost, LOG_ID_DROPPED, sizeof(lost), LOG_LEVEL_WARN, 1);
+    memcpy(&lost[LOG_HEADER_LEN], &dropped, 4);
+    if (LOG_Push(lost, sizeof(lost)) == 0) {
+      dropped = 0;
+    }
+  }
+
+  if (dropped || LOG_Push(rec, len)) {
+    dropped++;
+    droppedTotal++;
+  }
+
+  LOG_HAL_Unlock(state);
+
+  if (logCallback) {
+    logCallback();
+  }
+}
+/**
+ * @brief Writes a log record (use the LOG_* macros).
+ *
+ * @details Record format (little endian): format string ID (2 bytes),
+ * record length, level (high nibble) and number of arguments (low nibble),
+ * timestamp in ms (4 bytes), arguments (4 bytes each), string arguments.
+ * A string argument holds its length, the characters follow the arguments.
+ * Can be called from interrupts, only copying is done here.
+ *
+ * @param level Log level
+ * @param fmt Format string (in log_fmt section)
+ * @param argv Arguments
+ * @param argc Number of arguments
+ */
+void LOG_Write(uint8_t level, const char* fmt, const LOG_Arg_TypeDef* argv,
+    uint8_t argc) {
+
+  uint8_t rec[LOG_MAX_RECORD];
+  uint8_t len = LOG_HEADER_LEN + 4 * argc;
+  uint32_t value;
+
+  for (uint8_t i = 0; i < argc; i++) {
+
+    value = argv[i].value;
+
+    if (argv[i].str) { // copy string after the arguments
+      value = strnlen(argv[i].str, LOG_MAX_STR);
+      if (value > LOG_MAX_RECORD - len) {
+        value = LOG_MAX_RECORD - len;
+      }
+      memcpy(&rec[len], argv[i].str, value);
+      len += value;
+    }
+
+    memcpy(&rec[LOG_HEADER_LEN + 4 * i], &value, 4);
+  }
+
+  LOG_Header(rec, fmt - __start_log_fmt, len, level, argc);
+  LOG_Commit(rec, len);
+}
+/**
+ * @brief Writes a hex dump record (use LOG_DEBUG_HEX).
+ *
+ * @details Record format: header with LOG_ARGC_HEX arguments, buffer
+ * length (4 bytes), up to LOG_MAX_HEX bytes of the buffer. The decoder
+ * prints the text and the bytes in hex.
+ *
+ * @param level Log level
+ * @param fmt Text (in log_fmt section)
+ * @param buf Buffer
+ * @param len Buffer length
+ */
+void LOG_WriteHex(uint8_t level, const char* fmt, const uint8_t* buf,
+    uint16_t len) {
+
+  uint8_t rec[LOG_MAX_RECORD];
+  uint32_t total = len;
+  uint8_t n = len > LOG_MAX_HEX ? LOG_MAX_HEX : len;
+
+  memcpy(&rec[LOG_HEADER_LEN], &total, 4);
+  memcpy(&rec[LOG_HEADER_LEN + 4], buf, n);
+
+  LOG_Header(rec, fmt - __start_log_fmt, LOG_HEADER_LEN + 4 + n, level,
+      LOG_ARGC_HEX);
+  LOG_Commit(rec, LOG_HEADER_LEN + 4 + n);
+}
+/**
+ * @brief Prints a buffer in hex after the text (LOG_DEBUG_HEX
+ * with LOG_DEFERRED set to zero).
+ * @param fmt Text
+ * @param buf Buffer
+ * @param len Buffer length
+ */
+void LOG_PrintHex(const char* fmt, const uint8_t* buf, uint16_t len) {
+
+  printf("%s", fmt);
+
+  for (uint16_t i = 0; i < len; i++) {
+    printf(" %02x", buf[i]);
+  }
+
+  printf("\r\n");
+}
+/**
+ * @brief Sends waiting records to PC.
+ * @details Records are packed in COMM_PACKET_LOG packets (whole records
+ * only). Packets are sent only while they fit in COMM TX FIFO, so
+ * the log never pushes out other output. Call from the main loop.
+ * @retval 0 All records sent
+ * @retval 1 Some records wait for free space in COMM TX FIFO
+ */
+uint8_t LOG_Flush(void) {
+
+  uint8_t packet[COMM_PACKET_LEN];
+  uint8_t len = 0;
+  uint8_t recLen;
+
+  while (LOG_Pending()) {
+
+    FIFO_BARRIER(); // don't read data before checking head
+    recLen = records.storage[(uint16_t)(records.fifo.tail + 2) & (LOG_BUF_LEN - 1)];
+
+    if (len + recLen > COMM_PACKET_LEN) { // send full packet first
+      COMM_PutPacket(COMM_PACKET_LOG, packet, len);
+      len = 0;
+    }
+
+    if (len == 0 && COMM_TxSpace() < LOG_PACKET_MAX) {
+      return 1; // PC link is busy
+    }
+
+    FIFO_PopBlock(&records.fifo, packet + len, recLen);
+    len += recLen;
+  }
+
+  if (len) {
+    COMM_PutPacket(COMM_PACKET_LOG, packet, len);
+  }
+
+  return 0;
+}
+
+/**
+ * @}
+ */
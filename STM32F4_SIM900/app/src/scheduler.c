@@ -0,0 +1,98 @@
+/**
+ * @file:   scheduler.c
+ * @brief:  Cooperative event-driven scheduler.
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ * @details Tasks run to completion in the main loop, only when
+ * an event was posted for them. Events can be posted from interrupts.
+ * Each task has a unique priority, which is also its ID - when
+ * several tasks are pending, the one with the lowest number runs first.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <scheduler.h>
+#include <log.h>
+
+/**
+ * @addtogroup SCHED
+ * @{
+ */
+
+static void (*tasks[SCHED_MAX_TASKS])(void); ///< Task functions (index is priority)
+static volatile uint32_t pending; ///< Bit set for every task with posted event
+
+/**
+ * @brief Adds a task.
+ * @param prio Priority and ID of task (0 - highest)
+ * @param task Function called when events are posted for the task.
+ * It should handle all the work waiting for it before returning.
+ * @retval 0 Task added
+ * @retval 1 Priority out of range or already used
+ */
+uint8_t SCHED_AddTask(uint8_t prio, void (*task)(void)) {
+
+  if (prio >= SCHED_MAX_TASKS || tasks[prio] != NULL) {
+    LOG_ERROR("SCHED--> Can't add task with priority %d", prio);
+    return 1;
+  }
+
+  tasks[prio] = task;
+
+  return 0;
+}
+/**
+ * @brief Posts an event for a task.
+ * @details Can be called from interrupts. Events posted several times
+ * before the task runs are merged into one run.
+ * @param prio Task priority
+ */
+void SCHED_Post(uint8_t prio) {
+
+  __atomic_fetch_or(&pending, 1UL << prio, __ATOMIC_RELEASE);
+}
+/**
+ * @brief Checks if any task has a pending event.
+ * @retval 1 Some task is pending
+ * @retval 0 Nothing to do
+ */
+uint8_t SCHED_Pending(void) {
+
+  return pending != 0;
+}
+/**
+ * @brief Runs all pending tasks.
+ *
+ * @details The highest priority pending task is chosen again after
+ * each task, so events posted meanwhile for more important tasks
+ * are handled first. Returns when there are no pending events.
+ */
+void SCHED_Run(void) {
+
+  uint32_t mask;
+
+  while ((mask = pending) != 0) {
+
+    uint8_t prio = __builtin_ctz(mask); // lowest bit - highest priority
+
+    // Clear the event before running the task, so events posted
+    // while it runs cause another run
+    __atomic_fetch_and(&pending, ~(1UL << prio), __ATOMIC_ACQUIRE);
+
+    if (tasks[prio] != NULL) {
+      tasks[prio]();
+    }
+  }
+}
+
+/**
+ * @}
+ */
@@ -18,22 +18,13 @@
 
 #include <sim900.h>
 #include <fifo.h>
+#include <timers.h>
 // HAL
 #include <uart3.h>
 #include <stdio.h>
 #include <string.h>
-
-#ifndef DEBUG
-  #define DEBUG
-#endif
-
-#ifdef DEBUG
-  #define print(str, args...) printf(""str"%s",##args,"")
-  #define println(str, args...) printf("GSM--> "str"%s",##args,"\r\n")
-#else
-  #define print(str, args...) (void)0
-  #define println(str, args...) (void)0
-#endif
+#include <log.h>
+#include <instance_hal.h>
 
 /**
  * @defgroup  SIM900 SIM900
@@ -46,18 +37,97 @@
  */
 
 #define SIM900_BUF_LEN     4096    ///< SIM900 buffer lengths
+#define SIM900_MAX_FRAMES 16       ///< Maximum number of frames waiting in RX FIFO
 #define SIM900_TERMINATOR '\n'     ///< SIM900 frame terminator character
 
-static uint8_t rxBuffer[SIM900_BUF_LEN]; ///< Buffer for received data.
-static uint8_t txBuffer[SIM900_BUF_LEN]; ///< Buffer for transmitted data.
+#define SIM900_MAX_COMMANDS 8   ///< Maximum number of queued AT commands
+#define SIM900_CMD_LEN    176      ///< Maximum command length (with data and NULL terminators)
+#define SIM900_DATA_END   '\x1a'   ///< Ends data sent after prompt (Ctrl+Z)
+
+#ifndef SIM900_TX_POLICY
+  #define SIM900_TX_POLICY  FIFO_POLICY_BLOCK ///< Default TX FIFO back-pressure policy
+#endif
+#define SIM900_TX_TIMEOUT 100 ///< Default TX waiting time in ms (FIFO_POLICY_BLOCK)
+
+#ifndef SIM900_USE_TX_DMA
+  #define SIM900_USE_TX_DMA 1 ///< Nonzero sends data using DMA (if HAL supports it)
+#endif
+#ifndef SIM900_USE_RX_DMA
+  #define SIM900_USE_RX_DMA 1 ///< Nonzero receives data using circular DMA (if HAL supports it)
+#endif
 
-static FIFO_TypeDef rxFifo; ///< RX FIFO
-static FIFO_TypeDef txFifo; ///< TX FIFO
+FIFO_DEFINE(SIM900_Fifo, uint8_t, SIM900_BUF_LEN)
 
-static uint8_t gotFrame;  ///< Nonzero signals a new frame (number of received frames)
+/**
+ * @brief Descriptor of a frame received in RX FIFO.
+ */
+typedef struct {
+  uint16_t start; ///< RX FIFO index of the first byte of frame
+  uint16_t len;   ///< Frame length (with terminator)
+  uint8_t  error; ///< Nonzero if part of the frame was lost
+} SIM900_Frame_TypeDef;
+
+FIFO_DEFINE(SIM900_FrameFifo, SIM900_Frame_TypeDef, SIM900_MAX_FRAMES)
+
+/**
+ * @brief Queued AT command.
+ */
+typedef struct {
+  char     text[SIM900_CMD_LEN]; ///< Command, followed by data sent after prompt
+  uint8_t  dataStart;            ///< Index of data in text (0 - no data)
+  uint8_t  expect;               ///< Results which end the command
+  uint32_t timeout;              ///< Time to wait for the result in ms
+  void (*callback)(uint8_t result, void* ctx); ///< Completion function
+  void*    ctx;                  ///< Argument for callback
+} SIM900_Command_TypeDef;
+
+FIFO_DEFINE(SIM900_CmdFifo, SIM900_Command_TypeDef, SIM900_MAX_COMMANDS)
+
+/**
+ * @brief State of the module (one per instance of the application).
+ */
+struct SIM900_Context {
+  SIM900_Fifo_TypeDef rxFifo;        ///< RX FIFO
+  SIM900_Fifo_TypeDef txFifo;        ///< TX FIFO
+  SIM900_FrameFifo_TypeDef rxFrames; ///< Received frames
+  uint16_t frameStart; ///< RX FIFO index where current frame started (ISR only)
+  uint8_t  frameError; ///< Nonzero if current frame lost data (ISR only)
+  void (*frameCallback)(void); ///< Function called when a frame is received
+  FIFO_Policy_TypeDef txPolicy; ///< What to do when TX FIFO is full
+  uint32_t txTimeout;           ///< Waiting time for FIFO_POLICY_BLOCK
+  uint8_t  prevChar;            ///< Previously received character (ISR only)
+  volatile uint8_t promptWait;  ///< Nonzero while current command waits for the "> " prompt
+  SIM900_CmdFifo_TypeDef cmdQueue;   ///< Commands waiting to be sent
+  SIM900_Command_TypeDef cmdCurrent; ///< Command waiting for result
+  uint8_t cmdBusy;                   ///< Nonzero if cmdCurrent was sent
+  TIMER_Soft_TypeDef cmdTimer;       ///< Command timeout timer
+  uint8_t line[SIM900_FRAME_LEN];    ///< Currently handled line
+  void (*lineCallback)(char* line, uint8_t len); ///< Function for other lines
+};
+
+/**
+ * @brief Context of the board - statically initialized, so the
+ * FIFOs are ready before the interrupts are enabled.
+ */
+static SIM900_Context_TypeDef sim900Default = {
+  .rxFifo    = FIFO_INIT(sim900Default.rxFifo),
+  .txFifo    = FIFO_INIT(sim900Default.txFifo),
+  .rxFrames  = FIFO_INIT(sim900Default.rxFrames),
+  .cmdQueue  = FIFO_INIT(sim900Default.cmdQueue),
+  .txPolicy  = SIM900_TX_POLICY,
+  .txTimeout = SIM900_TX_TIMEOUT,
+};
+
+INSTANCE_POINTER(SIM900_Context_TypeDef, sim900, &sim900Default); ///< Current instance
+
+static void SIM900_TimeoutCallback(void* ctx);
+static void SIM900_CompleteCommand(uint8_t result);
 
 uint8_t SIM900_TxCallback(uint8_t* c);
 void    SIM900_RxCallback(uint8_t c);
+void    SIM900_RxBlockCallback(const uint8_t* data, uint16_t len);
+uint16_t SIM900_TxPeekCallback(uint8_t** data);
+void     SIM900_TxDoneCallback(uint16_t len);
 
 /**
  * @brief Initialize communication terminal interface.
@@ -71,34 +141,160 @@ void SIM900_Init(uint32_t baud) {
   // transmitted data
   SIM900_HAL_Init(baud, SIM900_RxCallback, SIM900_TxCallback);
 
-  // Initialize RX FIFO
-  rxFifo.buf = rxBuffer;
-  rxFifo.len = SIM900_BUF_LEN;
-  FIFO_Add(&rxFifo);
+#if SIM900_USE_TX_DMA && defined(SIM900_HAL_TX_DMA)
+  // send whole contiguous blocks of TX FIFO using DMA
+  SIM900_HAL_TxDmaInit(SIM900_TxPeekCallback, SIM900_TxDoneCallback);
+#endif
+
+#if SIM900_USE_RX_DMA && defined(SIM900_HAL_RX_DMA)
+  // receive data in blocks using circular DMA
+  SIM900_HAL_RxDmaInit(SIM900_RxBlockCallback);
+#endif
+
+  // FIFOs of the default context are statically initialized,
+  // so they are ready before the interrupts are enabled
+
+  TIMER_SoftTimerInit(&sim900->cmdTimer, SIM900_TimeoutCallback, sim900);
+
+}
+
+#if INSTANCE_CONTEXTS
+/**
+ * @brief Returns the size of a context, for allocating it.
+ * @return Size in bytes
+ */
+uint32_t SIM900_ContextSize(void) {
+
+  return sizeof(SIM900_Context_TypeDef);
+}
+/**
+ * @brief Initializes a context of another instance.
+ * @details The HAL isn't initialized - the instance exchanges data
+ * through the RX and TX callbacks. The command timer runs on the
+ * TIMER context current when a command is sent.
+ * @param context Context (SIM900_ContextSize bytes)
+ */
+void SIM900_ContextInit(SIM900_Context_TypeDef* context) {
+
+  memset(context, 0, sizeof(*context));
+
+  SIM900_Fifo_Init(&context->rxFifo);
+  SIM900_Fifo_Init(&context->txFifo);
+  SIM900_FrameFifo_Init(&context->rxFrames);
+  SIM900_CmdFifo_Init(&context->cmdQueue);
+
+  context->txPolicy  = SIM900_TX_POLICY;
+  context->txTimeout = SIM900_TX_TIMEOUT;
+
+  TIMER_SoftTimerInit(&context->cmdTimer, SIM900_TimeoutCallback, context);
+}
+/**
+ * @brief Switches the current instance of the calling thread.
+ * @param context Context (NULL - the default one)
+ */
+void SIM900_SetContext(SIM900_Context_TypeDef* context) {
+
+  sim900 = context ? context : &sim900Default;
+}
+#endif
+
+/**
+ * @brief Sets what happens when data doesn't fit in TX FIFO.
+ * @param policy Back-pressure policy
+ * @param timeout Maximum waiting time in ms (FIFO_POLICY_BLOCK only)
+ */
+void SIM900_SetTxPolicy(FIFO_Policy_TypeDef policy, uint32_t timeout) {
+
+  sim900->txPolicy  = policy;
+  sim900->txTimeout = timeout;
+}
+/**
+ * @brief Puts data in TX FIFO, waiting for free space.
+ * @param buf Data
+ * @param len Data length
+ * @return Number of bytes put in TX FIFO (less than len after timeout)
+ */
+static uint16_t SIM900_WriteBlocking(const uint8_t* buf, uint16_t len) {
+
+  uint16_t n = 0;
+  uint32_t start = TIMER_GetTime();
+
+  while (n < len) {
+
+    uint16_t space = FIFO_Space(&sim900->txFifo.fifo);
 
-  // Initialize TX FIFO
-  txFifo.buf = txBuffer;
-  txFifo.len = SIM900_BUF_LEN;
-  FIFO_Add(&txFifo);
+    if (space) {
+      if (space > len - n) {
+        space = len - n;
+      }
+      n += FIFO_PushBlock(&sim900->txFifo.fifo, buf + n, space);
+      SIM900_HAL_TxEnable(); // send it to free more space
+    } else if (TIMER_GetTime() - start >= sim900->txTimeout) {
+      FIFO_PushStats(&sim900->txFifo.fifo, 0, len - n); // the rest is lost
+      break;
+    }
+  }
 
+  return n;
 }
+/**
+ * @brief Send data to SIM900.
+ * @details The data is put in TX FIFO with one block copy and the
+ * transmitter is enabled once, instead of once per character.
+ * If the data doesn't fit, the TX policy decides what to do
+ * (see SIM900_SetTxPolicy). FIFO_POLICY_BLOCK can't be used
+ * from interrupts.
+ *
+ * @param buf Data
+ * @param len Data length
+ * @return Number of bytes accepted
+ */
+uint16_t SIM900_Write(const uint8_t* buf, uint16_t len) {
+
+  uint16_t space = FIFO_Space(&sim900->txFifo.fifo);
+  uint16_t n;
+
+  if (len > space) {
+
+    switch (sim900->txPolicy) {
+
+    case FIFO_POLICY_ERROR: // all or nothing
+      FIFO_PushStats(&sim900->txFifo.fifo, 0, len);
+      return 0;
 
+    case FIFO_POLICY_BLOCK:
+      return SIM900_WriteBlocking(buf, len);
+
+    case FIFO_POLICY_DROP_OLDEST:
+      // data being sent by DMA has to stay in place
+      SIM900_HAL_TxLock();
+      FIFO_DropOldest(&sim900->txFifo.fifo, SIM900_HAL_TxInFlight(), len - space);
+      SIM900_HAL_TxUnlock();
+      break;
+
+    default: // FIFO_POLICY_DROP_NEWEST - PushBlock drops what doesn't fit
+      break;
+    }
+  }
+
+  n = FIFO_PushBlock(&sim900->txFifo.fifo, buf, len); // Put data in TX buffer
+  SIM900_HAL_TxEnable(); // Enable low level transmitter
+
+  return n;
+}
 /**
  * @brief Send a char to USART2.
  * @details This function can be called in stubs.c _write
  * function in order for printf to work
  *
  * @param c Char to send.
+ * @retval 1 Char accepted
+ * @retval 0 Char dropped (TX FIFO full)
  */
-void SIM900_Putc(uint8_t c) {
-  // disable IRQ so it doesn't screw up FIFO count - leads to errors in transmission
-  SIM900_HAL_IrqDisable;
-
-  FIFO_Push(&txFifo,c); // Put data in TX buffer
-  SIM900_HAL_TxEnable();  // Enable low level transmitter
-
-  // enable IRQ again
-  SIM900_HAL_IrqEnable;
+uint8_t SIM900_Putc(uint8_t c) {
+  // No need to disable the IRQ - we are the only producer of txFifo
+  // and the TX interrupt is its only consumer.
+  return SIM900_Write(&c, 1);
 }
 /**
  * @brief Get a char from USART2
@@ -109,90 +305,407 @@ uint8_t SIM900_Getc(void) {
 
   uint8_t c;
 
-  while (FIFO_IsEmpty(&rxFifo) == 1); // wait until buffer is not empty
-  // buffer not empty => char was received
-
-  FIFO_Pop(&rxFifo,&c); // Get data from RX buffer
+  // Get data from RX buffer (wait until a char is received)
+  while (SIM900_Fifo_Pop(&sim900->rxFifo, &c) != 0);
 
   return c;
 }
 /**
- * @brief Get a complete frame from USART2 (nonblocking)
- * @param buf Buffer for data (data will be null terminated for easier string manipulation)
+ * @brief Get a complete frame from USART3 (nonblocking)
+ *
+ * @details Frames are indexed by the RX callback as they arrive,
+ * so this is a descriptor lookup followed by one block copy.
+ *
+ * @param buf Buffer for data (at least SIM900_FRAME_LEN bytes, data will be
+ * null terminated for easier string manipulation)
  * @param len Length not including terminator character
  * @retval 0 Received frame
  * @retval 1 No frame in buffer
- * @retval 2 Frame error
- * TODO Add maximum length checking so as not to overflow
+ * @retval 2 Frame error (part of the frame was lost)
+ * @retval 3 Frame too long (frame was dropped)
  */
 uint8_t SIM900_GetFrame(uint8_t* buf, uint8_t* len) {
 
-  uint8_t c;
+  SIM900_Frame_TypeDef frame;
   *len = 0; // zero out length variable
 
-  if (gotFrame) {
-    while (1) {
+  if (SIM900_FrameFifo_Pop(&sim900->rxFrames, &frame)) {
+    return 1; // no frame
+  }
 
-      // no more data and terminator wasn't reached => error
-      if (FIFO_IsEmpty(&rxFifo)) {
-        *len = 0;
-        println("Invalid frame");
-        return 2;
-      }
-      FIFO_Pop(&rxFifo, &c);
-      buf[(*len)++] = c;
-
-      // if end of frame
-      if (c == SIM900_TERMINATOR) {
-        (*len)--; // length without terminator character
-        buf[*len] = 0; // USART terminator character converted to NULL terminator
-
-        // SIM900 sends empty lines - eliminate them
-        if (*len == 1 && buf[0] == '\r') {
-          len = 0;
-          gotFrame--;
-          return 1;
-        }
+  // Skip data which doesn't belong to any frame (frames which didn't
+  // fit in the descriptor FIFO, empty lines)
+  int16_t skip = frame.start - sim900->rxFifo.fifo.tail;
+  if (skip > 0) {
+    FIFO_Consume(&sim900->rxFifo.fifo, skip);
+  }
 
-        break;
-      }
+  if (frame.error) {
+    FIFO_Consume(&sim900->rxFifo.fifo, frame.len);
+    LOG_WARN("GSM--> Invalid frame");
+    return 2;
+  }
 
-    }
-    gotFrame--;
-    return 0;
+  if (frame.len > SIM900_FRAME_LEN) {
+    FIFO_Consume(&sim900->rxFifo.fifo, frame.len);
+    LOG_WARN("GSM--> Frame too long");
+    return 3;
+  }
 
-  } else {
+  FIFO_PopBlock(&sim900->rxFifo.fifo, buf, frame.len); // copy whole frame at once
 
-    return 1;
-  }
+  *len = frame.len - 1; // length without terminator character
+  buf[*len] = 0; // USART terminator character converted to NULL terminator
 
+  return 0;
+}
+/**
+ * @brief Sets function called when a frame is received.
+ * @details The function is called from interrupt context, so it
+ * should only signal the main loop (e.g. post a scheduler event).
+ * @param callback Frame function (NULL - none, frames have to be polled)
+ */
+void SIM900_SetFrameCallback(void (*callback)(void)) {
+
+  sim900->frameCallback = callback;
+}
+/**
+ * @brief Checks if there are received frames waiting.
+ * @details Can be called with interrupts disabled.
+ * @retval 1 Frame is waiting
+ * @retval 0 No frames
+ */
+uint8_t SIM900_FramePending(void) {
+
+  return SIM900_FrameFifo_Count(&sim900->rxFrames) != 0;
 }
 /**
  * @brief Send a zero terminated string to SIm900.
  *
  * @param buf String to send.
+ * @return Number of bytes accepted (see SIM900_Write)
+ */
+uint16_t SIM900_PutFrame(char* buf) {
+
+  return SIM900_Write((uint8_t*)buf, strlen(buf));
+}
+
+/**
+ * @brief Sends the next queued command (if no command is in progress).
+ */
+static void SIM900_NextCommand(void) {
+
+  if (sim900->cmdBusy || SIM900_CmdFifo_Pop(&sim900->cmdQueue, &sim900->cmdCurrent)) {
+    return;
+  }
+
+  sim900->cmdBusy = 1;
+  sim900->promptWait = sim900->cmdCurrent.dataStart != 0; // before the modem can answer
+  TIMER_SoftTimerStart(&sim900->cmdTimer, sim900->cmdCurrent.timeout, 0);
+
+  if (SIM900_PutFrame(sim900->cmdCurrent.text) != strlen(sim900->cmdCurrent.text)) {
+    LOG_WARN("GSM--> Command not sent: %s", sim900->cmdCurrent.text);
+    SIM900_CompleteCommand(SIM900_RESULT_ERROR);
+  }
+}
+/**
+ * @brief Finishes current command and sends the next one.
+ * @param result Final result of command
+ */
+static void SIM900_CompleteCommand(uint8_t result) {
+
+  TIMER_SoftTimerStop(&sim900->cmdTimer);
+  sim900->cmdBusy = 0;
+  sim900->promptWait = 0;
+
+  if (sim900->cmdCurrent.callback) {
+    sim900->cmdCurrent.callback(result, sim900->cmdCurrent.ctx);
+  }
+
+  SIM900_NextCommand(); // no idle time between commands
+}
+/**
+ * @brief Called when the modem doesn't respond to a command in time.
+ * @details The command is completed on the instance which sent it,
+ * whichever instance is current when the timer expires.
+ * @param ctx Context of the instance
+ */
+static void SIM900_TimeoutCallback(void* ctx) {
+
+#if INSTANCE_CONTEXTS
+  SIM900_Context_TypeDef* current = sim900;
+  sim900 = ctx;
+#endif
+
+  LOG_WARN("GSM--> Command timeout: %s", sim900->cmdCurrent.text);
+  SIM900_CompleteCommand(SIM900_RESULT_TIMEOUT);
+
+#if INSTANCE_CONTEXTS
+  sim900 = current;
+#endif
+}
+/**
+ * @brief Checks if a line is a final result of a command.
+ * @param str Line (without CR LF)
+ * @return Result (0 - not a final result)
+ */
+static uint8_t SIM900_ParseResult(const char* str) {
+
+  if (!strcmp(str, "OK")) {
+    return SIM900_RESULT_OK;
+  } else if (!strcmp(str, "ERROR")) {
+    return SIM900_RESULT_ERROR;
+  } else if (!strncmp(str, "+CME ERROR", 10) || !strncmp(str, "+CMS ERROR", 10)) {
+    return SIM900_RESULT_CME;
+  } else if (!strcmp(str, ">")) {
+    return SIM900_RESULT_PROMPT;
+  }
+
+  return 0;
+}
+/**
+ * @brief Queues an AT command.
+ *
+ * @details The command is sent as soon as all commands queued before
+ * it are completed. It completes when one of the expected results or an
+ * error is received, or when the timeout passes. Other lines received
+ * meanwhile (responses, echo, URCs) go to the line callback.
+ *
+ * @param cmd Command with terminator (e.g. "AT\r")
+ * @param expect Results ending the command (SIM900_Result_TypeDef flags),
+ * errors always end the command
+ * @param timeout Time to wait for the result in ms
+ * @param callback Function called with the result (can be NULL)
+ * @param ctx Argument for callback
+ * @retval 0 Command queued
+ * @retval 1 Queue full
+ * @retval 2 Command too long
+ */
+uint8_t SIM900_SendCommand(const char* cmd, uint8_t expect, uint32_t timeout,
+    void (*callback)(uint8_t result, void* ctx), void* ctx) {
+
+  return SIM900_SendCommandData(cmd, 0, expect, timeout, callback, ctx);
+}
+/**
+ * @brief Queues an AT command which sends data after the prompt.
+ *
+ * @details When the modem sends the "> " prompt, the data is sent with
+ * Ctrl+Z appended and the command waits for the final result
+ * (e.g. AT+CMGS). Nothing else is sent between the command and the data.
+ *
+ * @param cmd Command with terminator
+ * @param data Data sent after prompt (NULL - none)
+ * @param expect Results ending the command (after the data is sent)
+ * @param timeout Time to wait for the prompt and for the result in ms
+ * @param callback Function called with the result (can be NULL)
+ * @param ctx Argument for callback
+ * @retval 0 Command queued
+ * @retval 1 Queue full
+ * @retval 2 Command too long
+ */
+uint8_t SIM900_SendCommandData(const char* cmd, const char* data,
+    uint8_t expect, uint32_t timeout,
+    void (*callback)(uint8_t result, void* ctx), void* ctx) {
+
+  SIM900_Command_TypeDef entry;
+  uint16_t cmdLen  = strlen(cmd);
+  uint16_t dataLen = data ? strlen(data) : 0;
+
+  // command, NULL, data, Ctrl+Z, NULL
+  if (cmdLen + 1 + (data ? dataLen + 2 : 0) > SIM900_CMD_LEN) {
+    LOG_ERROR("GSM--> Command too long");
+    return 2;
+  }
+
+  memcpy(entry.text, cmd, cmdLen + 1);
+  entry.dataStart = 0;
+  if (data) {
+    entry.dataStart = cmdLen + 1;
+    memcpy(&entry.text[entry.dataStart], data, dataLen);
+    entry.text[entry.dataStart + dataLen] = SIM900_DATA_END;
+    entry.text[entry.dataStart + dataLen + 1] = 0;
+  }
+  entry.expect   = expect;
+  entry.timeout  = timeout;
+  entry.callback = callback;
+  entry.ctx      = ctx;
+
+  if (SIM900_CmdFifo_Push(&sim900->cmdQueue, entry)) {
+    LOG_ERROR("GSM--> Command queue full");
+    return 1;
+  }
+
+  SIM900_NextCommand();
+
+  return 0;
+}
+/**
+ * @brief Sets function called for received lines, which aren't
+ * final results of commands (responses, echo, URCs).
+ * @param callback Line function (NULL - lines are dropped)
+ */
+void SIM900_SetLineCallback(void (*callback)(char* line, uint8_t len)) {
+
+  sim900->lineCallback = callback;
+}
+/**
+ * @brief Handles all lines received from SIM900.
+ * @details Call when a frame is received (see SIM900_SetFrameCallback).
+ * Command callbacks and line callback are called from here.
+ */
+void SIM900_Update(void) {
+
+  uint8_t len;
+  uint8_t ret;
+  uint8_t result;
+  uint8_t expect;
+
+  while ((ret = SIM900_GetFrame(sim900->line, &len)) != 1) {
+
+    if (ret) {
+      continue; // frame with errors - skip it
+    }
+
+    while (len && sim900->line[len - 1] == '\r') {
+      sim900->line[--len] = 0; // strip CR (echo ends with two of them)
+    }
+
+    result = SIM900_ParseResult((char*)sim900->line);
+
+    // command with data waits for prompt first
+    expect = sim900->cmdCurrent.dataStart ? SIM900_RESULT_PROMPT : sim900->cmdCurrent.expect;
+
+    if (sim900->cmdBusy && (result & (expect | SIM900_RESULT_ERROR | SIM900_RESULT_CME))) {
+
+      if (result == SIM900_RESULT_PROMPT && sim900->cmdCurrent.dataStart) {
+        // send data and wait for the final result
+        char* data = &sim900->cmdCurrent.text[sim900->cmdCurrent.dataStart];
+        sim900->cmdCurrent.dataStart = 0;
+        TIMER_SoftTimerStart(&sim900->cmdTimer, sim900->cmdCurrent.timeout, 0);
+        if (SIM900_PutFrame(data) != strlen(data)) {
+          SIM900_CompleteCommand(SIM900_RESULT_ERROR);
+        }
+        continue;
+      }
+
+      SIM900_CompleteCommand(result);
+
+    } else if (sim900->lineCallback && len) {
+      sim900->lineCallback((char*)sim900->line, len);
+    }
+  }
+}
+
+#if FIFO_STATS
+/**
+ * @brief Get statistics of the SIM900 FIFOs.
+ * @param rx Returns RX FIFO statistics
+ * @param tx Returns TX FIFO statistics
  */
-void SIM900_PutFrame(char* buf) {
+void SIM900_GetStats(FIFO_Stats_TypeDef* rx, FIFO_Stats_TypeDef* tx) {
+
+  FIFO_GetStats(&sim900->rxFifo.fifo, rx);
+  FIFO_GetStats(&sim900->txFifo.fifo, tx);
+}
+#endif
+/**
+ * @brief Indexes a frame ending at the current RX FIFO head.
+ * @param last Character received before the terminator
+ */
+static void SIM900_EndFrame(uint8_t last) {
+
+  SIM900_Frame_TypeDef frame;
+  uint16_t head = sim900->rxFifo.fifo.head;
 
-  uint16_t len = strlen(buf);
+  frame.start = sim900->frameStart;
+  frame.len   = head - sim900->frameStart;
+  frame.error = sim900->frameError;
 
-  for(int i = 0; i < len; i++) {
-    SIM900_Putc(buf[i]);
+#if LOG_DEFERRED // only records can be written from interrupts
+  if (sim900->frameError) {
+    LOG_WARN("GSM--> RX overflow, %u byte frame lost", (unsigned)frame.len);
+  }
+#endif
+
+  // SIM900 sends empty lines - don't index them,
+  // GetFrame skips their data without copying
+  if (frame.len != 2 || last != '\r' || frame.error) {
+    // If the descriptor FIFO is full, the frame is skipped by GetFrame
+    SIM900_FrameFifo_Push(&sim900->rxFrames, frame);
+
+    if (sim900->frameCallback) {
+      sim900->frameCallback();
+    }
   }
 
+  sim900->frameStart = head; // next frame starts here
+  sim900->frameError = 0;
 }
+/**
+ * @brief Checks if current frame is the "> " prompt.
+ * @details The prompt isn't followed by a terminator, so it has
+ * to be detected separately to end the frame. This is done only
+ * while the current command waits for it and only once, so lines
+ * starting with "> " (e.g. text of a read SMS) aren't split.
+ * @param prev Character received before c
+ * @param c Last received character
+ * @retval 1 Frame is the prompt
+ * @retval 0 Other data
+ */
+static uint8_t SIM900_IsPrompt(uint8_t prev, uint8_t c) {
+
+  if (sim900->promptWait && prev == '>' && c == ' ' &&
+      (uint16_t)(sim900->rxFifo.fifo.head - sim900->frameStart) == 2) {
+    sim900->promptWait = 0; // one prompt per command
+    return 1;
+  }
 
+  return 0;
+}
 /**
- * @brief Callback for receiving data from PC.
+ * @brief Callback for receiving data from SIM900.
  * @param c Data sent from lower layer software.
  */
 void SIM900_RxCallback(uint8_t c) {
 
-  uint8_t res = FIFO_Push(&rxFifo, c); // Put data in RX buffer
+  if (SIM900_Fifo_Push(&sim900->rxFifo, c)) { // Put data in RX buffer
+    sim900->frameError = 1; // overflow - frame is incomplete
+  }
 
-  // Checking res to ensure no buffer overflow occurred
-  if ((c == SIM900_TERMINATOR) && (res == 0)) {
-    gotFrame++;
+  if (c == SIM900_TERMINATOR || SIM900_IsPrompt(sim900->prevChar, c)) {
+    SIM900_EndFrame(sim900->prevChar);
+  }
+
+  sim900->prevChar = c;
+}
+/**
+ * @brief Callback for receiving blocks of data from SIM900 (DMA mode).
+ * @details Data is copied to RX FIFO one frame at a time,
+ * terminators are found with memchr. The prompt can only be
+ * the last data of a block (the modem waits for input after it).
+ * @param data Received data
+ * @param len Data length
+ */
+void SIM900_RxBlockCallback(const uint8_t* data, uint16_t len) {
+
+  while (len) {
+
+    const uint8_t* end = memchr(data, SIM900_TERMINATOR, len);
+    uint16_t n = end ? (end - data + 1) : len; // up to terminator or all
+
+    if (FIFO_PushBlock(&sim900->rxFifo.fifo, data, n) != n) {
+      sim900->frameError = 1; // overflow - frame is incomplete
+    }
+
+    uint8_t prev = n > 1 ? data[n - 2] : sim900->prevChar;
+
+    if (end || SIM900_IsPrompt(prev, data[n - 1])) {
+      SIM900_EndFrame(prev);
+    }
+
+    sim900->prevChar = data[n - 1];
+    data += n;
+    len  -= n;
   }
 }
 /**
@@ -203,13 +716,32 @@ void SIM900_RxCallback(uint8_t c) {
  */
 uint8_t SIM900_TxCallback(uint8_t* c) {
 
-  if (FIFO_Pop(&txFifo, c) == 0) { // If buffer not empty
+  if (SIM900_Fifo_Pop(&sim900->txFifo, c) == 0) { // If buffer not empty
     return 1;
   } else {
     return 0;
   }
 
 }
+/**
+ * @brief Callback for DMA transmission - returns data to send.
+ * @details The data stays in TX FIFO until SIM900_TxDoneCallback
+ * is called, so the DMA can read it in place.
+ * @param data Returns pointer to data
+ * @return Number of contiguous bytes to send (0 - nothing to send)
+ */
+uint16_t SIM900_TxPeekCallback(uint8_t** data) {
+
+  return FIFO_PeekContiguous(&sim900->txFifo.fifo, data);
+}
+/**
+ * @brief Callback for DMA transmission - releases sent data.
+ * @param len Number of bytes sent
+ */
+void SIM900_TxDoneCallback(uint16_t len) {
+
+  FIFO_Consume(&sim900->txFifo.fifo, len);
+}
 
 /**
  * @}
@@ -21,6 +21,8 @@
 
 #include <comm.h>
 
+#define COMM_WRITE_CHUNK 0x8000 ///< Maximum length for COMM_Write
+
 /*
  * These stubs should be expanded!!!
  * TODO Check params and implement minimal
@@ -65,8 +67,23 @@ int _read(int fileHandle, char *buf, int len) {
 int _write(int fileHandle, char *buf, int len) {
 
 	int i;
-	for (i=0; i<len; i++) {
-		COMM_Putc((uint8_t)buf[i]);
+
+	if (COMM_GetMode() == COMM_MODE_BINARY) { // output goes in text packets
+		for (i=0; i<len; i+=COMM_PACKET_LEN) {
+			// packets are queued whole or not at all - after a dropped one
+			// the rest is dropped too, so the PC gets the start of the text
+			if (COMM_PutPacket(COMM_PACKET_TEXT, (uint8_t*)&buf[i],
+					(len - i < COMM_PACKET_LEN) ? len - i : COMM_PACKET_LEN)) {
+				break;
+			}
+		}
+		return len; // dropped data is counted in TX FIFO statistics, like in text mode
+	}
+
+	// whole buffer at once - one FIFO copy and one transmitter enable
+	for (i=0; i<len; i+=COMM_WRITE_CHUNK) {
+		COMM_Write((uint8_t*)&buf[i],
+				(len - i < COMM_WRITE_CHUNK) ? len - i : COMM_WRITE_CHUNK);
 	}
 
 	return len;
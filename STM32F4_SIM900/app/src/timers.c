@@ -20,43 +20,58 @@
  */
 
 #include <timers.h>
-#include <stdio.h>
 #include <systick.h>
-#include <timer14.h>
-
-#ifndef DEBUG
-  #define DEBUG
-#endif
-
-#ifdef DEBUG
-  #define print(str, args...) printf("LED--> "str"%s",##args,"\r")
-  #define println(str, args...) printf("LED--> "str"%s",##args,"\r\n")
-#else
-  #define print(str, args...) (void)0
-  #define println(str, args...) (void)0
-#endif
+#include <timer2.h>
+#include <log.h>
+#include <string.h>
+#include <instance_hal.h>
 
 /**
  * @addtogroup TIMER
  * @{
  */
 
-#define MAX_SOFT_TIMERS 10 ///< Maximum number of soft timers.
+#define TIMER_WHEEL_SIZE 256 ///< Number of timer wheel slots (power of two)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SIZE - 1) ///< Mask for slot index
 
-static uint8_t softTimerCount; ///< Count number of soft timers
+#define MAX_SOFT_TIMERS 10 ///< Maximum number of timers added with TIMER_AddSoftTimer.
 
 /**
- * @brief Soft timer structure.
+ * @brief Timer added with TIMER_AddSoftTimer.
  */
 typedef struct {
-  uint8_t id;                     ///< Timer ID
-  uint32_t value;                 ///< Current count value
+  TIMER_Soft_TypeDef timer;       ///< Wheel timer
   uint32_t max;                   ///< Overflow value
-  uint8_t active;                 ///< Is timer active?
+  uint32_t remaining;             ///< Time left when paused
   void (*overflowCallback)(void); ///< Function called on overflow event
-} TIMER_Soft_TypeDef;
+} TIMER_Legacy_TypeDef;
+
+/**
+ * @brief State of the module (one per instance of the application).
+ *
+ * @details The timer wheel: each slot holds a list of timers, which
+ * expire at a time equal to the slot index modulo TIMER_WHEEL_SIZE.
+ * Timers further than one revolution away simply stay in their slot
+ * for more rounds. Starting and stopping a timer is O(1), each tick
+ * visits only one slot.
+ */
+struct TIMER_Context {
+  TIMER_Soft_TypeDef* wheel[TIMER_WHEEL_SIZE]; ///< Wheel slots
+  TIMER_Soft_TypeDef* expired; ///< Timers expired in current tick
+  uint32_t wheelTime;          ///< Time up to which the wheel was processed
+  volatile uint32_t nextExpiry; ///< Earliest expiry time (or end of wheel revolution)
+  void (*expiryCallback)(void); ///< Function called from interrupt when timers are due
+  uint32_t idleSleeps;         ///< Number of times the main loop went to sleep
+  uint32_t idleTicks;          ///< Ticks of sleep requested in total
+  uint8_t softTimerCount;      ///< Count number of soft timers
+  TIMER_Legacy_TypeDef softTimers[MAX_SOFT_TIMERS]; ///< Array of soft timers
+};
+
+static TIMER_Context_TypeDef timersDefault; ///< Context of the board
 
-static TIMER_Soft_TypeDef softTimers[MAX_SOFT_TIMERS]; ///< Array of soft timers
+INSTANCE_POINTER(TIMER_Context_TypeDef, timers, &timersDefault); ///< Current instance
+
+static void TIMER_TickCallback(void);
 
 /**
  * @brief Initiate the system time interrupt with a given frequency.
@@ -66,10 +81,47 @@ void TIMER_Init(uint32_t freq) {
 
   SYSTICK_Init(freq); // initialize sysTick for ms count
 
-  // initialize TIMER14 as microsecond counter
-  TIMER14_Init();
+  // initialize TIMER2 as free-running microsecond counter
+  TIMER2_Init();
+
+  timers->nextExpiry = SYSTICK_GetTime() + TIMER_WHEEL_SIZE;
+  SYSTICK_SetTickCallback(TIMER_TickCallback);
+
+}
+
+#if INSTANCE_CONTEXTS
+/**
+ * @brief Returns the size of a context, for allocating it.
+ * @return Size in bytes
+ */
+uint32_t TIMER_ContextSize(void) {
 
+  return sizeof(TIMER_Context_TypeDef);
 }
+/**
+ * @brief Initializes a context of another instance.
+ * @details The instance shares the system time, but has its own
+ * timers, which run when it calls TIMER_SoftTimersUpdate. The SysTick
+ * interrupt checks the default context only, so the expiry callback
+ * isn't called for other instances.
+ * @param context Context (TIMER_ContextSize bytes)
+ */
+void TIMER_ContextInit(TIMER_Context_TypeDef* context) {
+
+  memset(context, 0, sizeof(*context));
+
+  context->wheelTime  = SYSTICK_GetTime();
+  context->nextExpiry = context->wheelTime + TIMER_WHEEL_SIZE;
+}
+/**
+ * @brief Switches the current instance of the calling thread.
+ * @param context Context (NULL - the default one)
+ */
+void TIMER_SetContext(TIMER_Context_TypeDef* context) {
+
+  timers = context ? context : &timersDefault;
+}
+#endif
 /**
  * @brief Returns the system time.
  * @return System time
@@ -77,6 +129,13 @@ void TIMER_Init(uint32_t freq) {
 uint32_t TIMER_GetTime(void) {
   return SYSTICK_GetTime();
 }
+/**
+ * @brief Returns the microsecond time (for measuring short intervals).
+ * @return Time in us (overflows after about 71 minutes)
+ */
+uint32_t TIMER_GetTimeUS(void) {
+  return TIMER2_GetTime();
+}
 
 /**
  * @brief Delay function.
@@ -107,18 +166,11 @@ void TIMER_Delay(uint32_t ms) {
  */
 void TIMER_DelayUS(uint32_t us) {
 
-  uint32_t startTime = TIMER14_GetTime();
-  uint32_t currentTime;
+  uint32_t startTime = TIMER2_GetTime();
 
-  while (1) { // Delay
-    currentTime = TIMER14_GetTime();
-    if ((currentTime >= startTime) && (currentTime-startTime > us)) {
-      break;
-    }
-    // account for system timer overflow
-    if ((currentTime < startTime) && (UINT32_MAX-startTime + currentTime > us)) {
-      break;
-    }
+  // unsigned difference accounts for counter overflow
+  while (TIMER2_GetTime() - startTime <= us) {
+    ; // Delay
   }
 }
 
@@ -146,6 +198,115 @@ uint8_t TIMER_DelayTimer(uint32_t ms, uint32_t startTime) {
 
 }
 
+/**
+ * @brief Links a timer into a list.
+ * @param list List head
+ * @param timer Timer
+ */
+static void TIMER_Link(TIMER_Soft_TypeDef** list, TIMER_Soft_TypeDef* timer) {
+
+  timer->next  = *list;
+  timer->pprev = list;
+
+  if (*list) {
+    (*list)->pprev = &timer->next;
+  }
+  *list = timer;
+}
+/**
+ * @brief Unlinks a timer from the list it is on.
+ * @param timer Timer
+ */
+static void TIMER_Unlink(TIMER_Soft_TypeDef* timer) {
+
+  *timer->pprev = timer->next;
+
+  if (timer->next) {
+    timer->next->pprev = timer->pprev;
+  }
+  timer->next  = NULL;
+  timer->pprev = NULL;
+}
+/**
+ * @brief Initializes a soft timer.
+ *
+ * @details The timer structure is provided by the caller, so there
+ * is no limit on the number of timers.
+ *
+ * @param timer Timer structure
+ * @param callback Function called on expiry
+ * @param ctx Argument passed to callback
+ */
+void TIMER_SoftTimerInit(TIMER_Soft_TypeDef* timer,
+    void (*callback)(void*), void* ctx) {
+
+  timer->next     = NULL;
+  timer->pprev    = NULL;
+  timer->expiry   = 0;
+  timer->period   = 0;
+  timer->callback = callback;
+  timer->ctx      = ctx;
+}
+/**
+ * @brief Starts (or restarts) a soft timer.
+ * @param timer Timer structure
+ * @param delay Time to first expiry in ms
+ * @param period Period of following expiries in ms (0 - one-shot timer)
+ */
+void TIMER_SoftTimerStart(TIMER_Soft_TypeDef* timer, uint32_t delay,
+    uint32_t period) {
+
+  if (timer->pprev) {
+    TIMER_Unlink(timer); // restart
+  }
+
+  if (delay == 0) {
+    delay = 1; // expire on next tick
+  }
+
+  timer->expiry = SYSTICK_GetTime() + delay;
+  timer->period = period;
+
+  TIMER_Link(&timers->wheel[timer->expiry & TIMER_WHEEL_MASK], timer);
+
+  if ((int32_t)(timer->expiry - timers->nextExpiry) < 0) {
+    timers->nextExpiry = timer->expiry; // expires before all other timers
+  }
+}
+/**
+ * @brief Stops a soft timer (callback won't be called).
+ * @details The next expiry isn't updated - if this was the earliest
+ * timer, the wheel is scanned again at its expiry time.
+ * @param timer Timer structure
+ */
+void TIMER_SoftTimerStop(TIMER_Soft_TypeDef* timer) {
+
+  if (timer->pprev) {
+    TIMER_Unlink(timer);
+  }
+}
+/**
+ * @brief Checks if soft timer is running.
+ * @param timer Timer structure
+ * @retval 1 Timer is running
+ * @retval 0 Timer is stopped (or one-shot timer expired)
+ */
+uint8_t TIMER_SoftTimerIsActive(TIMER_Soft_TypeDef* timer) {
+
+  return timer->pprev != NULL;
+}
+/**
+ * @brief Calls the overflow function of a timer added with TIMER_AddSoftTimer
+ * @param ctx Timer
+ */
+static void TIMER_LegacyCallback(void* ctx) {
+
+  TIMER_Legacy_TypeDef* legacy = ctx;
+
+  if (legacy->overflowCallback != NULL) {
+    legacy->overflowCallback(); // call the overflow function
+  }
+}
 /**
  * @brief Adds a soft timer
  * @param maxVal Overflow value of timer
@@ -155,20 +316,21 @@ uint8_t TIMER_DelayTimer(uint32_t ms, uint32_t startTime) {
  */
 int8_t TIMER_AddSoftTimer(uint32_t maxVal, void (*fun)(void)) {
 
-  if (softTimerCount > MAX_SOFT_TIMERS) {
-    println("TIMERS: Reached maximum number of timers!");
+  if (timers->softTimerCount >= MAX_SOFT_TIMERS) {
+    LOG_ERROR("TIMER--> Reached maximum number of timers!");
     return -1;
   }
 
-  softTimers[softTimerCount].id = softTimerCount;
-  softTimers[softTimerCount].overflowCallback = fun;
-  softTimers[softTimerCount].max = maxVal;
-  softTimers[softTimerCount].value = 0;
-  softTimers[softTimerCount].active = 0; // inactive on startup
+  TIMER_Legacy_TypeDef* legacy = &timers->softTimers[timers->softTimerCount];
+
+  TIMER_SoftTimerInit(&legacy->timer, TIMER_LegacyCallback, legacy);
+  legacy->overflowCallback = fun;
+  legacy->max = maxVal;
+  legacy->remaining = maxVal; // inactive on startup
 
-  softTimerCount++;
+  timers->softTimerCount++;
 
-  return (softTimerCount - 1);
+  return (timers->softTimerCount - 1);
 }
 
 /**
@@ -177,8 +339,9 @@ int8_t TIMER_AddSoftTimer(uint32_t maxVal, void (*fun)(void)) {
  */
 void TIMER_StartSoftTimer(uint8_t id) {
 
-  softTimers[id].value = 0;
-  softTimers[id].active = 1; // start timer
+  TIMER_Legacy_TypeDef* legacy = &timers->softTimers[id];
+
+  TIMER_SoftTimerStart(&legacy->timer, legacy->max, legacy->max);
 }
 /**
  * @brief Pauses given timer (current count value unchanged)
@@ -186,7 +349,12 @@ void TIMER_StartSoftTimer(uint8_t id) {
  */
 void TIMER_PauseSoftTimer(uint8_t id) {
 
-  softTimers[id].active = 0; // pause timer
+  TIMER_Soft_TypeDef* timer = &timers->softTimers[id].timer;
+
+  if (TIMER_SoftTimerIsActive(timer)) {
+    timers->softTimers[id].remaining = timer->expiry - SYSTICK_GetTime();
+    TIMER_SoftTimerStop(timer); // pause timer
+  }
 }
 /**
  * @brief Resumes a timer (starts counting from last value).
@@ -194,50 +362,148 @@ void TIMER_PauseSoftTimer(uint8_t id) {
  */
 void TIMER_ResumeSoftTimer(uint8_t id) {
 
-  softTimers[id].active = 1; // start timer
+  TIMER_Legacy_TypeDef* legacy = &timers->softTimers[id];
+
+  TIMER_SoftTimerStart(&legacy->timer, legacy->remaining, legacy->max);
 }
 /**
- * @brief Updates all the timers and calls the overflow functions as
- * necessary
+ * @brief Finds the time of the earliest soft timer expiry.
  *
- * @details This function should be called periodically in the main
- * loop of the program.
+ * @details Slots are checked in expiry order, so this stops at the
+ * first timer found. Only one wheel revolution is checked - if no timer
+ * expires within it, the time of the end of the revolution is returned.
+ *
+ * @return System time of next expiry
  */
-void TIMER_SoftTimersUpdate(void) {
+static uint32_t TIMER_NextExpiry(void) {
 
-  static uint32_t prevVal;
-  uint32_t delta;
-  uint32_t sysTicks = SYSTICK_GetTime();
+  uint32_t time;
 
-  if (sysTicks >= prevVal) {
+  for (time = timers->wheelTime + 1; time != timers->wheelTime + TIMER_WHEEL_SIZE; time++) {
 
-    delta = sysTicks - prevVal; // How much time passed from previous run
+    TIMER_Soft_TypeDef* timer = timers->wheel[time & TIMER_WHEEL_MASK];
+
+    while (timer) {
+      if (timer->expiry == time) {
+        return time;
+      }
+      timer = timer->next;
+    }
+  }
 
-  } else { // if overflow occurs
+  return time;
+}
+/**
+ * @brief Sleeps until the next soft timer expires or an interrupt occurs.
+ *
+ * @details Call this in the main loop after TIMER_SoftTimersUpdate,
+ * when there is nothing else to do. Work signalled by interrupts
+ * (e.g. received frames) is checked by workPending with interrupts
+ * disabled, so an interrupt arriving just before sleeping isn't missed.
+ *
+ * @param workPending Returns nonzero if there is work to do (can be NULL)
+ */
+void TIMER_Idle(uint8_t (*workPending)(void)) {
 
-    // the difference is the value that prevVal
-    // has to UINT32_MAX + the new number of sysTicks
-    delta = UINT32_MAX - prevVal + sysTicks;
+  int32_t ticks = timers->nextExpiry - SYSTICK_GetTime();
 
+  if (ticks <= 0) {
+    return; // timers are due - update them first
   }
 
-  prevVal += delta; // update time for the function
+  timers->idleSleeps++;
+  timers->idleTicks += ticks;
 
-  uint8_t i;
-  for (i = 0; i < softTimerCount; i++) {
+  SYSTICK_Sleep(ticks, workPending);
+}
+/**
+ * @brief Returns idle statistics, for checking how often the core
+ * wakes up (each sleep ends with a wakeup).
+ * @param sleeps Number of times TIMER_Idle went to sleep
+ * @param ticks Ticks of sleep requested in total (sleeps can end
+ * earlier on interrupts)
+ */
+void TIMER_GetIdleStats(uint32_t* sleeps, uint32_t* ticks) {
+
+  *sleeps = timers->idleSleeps;
+  *ticks  = timers->idleTicks;
+}
+/**
+ * @brief Updates all the timers and calls the expiry functions as
+ * necessary
+ *
+ * @details This function should be called periodically in the main
+ * loop of the program. Every tick since the previous call visits one
+ * wheel slot, so the cost doesn't depend on the number of timers.
+ * The wheel is scanned for the next expiry only when the earliest
+ * timer expires (or was stopped), not on every tick.
+ */
+void TIMER_SoftTimersUpdate(void) {
+
+  uint32_t now = SYSTICK_GetTime();
+  TIMER_Soft_TypeDef* timer;
+
+  while (timers->wheelTime != now) {
+
+    timers->wheelTime++;
+
+    // Move timers expiring now to the expired list first, so callbacks
+    // can freely start and stop any timer (including the expired ones)
+    timer = timers->wheel[timers->wheelTime & TIMER_WHEEL_MASK];
+
+    while (timer) {
+      TIMER_Soft_TypeDef* next = timer->next;
+      if (timer->expiry == timers->wheelTime) {
+        TIMER_Unlink(timer);
+        TIMER_Link(&timers->expired, timer);
+      }
+      timer = next;
+    }
+
+    while ((timer = timers->expired) != NULL) {
 
-    if (softTimers[i].active == 1) {
+      TIMER_Unlink(timer);
 
-      softTimers[i].value += delta; // update active timer values
+      if (timer->period) { // periodic timer - schedule next expiry
+        timer->expiry += timer->period;
+        TIMER_Link(&timers->wheel[timer->expiry & TIMER_WHEEL_MASK], timer);
+      }
 
-      if (softTimers[i].value >= softTimers[i].max) { // if overflow
-        softTimers[i].value = 0; // zero out timer
-        if (softTimers[i].overflowCallback != NULL) {
-          softTimers[i].overflowCallback(); // call the overflow function
-        }
+      if (timer->callback != NULL) {
+        timer->callback(timer->ctx); // call the expiry function
       }
     }
   }
+
+  // nextExpiry never lies after the earliest timer - starting a timer
+  // moves it back, stopping one leaves it early - so the wheel is
+  // scanned again only after it was reached
+  if ((int32_t)(now - timers->nextExpiry) >= 0) {
+    timers->nextExpiry = TIMER_NextExpiry();
+  }
+}
+/**
+ * @brief Sets function called when soft timers are due.
+ *
+ * @details The function is called from the SysTick interrupt, when the
+ * earliest timer expires, and should schedule TIMER_SoftTimersUpdate
+ * (e.g. post a scheduler event). It is called on every tick until
+ * the update is done.
+ *
+ * @param callback Expiry function (NULL - none, timers have to be polled)
+ */
+void TIMER_SetExpiryCallback(void (*callback)(void)) {
+
+  timers->expiryCallback = callback;
+}
+/**
+ * @brief Checks if soft timers are due (SysTick interrupt context).
+ */
+static void TIMER_TickCallback(void) {
+
+  if (timers->expiryCallback && (int32_t)(SYSTICK_GetTime() - timers->nextExpiry) >= 0) {
+    timers->expiryCallback();
+  }
 }
 
 /**
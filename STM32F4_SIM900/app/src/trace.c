@@ -0,0 +1,238 @@
+/**
+ * @file:   trace.c
+ * @brief:  Capture of UART traffic
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <trace.h>
+#include <fifo.h>
+#include <comm.h>
+#include <cobs.h>
+#include <timers.h>
+#include <string.h>
+
+/**
+ * @addtogroup TRACE
+ * @{
+ */
+
+#ifndef TRACE_BUF_LEN
+  #define TRACE_BUF_LEN 8192 ///< Size of the record ring (power of two)
+#endif
+#define TRACE_HEADER_MAX 6 ///< Channel/length byte and up to 5 bytes of time
+/// Maximum number of bytes a packet takes in COMM TX FIFO
+#define TRACE_PACKET_MAX (COBS_MAX_ENCODED(COMM_PACKET_LEN + 4) + 2)
+
+FIFO_DEFINE(TRACE_Fifo, uint8_t, TRACE_BUF_LEN)
+
+static TRACE_Fifo_TypeDef records = FIFO_INIT(records); ///< Ring of records
+static volatile uint8_t channels; ///< Recorded channels (bit mask)
+static TRACE_Mode_TypeDef mode;   ///< Current mode
+static uint8_t  spool;            ///< Nonzero - records are sent to PC
+static uint32_t lastTime;         ///< Time of last record in us
+static uint32_t recorded;         ///< Bytes recorded since start
+static uint32_t dropped;          ///< Bytes lost since start (ring full)
+static void (*traceCallback)(void); ///< Function called when a record is written (spooling)
+
+/**
+ * @brief Sets function called when records are waiting to be sent
+ * (e.g. posting a task calling TRACE_Flush).
+ * @param callback Callback (called from interrupts)
+ */
+void TRACE_SetCallback(void (*callback)(void)) {
+
+  traceCallback = callback;
+}
+/**
+ * @brief Checks whether there are records waiting to be sent.
+ * @retval 1 Records waiting
+ * @retval 0 Nothing to send (or RAM mode)
+ */
+uint8_t TRACE_Pending(void) {
+
+  return spool && !FIFO_IsEmpty(&records.fifo);
+}
+/**
+ * @brief Returns capture statistics.
+ * @param rec Returns number of bytes recorded since start
+ * @param lost Returns number of bytes lost since start (ring full)
+ */
+void TRACE_GetStats(uint32_t* rec, uint32_t* lost) {
+
+  *rec  = recorded;
+  *lost = dropped;
+}
+/**
+ * @brief Records UART data (HAL capture function).
+ * @details Called from the UART interrupts. If the ring is full,
+ * data is lost, but the time of the next record still counts from
+ * the last recorded one, so the timing of the trace stays correct.
+ * Each record is pushed with one block copy, so TRACE_Flush never
+ * sees a header without its data.
+ * @param channel Channel
+ * @param data Data
+ * @param len Data length
+ */
+static void TRACE_Record(uint8_t channel, const uint8_t* data, uint16_t len) {
+
+  uint8_t record[TRACE_HEADER_MAX + TRACE_MAX_DATA];
+  uint8_t headerLen;
+  uint8_t n;
+  uint32_t delta;
+
+  if (!(channels & (1 << channel))) {
+    return;
+  }
+
+  uint32_t state = TRACE_HAL_Lock(); // all UART interrupts record
+  uint32_t now = TIMER_GetTimeUS();
+
+  while (len) {
+
+    n = len > TRACE_MAX_DATA ? TRACE_MAX_DATA : len;
+    delta = now - lastTime; // 0 for the rest of a split block
+
+    record[0] = (channel << 6) | (n - 1);
+    headerLen = 1;
+    do {
+      record[headerLen++] = (delta & 0x7f) | (delta > 0x7f ? 0x80 : 0);
+      delta >>= 7;
+    } while (delta);
+
+    if (FIFO_Space(&records.fifo) < headerLen + n) {
+      dropped += len; // rest of the block is lost
+      break;
+    }
+
+    memcpy(&record[headerLen], data, n);
+    FIFO_PushBlock(&records.fifo, record, headerLen + n); // head moves once
+    lastTime  = now;
+    recorded += n;
+    data     += n;
+    len      -= n;
+  }
+
+  TRACE_HAL_Unlock(state);
+
+  if (spool && traceCallback) {
+    traceCallback();
+  }
+}
+/**
+ * @brief Starts capture.
+ * @details Clears the ring and the statistics. In TRACE_MODE_COMM
+ * USART2 TX isn't recorded (the trace itself goes there).
+ * @param newMode Capture mode
+ * @param mask Recorded channels (bit mask of TRACE_HAL channels)
+ */
+void TRACE_Start(TRACE_Mode_TypeDef newMode, uint8_t mask) {
+
+  TRACE_HAL_SetCallback(TRACE_Record);
+
+  uint32_t state = TRACE_HAL_Lock();
+
+  FIFO_Consume(&records.fifo, TRACE_Fifo_Count(&records));
+  lastTime = TIMER_GetTimeUS();
+  recorded = 0;
+  dropped  = 0;
+  mode     = newMode;
+  spool    = (newMode == TRACE_MODE_COMM);
+
+  if (newMode == TRACE_MODE_COMM) {
+    mask &= ~(1 << TRACE_HAL_UART2_TX);
+  }
+
+  channels = (newMode == TRACE_MODE_OFF) ? 0 : mask;
+
+  TRACE_HAL_Unlock(state);
+}
+/**
+ * @brief Stops capture.
+ * @details Records already captured in TRACE_MODE_COMM are still sent,
+ * in TRACE_MODE_RAM they stay in RAM until TRACE_Send.
+ */
+void TRACE_Stop(void) {
+
+  channels = 0;
+  mode = TRACE_MODE_OFF;
+}
+/**
+ * @brief Stops capture and sends the captured records to PC.
+ */
+void TRACE_Send(void) {
+
+  TRACE_Stop();
+  spool = 1;
+
+  if (traceCallback) {
+    traceCallback();
+  }
+}
+/**
+ * @brief Sends waiting records to PC.
+ * @details Records are packed in COMM_PACKET_TRACE packets (whole records
+ * only) while they fit in COMM TX FIFO, the same way as log records
+ * (see LOG_Flush). Call from the main loop.
+ * @retval 0 All records sent
+ * @retval 1 Some records wait for free space in COMM TX FIFO
+ */
+uint8_t TRACE_Flush(void) {
+
+  uint8_t packet[COMM_PACKET_LEN];
+  uint8_t len = 0;
+  uint8_t recLen;
+  uint8_t dataLen;
+  uint16_t tail;
+
+  while (TRACE_Pending()) {
+
+    FIFO_BARRIER(); // don't read data before checking head
+    tail = records.fifo.tail;
+    dataLen = (records.storage[tail & (TRACE_BUF_LEN - 1)] & 0x3f) + 1;
+    recLen = 1;
+    while (records.storage[(uint16_t)(tail + recLen++) & (TRACE_BUF_LEN - 1)] & 0x80) {
+      // skip time
+    }
+    recLen += dataLen;
+
+    if (TRACE_Fifo_Count(&records) < recLen) {
+      break; // not a whole record (can't happen, records are pushed whole)
+    }
+
+    if (len + recLen > COMM_PACKET_LEN) { // send full packet first
+      COMM_PutPacket(COMM_PACKET_TRACE, packet, len);
+      len = 0;
+    }
+
+    if (len == 0 && COMM_TxSpace() < TRACE_PACKET_MAX) {
+      return 1; // PC link is busy
+    }
+
+    len += FIFO_PopBlock(&records.fifo, packet + len, recLen);
+  }
+
+  if (len) {
+    COMM_PutPacket(COMM_PACKET_TRACE, packet, len);
+  }
+
+  if (mode != TRACE_MODE_COMM) {
+    spool = 0; // everything sent, RAM mode keeps records again
+  }
+
+  return 0;
+}
+
+/**
+ * @}
+ */
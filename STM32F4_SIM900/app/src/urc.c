@@ -0,0 +1,155 @@
+/**
+ * @file:   urc.c
+ * @brief:  Unsolicited result code dispatcher.
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ * @details Lines received from the modem are matched against a table
+ * of prefixes (e.g. "RING", "+CMTI:") and passed to the handler
+ * of the longest matching prefix. The table is compiled into a trie
+ * once, so matching costs O(length of prefix), whatever the number
+ * of handlers.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <urc.h>
+#include <log.h>
+
+/**
+ * @addtogroup URC
+ * @{
+ */
+
+#define URC_MAX_NODES 255 ///< Maximum number of trie nodes (sum of prefix lengths + 1)
+
+/**
+ * @brief Trie node.
+ *
+ * @details Children of a node form a list (first child, next sibling),
+ * which keeps nodes small. Nodes are indexed with 8-bit numbers,
+ * 0 is the root, so it also means "no node" in links.
+ */
+typedef struct {
+  char    c;     ///< Character of this node
+  uint8_t child; ///< First child
+  uint8_t next;  ///< Next sibling
+  uint8_t entry; ///< Table entry ending at this node + 1 (0 - none)
+} URC_Node_TypeDef;
+
+static URC_Node_TypeDef nodes[URC_MAX_NODES]; ///< Trie nodes, root is nodes[0]
+static uint8_t nodeCount;                     ///< Number of used nodes
+static const URC_Entry_TypeDef* urcTable;     ///< Table of handlers
+
+/**
+ * @brief Finds child of a node.
+ * @param node Parent node
+ * @param c Character of child
+ * @return Child node (0 - not found)
+ */
+static uint8_t URC_FindChild(uint8_t node, char c) {
+
+  uint8_t child = nodes[node].child;
+
+  while (child && nodes[child].c != c) {
+    child = nodes[child].next;
+  }
+
+  return child;
+}
+/**
+ * @brief Compiles URC table into a trie.
+ * @details The table isn't copied, so it has to stay valid
+ * (usually it is a const array).
+ * @param table Prefixes with handlers
+ * @param count Number of entries
+ * @retval 0 Table compiled
+ * @retval 1 Too many nodes (prefixes too long)
+ */
+uint8_t URC_Init(const URC_Entry_TypeDef* table, uint8_t count) {
+
+  nodes[0].child = 0;
+  nodeCount = 1;
+  urcTable = table;
+
+  for (uint8_t i = 0; i < count; i++) {
+
+    uint8_t node = 0;
+
+    for (const char* p = table[i].prefix; *p; p++) {
+
+      uint8_t child = URC_FindChild(node, *p);
+
+      if (!child) { // add new node as first child
+        if (nodeCount >= URC_MAX_NODES) {
+          LOG_ERROR("URC--> Too many nodes");
+          return 1;
+        }
+        child = nodeCount++;
+        nodes[child].c     = *p;
+        nodes[child].child = 0;
+        nodes[child].entry = 0;
+        nodes[child].next  = nodes[node].child;
+        nodes[node].child  = child;
+      }
+
+      node = child;
+    }
+
+    nodes[node].entry = i + 1;
+  }
+
+  return 0;
+}
+/**
+ * @brief Passes a line to the handler with the longest matching prefix.
+ * @details The handler gets a pointer to the rest of the line (with
+ * leading spaces skipped), nothing is copied.
+ * @param line Received line
+ * @param len Line length
+ * @retval 0 Line handled
+ * @retval 1 No matching prefix
+ */
+uint8_t URC_Dispatch(const char* line, uint8_t len) {
+
+  uint8_t node = 0;
+  uint8_t entry = 0;
+  uint8_t matched = 0;
+
+  for (uint8_t i = 0; i < len; i++) {
+
+    node = URC_FindChild(node, line[i]);
+
+    if (!node) {
+      break;
+    }
+
+    if (nodes[node].entry) { // remember longest match
+      entry = nodes[node].entry;
+      matched = i + 1;
+    }
+  }
+
+  if (!entry) {
+    return 1;
+  }
+
+  while (matched < len && line[matched] == ' ') {
+    matched++;
+  }
+
+  urcTable[entry - 1].handler(&line[matched], len - matched);
+
+  return 0;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,564 @@
+/**
+ * @file:   bench.c
+ * @brief:  Benchmarks of the hot paths
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details Separate program (replaces main.c), which runs the FIFO,
+ * frame parsing, soft timer and formatting paths of the application
+ * and prints the counter value per iteration for each of them. Only
+ * the measured code is counted - preparing input and draining output
+ * isn't. Under QEMU with -icount shift=0 the results are instruction
+ * counts and don't depend on the host (see bench_hal.h), so they can
+ * be compared between builds with tools/bench_compare.py.
+ *
+ * The modules aren't initialized (except timers), so the UARTs are
+ * never started - received data is fed to the RX callbacks and sent
+ * data is taken from the TX callbacks, like the interrupts would.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <bench_hal.h>
+#include <fifo.h>
+#include <comm.h>
+#include <sim900.h>
+#include <urc.h>
+#include <timers.h>
+#include <log.h>
+
+/**
+ * @defgroup  BENCH BENCH
+ * @brief     Benchmarks
+ */
+
+/**
+ * @addtogroup BENCH
+ * @{
+ */
+
+#define BENCH_TICK_FREQ   1000 ///< SysTick frequency for the timer benchmark
+#define BENCH_FIFO_LEN    512  ///< Length of FIFO used in benchmarks
+#define BENCH_BLOCK_LEN   64   ///< Bytes pushed and popped per iteration
+#define BENCH_TIMERS      32   ///< Number of soft timers used in benchmarks
+#define BENCH_TIMERS_MAX  1000 ///< Number of soft timers in the largest benchmark
+#define BENCH_LINE_LEN    128  ///< Length of formatted line
+#define BENCH_US_PER_MS   1000 ///< Microsecond ticks per millisecond
+#define BENCH_TIM_UPDATE  0x0001 ///< Update flag of TIMx->SR (TIM_FLAG_Update)
+
+/**
+ * @brief Benchmark.
+ */
+typedef struct {
+  const char* name;                      ///< Name (no spaces)
+  uint32_t iterations;                   ///< Number of iterations
+  uint32_t (*run)(uint32_t iterations);  ///< Runs benchmark, returns sum of counts of measured code
+} BENCH_Case_TypeDef;
+
+// Interrupt side of the modules (normally called by the HAL)
+void    COMM_RxCallback(uint8_t c);
+uint8_t COMM_TxCallback(uint8_t* c);
+void    SIM900_RxCallback(uint8_t c);
+
+FIFO_DEFINE(BENCH_Fifo, uint8_t, BENCH_FIFO_LEN)
+
+static BENCH_Fifo_TypeDef fifo = FIFO_INIT(fifo); ///< FIFO for FIFO benchmarks
+static TIMER_Soft_TypeDef timers[BENCH_TIMERS_MAX]; ///< Soft timers
+static uint32_t overhead; ///< Counts of an empty measurement
+static uint32_t expiries; ///< Number of soft timer expiries
+static uint32_t lines;    ///< Number of lines handled by line callback
+static uint8_t  failed;   ///< Nonzero if a benchmark gave wrong results
+static volatile uint32_t tim14Sr; ///< Status register of TIM14 (old microsecond clock)
+static volatile uint32_t usCount; ///< Microseconds counted by the TIM14 handler
+
+static const char commLine[]   = "SMS +48123456789 Benchmark message\r";
+static const char sim900Line[] = "+CMTI: \"SM\",12\r\n";
+static const char logArg[]     = "+CMTI: \"SM\",12";
+
+/**
+ * @brief Measures the counts of code, adds them to total.
+ */
+#define BENCH_MEASURE(total, ...) do {                                        \
+  uint32_t start = BENCH_HAL_Count();                                         \
+  __VA_ARGS__;                                                                \
+  (total) += BENCH_HAL_Count() - start - overhead;                            \
+} while (0)
+
+/**
+ * @brief Checks result of benchmarked code.
+ */
+#define BENCH_CHECK(cond) do {                                                \
+  if (!(cond)) {                                                              \
+    failed = 1;                                                               \
+  }                                                                           \
+} while (0)
+
+/**
+ * @brief Soft timer callback.
+ */
+static void BENCH_TimerCallback(void* ctx) {
+
+  expiries++;
+}
+/**
+ * @brief Unsolicited result code handler.
+ */
+static void BENCH_UrcCallback(const char* args, uint8_t len) {
+
+  lines++;
+}
+/**
+ * @brief Handled unsolicited result codes (same prefixes as main.c).
+ */
+static const URC_Entry_TypeDef urcTable[] = {
+  {"RING",    BENCH_UrcCallback},
+  {"+CLIP:",  BENCH_UrcCallback},
+  {"+CMTI:",  BENCH_UrcCallback},
+  {"+CREG:",  BENCH_UrcCallback},
+  {"+CPIN:",  BENCH_UrcCallback},
+  {"Call Ready", BENCH_UrcCallback},
+};
+/**
+ * @brief Handles lines received from SIM900.
+ */
+static void BENCH_LineCallback(char* line, uint8_t len) {
+
+  URC_Dispatch(line, len);
+}
+/**
+ * @brief Takes all data from COMM TX FIFO (like the transmitter).
+ * @param buf Buffer for data (NULL - data is thrown away)
+ * @param len Buffer length
+ * @return Number of bytes taken
+ */
+static uint16_t BENCH_DrainComm(uint8_t* buf, uint16_t len) {
+
+  uint16_t n = 0;
+  uint8_t c;
+
+  while (COMM_TxCallback(&c)) {
+    if (buf && n < len) {
+      buf[n] = c;
+    }
+    n++;
+  }
+
+  return n;
+}
+/**
+ * @brief Single bytes through a FIFO (interrupt handlers).
+ */
+static uint32_t BENCH_FifoByte(uint32_t iterations) {
+
+  uint32_t total = 0;
+  uint8_t c = 0;
+
+  while (iterations--) {
+    BENCH_MEASURE(total,
+      for (uint16_t i = 0; i < BENCH_BLOCK_LEN; i++) {
+        BENCH_Fifo_Push(&fifo, (uint8_t)i);
+      }
+      for (uint16_t i = 0; i < BENCH_BLOCK_LEN; i++) {
+        BENCH_Fifo_Pop(&fifo, &c);
+      }
+    );
+  }
+
+  BENCH_CHECK(c == BENCH_BLOCK_LEN - 1);
+
+  return total;
+}
+/**
+ * @brief Blocks through a FIFO (main loop).
+ */
+static uint32_t BENCH_FifoBlock(uint32_t iterations) {
+
+  uint32_t total = 0;
+  uint8_t in[BENCH_BLOCK_LEN];
+  uint8_t out[BENCH_BLOCK_LEN];
+  uint16_t n = 0;
+
+  for (uint16_t i = 0; i < BENCH_BLOCK_LEN; i++) {
+    in[i] = i;
+  }
+
+  while (iterations--) {
+    BENCH_MEASURE(total,
+      FIFO_PushBlock(&fifo.fifo, in, sizeof(in));
+      n = FIFO_PopBlock(&fifo.fifo, out, sizeof(out));
+    );
+  }
+
+  BENCH_CHECK(n == sizeof(out) && memcmp(in, out, sizeof(out)) == 0);
+
+  return total;
+}
+/**
+ * @brief Receiving a text frame from PC.
+ */
+static uint32_t BENCH_CommFrame(uint32_t iterations) {
+
+  uint32_t total = 0;
+  uint8_t buf[COMM_FRAME_LEN];
+  uint8_t len = 0;
+  uint8_t ret = 1;
+
+  while (iterations--) {
+    BENCH_MEASURE(total,
+      for (const char* c = commLine; *c; c++) {
+        COMM_RxCallback(*c);
+      }
+      ret = COMM_GetFrame(buf, &len);
+    );
+  }
+
+  BENCH_CHECK(ret == 0 && len == sizeof(commLine) - 2);
+
+  return total;
+}
+/**
+ * @brief Receiving a binary packet from PC (COBS and CRC).
+ */
+static uint32_t BENCH_CommPacket(uint32_t iterations) {
+
+  uint32_t total = 0;
+  uint8_t frame[COMM_FRAME_LEN + 2];
+  uint8_t buf[COMM_FRAME_LEN];
+  uint16_t n;
+  uint8_t type = 0;
+  uint8_t len = 0;
+  uint8_t ret = 1;
+
+  COMM_SetMode(COMM_MODE_BINARY);
+
+  while (iterations--) {
+    // the packet comes back with the same sequence number
+    COMM_PutPacket(COMM_PACKET_COMMAND, (const uint8_t*)commLine,
+        sizeof(commLine) - 2);
+    n = BENCH_DrainComm(frame, sizeof(frame));
+
+    BENCH_MEASURE(total,
+      for (uint16_t i = 0; i < n; i++) {
+        COMM_RxCallback(frame[i]);
+      }
+      ret = COMM_GetPacket(&type, buf, &len);
+    );
+  }
+
+  BENCH_CHECK(ret == 0 && type == COMM_PACKET_COMMAND &&
+      len == sizeof(commLine) - 2);
+
+  COMM_SetMode(COMM_MODE_TEXT);
+  BENCH_DrainComm(NULL, 0);
+
+  return total;
+}
+/**
+ * @brief Receiving a line from SIM900 and dispatching the URC.
+ */
+static uint32_t BENCH_Sim900Line(uint32_t iterations) {
+
+  uint32_t total = 0;
+
+  URC_Init(urcTable, sizeof(urcTable) / sizeof(urcTable[0]));
+  SIM900_SetLineCallback(BENCH_LineCallback);
+  lines = 0;
+
+  for (uint32_t i = 0; i < iterations; i++) {
+    BENCH_MEASURE(total,
+      for (const char* c = sim900Line; *c; c++) {
+        SIM900_RxCallback(*c);
+      }
+      SIM900_Update();
+    );
+  }
+
+  BENCH_CHECK(lines == iterations);
+
+  return total;
+}
+/**
+ * @brief Restarting soft timers (command timeouts).
+ */
+static uint32_t BENCH_TimerStart(uint32_t iterations) {
+
+  uint32_t total = 0;
+
+  for (uint8_t i = 0; i < BENCH_TIMERS; i++) {
+    TIMER_SoftTimerInit(&timers[i], BENCH_TimerCallback, 0);
+  }
+
+  while (iterations--) {
+    BENCH_MEASURE(total,
+      for (uint8_t i = 0; i < BENCH_TIMERS; i++) {
+        TIMER_SoftTimerStart(&timers[i], 100 + i * 37, 0);
+      }
+    );
+  }
+
+  for (uint8_t i = 0; i < BENCH_TIMERS; i++) {
+    TIMER_SoftTimerStop(&timers[i]);
+  }
+
+  return total;
+}
+/**
+ * @brief Writing a deferred log record.
+ */
+static uint32_t BENCH_Log(uint32_t iterations) {
+
+  uint32_t total = 0;
+  uint32_t dropped = LOG_GetDropped();
+
+  while (iterations--) {
+    BENCH_MEASURE(total,
+      LOG_INFO("SIM900--> length %d: %s", (int)sizeof(logArg) - 1, logArg);
+    );
+    LOG_Flush();
+    BENCH_DrainComm(NULL, 0);
+  }
+
+  BENCH_CHECK(LOG_GetDropped() == dropped);
+
+  return total;
+}
+/**
+ * @brief Formatting the same line with snprintf (what LOG_DEFERRED=0 does).
+ */
+static uint32_t BENCH_Printf(uint32_t iterations) {
+
+  uint32_t total = 0;
+  char line[BENCH_LINE_LEN];
+  int n = 0;
+
+  while (iterations--) {
+    BENCH_MEASURE(total,
+      n = snprintf(line, sizeof(line), "SIM900--> length %d: %s\r\n",
+          (int)sizeof(logArg) - 1, logArg);
+    );
+  }
+
+  BENCH_CHECK(n > 0 && (size_t)n < sizeof(line));
+
+  return total;
+}
+/**
+ * @brief Update interrupt of the old 1 MHz TIM14 microsecond clock
+ * (hal/src/timer14.c before TIM2 replaced it), on a model of the
+ * status register.
+ */
+static void BENCH_Tim14Handler(void) {
+
+  if (tim14Sr & BENCH_TIM_UPDATE) {
+    tim14Sr = ~BENCH_TIM_UPDATE; // rc_w0 - writing 1 leaves other flags
+    usCount++;
+  }
+}
+/**
+ * @brief Main loop time taken by the microsecond clock in a millisecond
+ * - before: TIM14 interrupt every microsecond.
+ * @details The handler is called through a pointer like from the vector
+ * table. Exception entry and exit (about 24 cycles on Cortex-M4) aren't
+ * counted, so the real cost is higher.
+ */
+static uint32_t BENCH_UsClockTim14(uint32_t iterations) {
+
+  void (* volatile handler)(void) = BENCH_Tim14Handler;
+  uint32_t total = 0;
+
+  usCount = 0;
+
+  while (iterations--) {
+    BENCH_MEASURE(total,
+      for (uint16_t i = 0; i < BENCH_US_PER_MS; i++) {
+        tim14Sr = BENCH_TIM_UPDATE; // the timer overflows
+        handler();
+      }
+    );
+  }
+
+  BENCH_CHECK(usCount == 0 || usCount % BENCH_US_PER_MS == 0);
+
+  return total;
+}
+/**
+ * @brief Main loop time taken by the microsecond clock in a millisecond
+ * - after: free-running TIM2, no interrupt, the main loop reads the
+ * counter when it needs the time (once here).
+ */
+static uint32_t BENCH_UsClockTim2(uint32_t iterations) {
+
+  uint32_t total = 0;
+  uint32_t first = TIMER_GetTimeUS();
+  uint32_t now = first;
+
+  while (iterations--) {
+    BENCH_MEASURE(total,
+      now = TIMER_GetTimeUS();
+    );
+  }
+
+  BENCH_CHECK(now - first < UINT32_MAX / 2); // doesn't go back
+
+  return total;
+}
+/**
+ * @brief Soft timer ticks with periodic timers running.
+ * @details Runs once per SysTick, so iterations take real
+ * (or virtual) time. SysTick keeps running afterwards, so these run last.
+ * @param iterations Ticks
+ * @param count Number of timers
+ * @param spread Nonzero - timers expire at spread times (application
+ * timeouts and periodic tasks), zero - every 1 to count ticks
+ */
+static uint32_t BENCH_TimerTicks(uint32_t iterations, uint16_t count,
+    uint8_t spread) {
+
+  uint32_t total = 0;
+  uint32_t time;
+
+  TIMER_Init(BENCH_TICK_FREQ);
+
+  for (uint16_t i = 0; i < count; i++) {
+    TIMER_SoftTimerInit(&timers[i], BENCH_TimerCallback, 0);
+    if (spread) {
+      TIMER_SoftTimerStart(&timers[i], 1 + i * 7 % 100, 50 + i * 37 % 500);
+    } else {
+      TIMER_SoftTimerStart(&timers[i], i + 1, i + 1);
+    }
+  }
+
+  expiries = 0;
+
+  while (iterations--) {
+    time = TIMER_GetTime();
+    while (TIMER_GetTime() == time) {
+      ; // wait for next tick
+    }
+    BENCH_MEASURE(total,
+      TIMER_SoftTimersUpdate();
+    );
+  }
+
+  for (uint16_t i = 0; i < count; i++) {
+    TIMER_SoftTimerStop(&timers[i]);
+  }
+
+  BENCH_CHECK(expiries > 0);
+
+  return total;
+}
+/**
+ * @brief Soft timer tick with short periodic timers (one expires on
+ * every tick).
+ */
+static uint32_t BENCH_TimerUpdate(uint32_t iterations) {
+
+  return BENCH_TimerTicks(iterations, BENCH_TIMERS, 0);
+}
+/**
+ * @brief Soft timer tick with 10 timers at spread times.
+ */
+static uint32_t BENCH_TimerUpdate10(uint32_t iterations) {
+
+  return BENCH_TimerTicks(iterations, 10, 1);
+}
+/**
+ * @brief Soft timer tick with 100 timers at spread times.
+ */
+static uint32_t BENCH_TimerUpdate100(uint32_t iterations) {
+
+  return BENCH_TimerTicks(iterations, 100, 1);
+}
+/**
+ * @brief Soft timer tick with 1000 timers at spread times.
+ */
+static uint32_t BENCH_TimerUpdate1000(uint32_t iterations) {
+
+  return BENCH_TimerTicks(iterations, BENCH_TIMERS_MAX, 1);
+}
+
+/**
+ * @brief Benchmarks in order of running.
+ */
+static const BENCH_Case_TypeDef cases[] = {
+  {"fifo_byte",    1000, BENCH_FifoByte},
+  {"fifo_block",   1000, BENCH_FifoBlock},
+  {"comm_frame",   500,  BENCH_CommFrame},
+  {"comm_packet",  500,  BENCH_CommPacket},
+  {"sim900_line",  500,  BENCH_Sim900Line},
+  {"timer_start",  500,  BENCH_TimerStart},
+  {"log_deferred", 500,  BENCH_Log},
+  {"snprintf",     500,  BENCH_Printf},
+  {"usclock_tim14", 100, BENCH_UsClockTim14},
+  {"usclock_tim2",  100, BENCH_UsClockTim2},
+  {"timer_update", 100,  BENCH_TimerUpdate},
+  {"timer_10",     200,  BENCH_TimerUpdate10},
+  {"timer_100",    200,  BENCH_TimerUpdate100},
+  {"timer_1000",   200,  BENCH_TimerUpdate1000},
+};
+
+/**
+ * @brief Measures the cost of reading the counter.
+ */
+static void BENCH_Calibrate(void) {
+
+  uint32_t min = UINT32_MAX;
+  uint32_t counts;
+
+  for (uint8_t i = 0; i < 16; i++) {
+    counts = 0;
+    BENCH_MEASURE(counts, );
+    if (counts < min) {
+      min = counts;
+    }
+  }
+
+  overhead = min;
+}
+
+int main(void) {
+
+  char line[BENCH_LINE_LEN];
+
+  BENCH_HAL_Init();
+  BENCH_Calibrate();
+
+  BENCH_HAL_Print("# STM32F4_SIM900 benchmarks, unit: " BENCH_HAL_UNIT "\n");
+  BENCH_HAL_Print("# name iterations total per_iteration\n");
+
+  for (uint8_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+
+    uint32_t total = cases[i].run(cases[i].iterations);
+    uint64_t perIter = (uint64_t)total * 100 / cases[i].iterations;
+
+    snprintf(line, sizeof(line), "%-14s %6lu %12lu %10lu.%02u\n",
+        cases[i].name, (unsigned long)cases[i].iterations,
+        (unsigned long)total, (unsigned long)(perIter / 100),
+        (unsigned)(perIter % 100));
+    BENCH_HAL_Print(line);
+  }
+
+  if (failed) {
+    BENCH_HAL_Print("# FAILED - wrong results\n");
+  }
+
+  BENCH_HAL_Exit(failed);
+
+  return 0;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,123 @@
+/**
+ * @file:   bench_hal.h
+ * @brief:  HAL for the benchmarks (counter and semihosting output)
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details On the board the counter is the DWT cycle counter. QEMU
+ * (HAL_QEMU) doesn't emulate the DWT, but its timers count nanoseconds
+ * of virtual time - with -icount shift=0 every instruction takes one
+ * nanosecond, so TIM5 without prescaler counts executed instructions.
+ *
+ * The results are written with ARM semihosting, so the benchmarks
+ * need QEMU (-semihosting-config enable=on) or a debugger - without
+ * one the BKPT instruction ends in HardFault.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef BENCH_HAL_H_
+#define BENCH_HAL_H_
+
+#include <stm32f4xx.h>
+
+/**
+ * @defgroup  BENCH_HAL BENCH_HAL
+ * @brief     HAL - benchmarks.
+ */
+
+/**
+ * @addtogroup BENCH_HAL
+ * @{
+ */
+
+#ifdef HAL_QEMU
+  #define BENCH_HAL_UNIT "instructions" ///< What the counter counts
+#else
+  #define BENCH_HAL_UNIT "cycles"       ///< What the counter counts
+#endif
+
+#define BENCH_HAL_SYS_WRITE0 0x04    ///< Semihosting: write null terminated string
+#define BENCH_HAL_SYS_EXIT   0x18    ///< Semihosting: end of program
+#define BENCH_HAL_EXIT_OK    0x20026 ///< ADP_Stopped_ApplicationExit
+#define BENCH_HAL_EXIT_ERROR 0x20023 ///< ADP_Stopped_RunTimeErrorUnknown
+
+/**
+ * @brief Starts the counter.
+ */
+static inline void BENCH_HAL_Init(void) {
+
+#ifdef HAL_QEMU
+  RCC->APB1ENR |= RCC_APB1ENR_TIM5EN;
+  TIM5->PSC = 0;
+  TIM5->ARR = UINT32_MAX;
+  TIM5->EGR = TIM_EGR_UG; // load prescaler
+  TIM5->CR1 = TIM_CR1_CEN;
+#else
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+/**
+ * @brief Reads the counter.
+ * @return Counter value (wraps around)
+ */
+static inline uint32_t BENCH_HAL_Count(void) {
+
+#ifdef HAL_QEMU
+  return TIM5->CNT;
+#else
+  return DWT->CYCCNT;
+#endif
+}
+/**
+ * @brief Calls the debugger (semihosting).
+ * @param op Operation
+ * @param arg Argument
+ * @return Result
+ */
+static inline uint32_t BENCH_HAL_Semihost(uint32_t op, const void* arg) {
+
+  register uint32_t r0 __asm__("r0") = op;
+  register const void* r1 __asm__("r1") = arg;
+
+  __asm__ volatile ("bkpt 0xab" : "+r"(r0) : "r"(r1) : "memory");
+
+  return r0;
+}
+/**
+ * @brief Writes a string to the host console.
+ * @param str String
+ */
+static inline void BENCH_HAL_Print(const char* str) {
+
+  BENCH_HAL_Semihost(BENCH_HAL_SYS_WRITE0, str);
+}
+/**
+ * @brief Ends the program.
+ * @param status 0 - success (QEMU exits with 0), otherwise failure
+ */
+static inline void BENCH_HAL_Exit(int status) {
+
+  BENCH_HAL_Semihost(BENCH_HAL_SYS_EXIT,
+      (const void*)(status ? BENCH_HAL_EXIT_ERROR : BENCH_HAL_EXIT_OK));
+
+  while (1) {
+    ; // no debugger
+  }
+}
+
+/**
+ * @}
+ */
+
+#endif /* BENCH_HAL_H_ */
@@ -0,0 +1,44 @@
+/**
+ * @file:   crc_hal.h
+ * @brief:  HAL for the CRC calculation unit
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef CRC_HAL_H_
+#define CRC_HAL_H_
+
+#include <inttypes.h>
+
+/**
+ * @defgroup  CRC_HAL CRC_HAL
+ * @brief     HAL - CRC calculation unit.
+ */
+
+/**
+ * @addtogroup CRC_HAL
+ * @{
+ */
+
+#ifndef HAL_QEMU // QEMU doesn't emulate the CRC unit
+#define CRC_HAL_HW 1 ///< Hardware CRC-32 (MPEG-2) is available
+#endif
+
+void     CRC_HAL_Init   (void);
+uint32_t CRC_HAL_Update (uint32_t crc, const uint32_t* words, uint32_t count);
+
+/**
+ * @}
+ */
+
+#endif /* CRC_HAL_H_ */
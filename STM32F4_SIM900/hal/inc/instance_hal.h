@@ -0,0 +1,50 @@
+/**
+ * @file:   instance_hal.h
+ * @brief:  HAL for instances of the application
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details COMM, SIM900 and TIMER keep their state in a context
+ * structure, reached through a pointer to the current instance.
+ * The board runs a single instance, so the pointer is constant
+ * and the compiler addresses the state directly.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef INSTANCE_HAL_H_
+#define INSTANCE_HAL_H_
+
+/**
+ * @defgroup  INSTANCE_HAL INSTANCE_HAL
+ * @brief     HAL - instances of the application.
+ */
+
+/**
+ * @addtogroup INSTANCE_HAL
+ * @{
+ */
+
+#define INSTANCE_CONTEXTS 0 ///< Nonzero - contexts can be switched (see e.g. COMM_SetContext)
+
+/**
+ * @brief Defines the pointer to the current context of a module.
+ * @param type Context type
+ * @param name Pointer name
+ * @param init Default context
+ */
+#define INSTANCE_POINTER(type, name, init) static type* const name = (init)
+
+/**
+ * @}
+ */
+
+#endif /* INSTANCE_HAL_H_ */
@@ -23,5 +23,7 @@
 int8_t KEYS_HAL_ReadRow(void);
 void KEYS_HAL_SelectColumn(uint8_t col);
 void KEYS_HAL_Init(void);
+void KEYS_HAL_SelectAll(void);
+void KEYS_HAL_EnableWakeup(void (*callback)(void));
 
 #endif /* KEYS_HAL_H_ */
@@ -32,6 +32,8 @@
  */
 void      SYSTICK_Init    (uint32_t freq);
 uint32_t  SYSTICK_GetTime (void);
+void      SYSTICK_Sleep   (uint32_t ticks, uint8_t (*abort)(void));
+void      SYSTICK_SetTickCallback (void (*callback)(void));
 
 /**
  * @}
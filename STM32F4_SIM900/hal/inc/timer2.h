@@ -1,6 +1,6 @@
 /**
- * @file: 	timer14.h
- * @brief:	   
+ * @file: 	timer2.h
+ * @brief:	Free-running microsecond counter
  * @date: 	10 paź 2014
  * @author: Michal Ksiezopolski
  * 
@@ -15,10 +15,12 @@
  * @endverbatim
  */
 
-#ifndef TIMER14_H_
-#define TIMER14_H_
+#ifndef TIMER2_H_
+#define TIMER2_H_
 
-void TIMER14_Init(void);
-uint32_t TIMER14_GetTime(void);
+#include <inttypes.h>
 
-#endif /* TIMER14_H_ */
+void TIMER2_Init(void);
+uint32_t TIMER2_GetTime(void);
+
+#endif /* TIMER2_H_ */
@@ -32,10 +32,21 @@
 
 void    UART2_Init(uint32_t baud, void(*rxCb)(uint8_t), uint8_t(*txCb)(uint8_t*));
 void    UART2_TxEnable(void);
+void    UART2_TxDmaInit(uint16_t(*peekCb)(uint8_t**), void(*doneCb)(uint16_t));
+void    UART2_TxLock(void);
+void    UART2_TxUnlock(void);
+uint16_t UART2_TxInFlight(void);
 
 // HAL functions for use in higher level
 #define COMM_HAL_Init       UART2_Init
 #define COMM_HAL_TxEnable   UART2_TxEnable
+#define COMM_HAL_TxDmaInit  UART2_TxDmaInit
+#define COMM_HAL_TxLock     UART2_TxLock
+#define COMM_HAL_TxUnlock   UART2_TxUnlock
+#define COMM_HAL_TxInFlight UART2_TxInFlight
+#ifndef HAL_QEMU // QEMU doesn't emulate the DMA controller
+#define COMM_HAL_TX_DMA     1 ///< Transmission using DMA is available
+#endif
 #define COMM_HAL_IrqEnable  NVIC_EnableIRQ(USART2_IRQn);
 #define COMM_HAL_IrqDisable NVIC_DisableIRQ(USART2_IRQn);
 
@@ -32,10 +32,26 @@
 
 void    UART3_Init(uint32_t baud, void(*rxCb)(uint8_t), uint8_t(*txCb)(uint8_t*));
 void    UART3_TxEnable(void);
+void    UART3_TxDmaInit(uint16_t(*peekCb)(uint8_t**), void(*doneCb)(uint16_t));
+void    UART3_TxLock(void);
+void    UART3_TxUnlock(void);
+uint16_t UART3_TxInFlight(void);
+void    UART3_RxDmaInit(void(*rxBlockCb)(const uint8_t*, uint16_t));
 
 // HAL functions for use in higher level
 #define SIM900_HAL_Init       UART3_Init
 #define SIM900_HAL_TxEnable   UART3_TxEnable
+#define SIM900_HAL_TxDmaInit  UART3_TxDmaInit
+#define SIM900_HAL_TxLock     UART3_TxLock
+#define SIM900_HAL_TxUnlock   UART3_TxUnlock
+#define SIM900_HAL_TxInFlight UART3_TxInFlight
+#ifndef HAL_QEMU // QEMU doesn't emulate the DMA controller
+#define SIM900_HAL_TX_DMA     1 ///< Transmission using DMA is available
+#endif
+#define SIM900_HAL_RxDmaInit  UART3_RxDmaInit
+#ifndef HAL_QEMU
+#define SIM900_HAL_RX_DMA     1 ///< Reception using circular DMA is available
+#endif
 #define SIM900_HAL_IrqEnable  NVIC_EnableIRQ(USART3_IRQn);
 #define SIM900_HAL_IrqDisable NVIC_DisableIRQ(USART3_IRQn);
 
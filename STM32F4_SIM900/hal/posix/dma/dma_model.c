@@ -0,0 +1,999 @@
+/**
+ * @file:   dma_model.c
+ * @brief:  Host model of the DMA streams and USARTs for the UART drivers
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details Runs the real UART drivers of the board (hal/src/uart2.c and
+ * hal/src/uart3.c) on the host. The StdPeriph DMA and USART functions
+ * are replaced by a model of the peripherals, which moves one byte per
+ * tick on every line like the hardware does:
+ * - a DMA stream counts NDTR down, sets the HT and TC flags, reloads
+ *   itself in circular mode and disables itself in normal mode,
+ * - a USART sets IDLE when the line goes quiet after a burst,
+ * - interrupts are taken after a random latency, only when enabled in
+ *   the stream (USART) and unmasked in the NVIC, and as long as their
+ *   flag stays set (level triggered), so a flag which isn't cleared
+ *   hangs the model.
+ * Wrong use of the hardware is reported, e.g. writing NDTR or the
+ * memory address while the stream runs, or enabling a stream with
+ * flags of the previous transfer still set.
+ *
+ * USART3 receives random bursts (lengths around the half and the whole
+ * circular buffer, back to back or separated by idle line) and both
+ * USART2 and USART3 send data pushed at random into rings like the TX
+ * FIFOs, with the transmitter interrupts masked now and then (as
+ * FIFO_POLICY_DROP_OLDEST does). Every byte is checked on the other
+ * side. The drivers access a few registers directly (SR and DR reads,
+ * NVIC), so these pages are mapped at the addresses of the board; the
+ * program is linked at a fixed address below 4 GB, because the drivers
+ * pass buffer addresses in 32-bit registers.
+ *
+ * Usage:
+ *   stm32f4_sim900_dma [-n bytes] [-s seed]
+ *
+ * - bytes - bytes received on USART3 (default 1000000), the transmitters
+ *   send about as much
+ * - seed - seed of the random numbers (default 1)
+ *
+ * The exit status is 1 if any byte got lost, reordered or corrupted,
+ * or if the hardware was used wrong.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <uart2.h>
+#include <uart3.h>
+#include <trace_hal.h>
+#include <stm32f4xx.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifndef MAP_FIXED_NOREPLACE
+  #define MAP_FIXED_NOREPLACE MAP_FIXED
+#endif
+
+/**
+ * @defgroup  DMA_MODEL DMA_MODEL
+ * @brief     Host model of the DMA streams and USARTs.
+ */
+
+/**
+ * @addtogroup DMA_MODEL
+ * @{
+ */
+
+#define DMA_MODEL_STREAMS     8      ///< Streams of DMA1
+#define DMA_MODEL_STREAM_SIZE 0x18   ///< Distance between stream registers
+#define DMA_MODEL_MAX_LATENCY 32     ///< Maximum interrupt latency in ticks (bytes)
+#define DMA_MODEL_MAX_LOCK    40     ///< Maximum time the transmitter is masked in ticks
+#define DMA_MODEL_MAX_IRQS    16     ///< Handler calls after which a flag is assumed stuck
+#define DMA_MODEL_TX_LEN      512    ///< Length of the transmit rings
+#define DMA_MODEL_DRAIN       100000 ///< Ticks to finish the transfers at the end
+#define DMA_MODEL_PAGE        0x1000 ///< Page mapped for direct register access
+
+/**
+ * @brief Model of a DMA stream.
+ */
+typedef struct {
+  uint8_t  index;       ///< Stream number
+  uint8_t  enabled;     ///< EN bit
+  uint8_t  circular;    ///< Circular mode
+  uint8_t  toMemory;    ///< Peripheral to memory direction
+  uint32_t itEnable;    ///< Enabled interrupts (DMA_IT_TC, DMA_IT_HT)
+  uint32_t par;         ///< Peripheral address
+  uint32_t m0ar;        ///< Memory address
+  uint16_t ndtr;        ///< Number of data left
+  uint16_t length;      ///< NDTR when the stream was enabled
+  uint32_t address;     ///< Current memory address
+  uint32_t flags;       ///< Status bits of the stream (in LISR or HISR)
+  uint16_t completed;   ///< Length of the last completed transfer
+  uint32_t latency;     ///< Ticks until a pending interrupt is taken
+  IRQn_Type irq;        ///< Interrupt of the stream
+  void (*handler)(void); ///< Interrupt handler
+  uint32_t ht;          ///< Half transfer interrupts taken
+  uint32_t tc;          ///< Transfer complete interrupts taken
+} DMA_MODEL_Stream_TypeDef;
+
+/**
+ * @brief Model of a USART.
+ */
+typedef struct {
+  USART_TypeDef* regs;  ///< Registers
+  uint16_t itEnable;    ///< Enabled interrupts (bit per USART_IT_x & 0x1f)
+  uint16_t dmaReq;      ///< Enabled DMA requests
+  uint8_t  idle;        ///< IDLE flag
+  uint8_t  rxne;        ///< RXNE flag
+  uint8_t  data;        ///< Received data
+  uint8_t  received;    ///< Data received since the last IDLE
+  uint32_t latency;     ///< Ticks until a pending interrupt is taken
+  IRQn_Type irq;        ///< Interrupt of the USART
+  void (*handler)(void); ///< Interrupt handler
+  uint32_t idles;       ///< IDLE interrupts taken
+  uint32_t sent;        ///< Bytes sent on the line
+} DMA_MODEL_Usart_TypeDef;
+
+/**
+ * @brief Transmit ring (like the TX FIFO of COMM and SIM900) with the
+ * sequence sent through it.
+ */
+typedef struct {
+  uint8_t  buf[DMA_MODEL_TX_LEN]; ///< Ring
+  uint16_t head;        ///< Write index
+  uint16_t tail;        ///< Read index
+  uint64_t pushed;      ///< Bytes pushed
+  uint64_t checked;     ///< Bytes checked on the line
+  uint32_t transfers;   ///< DMA transfers
+  uint32_t wraps;       ///< Transfers ending at the end of the ring
+  uint32_t locked;      ///< Transfers completed while the interrupt was masked
+  uint32_t lockTicks;   ///< Ticks until the transmitter is unmasked
+  DMA_MODEL_Stream_TypeDef* stream; ///< TX stream
+  void (*txEnable)(void); ///< Starts the transmitter
+  void (*txLock)(void);   ///< Masks the transmitter interrupts
+  void (*txUnlock)(void); ///< Unmasks the transmitter interrupts
+  uint16_t (*txInFlight)(void); ///< Returns bytes being sent
+} DMA_MODEL_Tx_TypeDef;
+
+void DMA1_Stream1_IRQHandler(void);
+void DMA1_Stream3_IRQHandler(void);
+void DMA1_Stream6_IRQHandler(void);
+void USART2_IRQHandler(void);
+void USART3_IRQHandler(void);
+
+static DMA_MODEL_Stream_TypeDef streams[DMA_MODEL_STREAMS]; ///< DMA1 streams
+static DMA_MODEL_Usart_TypeDef usart2 = {.regs = USART2, .irq = USART2_IRQn,
+    .handler = USART2_IRQHandler}; ///< USART2 (PC)
+static DMA_MODEL_Usart_TypeDef usart3 = {.regs = USART3, .irq = USART3_IRQn,
+    .handler = USART3_IRQHandler}; ///< USART3 (SIM900)
+static uint32_t nvicEnabled[3];   ///< Interrupts unmasked in the NVIC
+static DMA_MODEL_Tx_TypeDef tx2 = {.txEnable = UART2_TxEnable,
+    .txLock = UART2_TxLock, .txUnlock = UART2_TxUnlock,
+    .txInFlight = UART2_TxInFlight}; ///< Data sent on USART2
+static DMA_MODEL_Tx_TypeDef tx3 = {.txEnable = UART3_TxEnable,
+    .txLock = UART3_TxLock, .txUnlock = UART3_TxUnlock,
+    .txInFlight = UART3_TxInFlight}; ///< Data sent on USART3
+static uint64_t rxSent;           ///< Bytes sent to USART3
+static uint64_t rxReceived;       ///< Bytes received by the driver
+static uint32_t rxBlocks;         ///< Blocks received by the driver
+static uint64_t traced[TRACE_HAL_CHANNELS]; ///< Bytes seen by the capture hook
+static uint32_t seed = 1;         ///< State of the random numbers
+static uint32_t errors;           ///< Errors found
+
+/**
+ * @brief Reports an error.
+ * @param fmt Format string (printf)
+ */
+static void DMA_MODEL_Error(const char* fmt, ...) {
+
+  va_list args;
+
+  if (errors++ < 10) {
+    va_start(args, fmt);
+    printf("ERROR: ");
+    vprintf(fmt, args);
+    printf("\n");
+    va_end(args);
+  }
+}
+/**
+ * @brief Pseudo-random number generator (xorshift32).
+ * @param n Range
+ * @return Number from 0 to n - 1
+ */
+static uint32_t DMA_MODEL_Random(uint32_t n) {
+
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+
+  return seed % n;
+}
+/**
+ * @brief Byte number n of a sequence.
+ */
+static inline uint8_t DMA_MODEL_Byte(uint64_t n) {
+  return n % 251;
+}
+/**
+ * @brief Returns the model of a stream.
+ * @param regs Stream registers (DMA1 only)
+ */
+static DMA_MODEL_Stream_TypeDef* DMA_MODEL_Stream(DMA_Stream_TypeDef* regs) {
+
+  uint32_t index = ((uintptr_t)regs - DMA1_Stream0_BASE) / DMA_MODEL_STREAM_SIZE;
+
+  if (index >= DMA_MODEL_STREAMS) {
+    fprintf(stderr, "Only DMA1 is modelled\n");
+    exit(1);
+  }
+
+  streams[index].index = index;
+
+  return &streams[index];
+}
+/**
+ * @brief Returns the model of a USART.
+ * @param regs USART registers
+ */
+static DMA_MODEL_Usart_TypeDef* DMA_MODEL_Usart(USART_TypeDef* regs) {
+
+  if (regs == USART2) {
+    return &usart2;
+  }
+  if (regs == USART3) {
+    return &usart3;
+  }
+
+  fprintf(stderr, "Only USART2 and USART3 are modelled\n");
+  exit(1);
+}
+/**
+ * @brief Returns the status bit of a stream.
+ * @param stream Stream
+ * @param bit 5 - TC, 4 - HT
+ */
+static uint32_t DMA_MODEL_Flag(DMA_MODEL_Stream_TypeDef* stream, uint8_t bit) {
+
+  static const uint8_t offset[] = {0, 6, 16, 22}; // in LISR and HISR
+
+  return 1 << (offset[stream->index & 3] + bit);
+}
+/**
+ * @brief Updates the interrupts unmasked in the NVIC.
+ * @details The registers are plain memory here, so every write
+ * since the last update is seen at once. A driver call which masks
+ * and unmasks an interrupt leaves it unmasked, so a set enable bit
+ * wins. Called after every call of the driver.
+ */
+static void DMA_MODEL_SyncNvic(void) {
+
+  for (uint8_t i = 0; i < 3; i++) {
+    nvicEnabled[i] |= NVIC->ISER[i];
+    nvicEnabled[i] &= ~(NVIC->ICER[i] & ~NVIC->ISER[i]);
+    NVIC->ISER[i] = 0;
+    NVIC->ICER[i] = 0;
+  }
+}
+/**
+ * @brief Checks if an interrupt is unmasked in the NVIC.
+ */
+static uint8_t DMA_MODEL_Unmasked(IRQn_Type irq) {
+  return (nvicEnabled[irq >> 5] >> (irq & 0x1f)) & 1;
+}
+/**
+ * @brief Checks if a stream requests an interrupt.
+ */
+static uint8_t DMA_MODEL_StreamPending(DMA_MODEL_Stream_TypeDef* stream) {
+
+  return ((stream->flags & DMA_MODEL_Flag(stream, 5)) && (stream->itEnable & DMA_IT_TC)) ||
+         ((stream->flags & DMA_MODEL_Flag(stream, 4)) && (stream->itEnable & DMA_IT_HT));
+}
+/**
+ * @brief Checks if a USART requests an interrupt.
+ */
+static uint8_t DMA_MODEL_UsartPending(DMA_MODEL_Usart_TypeDef* usart) {
+
+  return (usart->idle && (usart->itEnable & (1 << (USART_IT_IDLE & 0x1f)))) ||
+         (usart->rxne && (usart->itEnable & (1 << (USART_IT_RXNE & 0x1f)))) ||
+         (usart->itEnable & (1 << (USART_IT_TXE & 0x1f))); // TXE is always set
+}
+/**
+ * @brief Starts the latency of a new interrupt request.
+ */
+static uint32_t DMA_MODEL_Latency(void) {
+  return DMA_MODEL_Random(DMA_MODEL_MAX_LATENCY);
+}
+/**
+ * @brief Takes the interrupts, which are pending, unmasked and
+ * whose latency has passed.
+ */
+static void DMA_MODEL_Interrupts(void) {
+
+  for (uint8_t i = 0; i < DMA_MODEL_STREAMS; i++) {
+
+    DMA_MODEL_Stream_TypeDef* stream = &streams[i];
+    uint8_t calls = 0;
+
+    if (stream->latency) {
+      stream->latency--;
+      continue;
+    }
+
+    while (stream->handler && DMA_MODEL_StreamPending(stream) &&
+        DMA_MODEL_Unmasked(stream->irq)) {
+
+      if (calls++ == DMA_MODEL_MAX_IRQS) {
+        DMA_MODEL_Error("stream %u: interrupt flag not cleared", i);
+        exit(1);
+      }
+
+      if (stream->flags & DMA_MODEL_Flag(stream, 4)) {
+        stream->ht++;
+      }
+      if (stream->flags & DMA_MODEL_Flag(stream, 5)) {
+        stream->tc++;
+      }
+
+      stream->handler();
+      DMA_MODEL_SyncNvic();
+    }
+  }
+
+  DMA_MODEL_Usart_TypeDef* usarts[] = {&usart2, &usart3};
+
+  for (uint8_t i = 0; i < 2; i++) {
+
+    DMA_MODEL_Usart_TypeDef* usart = usarts[i];
+    uint8_t calls = 0;
+
+    if (usart->latency) {
+      usart->latency--;
+      continue;
+    }
+
+    while (DMA_MODEL_UsartPending(usart) && DMA_MODEL_Unmasked(usart->irq)) {
+
+      if (calls++ == DMA_MODEL_MAX_IRQS) {
+        DMA_MODEL_Error("USART%u: interrupt flag not cleared", i + 2);
+        exit(1);
+      }
+
+      if (usart->idle) {
+        usart->idles++;
+      }
+
+      usart->handler();
+      DMA_MODEL_SyncNvic();
+
+      usart->idle = 0; // the handler reads SR and DR
+    }
+  }
+}
+/**
+ * @brief Sets a status bit of a stream.
+ */
+static void DMA_MODEL_SetFlag(DMA_MODEL_Stream_TypeDef* stream, uint8_t bit) {
+
+  if (!DMA_MODEL_StreamPending(stream)) {
+    stream->latency = DMA_MODEL_Latency();
+  }
+
+  stream->flags |= DMA_MODEL_Flag(stream, bit);
+}
+/**
+ * @brief Moves a byte of a stream and updates its counter and flags.
+ * @param stream Stream
+ * @return Memory address of the byte
+ */
+static uint8_t* DMA_MODEL_Move(DMA_MODEL_Stream_TypeDef* stream) {
+
+  uint8_t* mem = (uint8_t*)(uintptr_t)stream->address++;
+
+  stream->ndtr--;
+
+  if (stream->ndtr == stream->length / 2) {
+    DMA_MODEL_SetFlag(stream, 4);
+  }
+
+  if (stream->ndtr == 0) {
+    DMA_MODEL_SetFlag(stream, 5);
+    stream->completed = stream->length;
+    if (stream->circular) {
+      stream->ndtr    = stream->length;
+      stream->address = stream->m0ar;
+    } else {
+      stream->enabled = 0;
+    }
+  }
+
+  return mem;
+}
+/**
+ * @brief Returns the stream serving a USART in a direction.
+ */
+static DMA_MODEL_Stream_TypeDef* DMA_MODEL_Serving(DMA_MODEL_Usart_TypeDef* usart,
+    uint8_t toMemory) {
+
+  for (uint8_t i = 0; i < DMA_MODEL_STREAMS; i++) {
+    if (streams[i].enabled && streams[i].toMemory == toMemory &&
+        streams[i].par == (uint32_t)(uintptr_t)&usart->regs->DR) {
+      return &streams[i];
+    }
+  }
+
+  return 0;
+}
+/**
+ * @brief A byte comes on the RX line of a USART.
+ */
+static void DMA_MODEL_Receive(DMA_MODEL_Usart_TypeDef* usart, uint8_t c) {
+
+  DMA_MODEL_Stream_TypeDef* stream = DMA_MODEL_Serving(usart, 1);
+
+  usart->received = 1;
+
+  if (stream && (usart->dmaReq & USART_DMAReq_Rx)) {
+    *DMA_MODEL_Move(stream) = c;
+    return;
+  }
+
+  if (usart->rxne) {
+    DMA_MODEL_Error("USART%u: overrun", usart == &usart2 ? 2 : 3);
+  }
+
+  if (!DMA_MODEL_UsartPending(usart)) {
+    usart->latency = DMA_MODEL_Latency();
+  }
+
+  usart->rxne = 1;
+  usart->data = c;
+}
+/**
+ * @brief The RX line of a USART stays idle for a tick.
+ */
+static void DMA_MODEL_Idle(DMA_MODEL_Usart_TypeDef* usart) {
+
+  if (!usart->received) {
+    return; // IDLE is set once after data
+  }
+
+  if (!DMA_MODEL_UsartPending(usart)) {
+    usart->latency = DMA_MODEL_Latency();
+  }
+
+  usart->received = 0;
+  usart->idle     = 1;
+}
+/**
+ * @brief Checks a byte sent on the TX line.
+ */
+static void DMA_MODEL_Sent(DMA_MODEL_Usart_TypeDef* usart, uint8_t c) {
+
+  DMA_MODEL_Tx_TypeDef* tx = usart == &usart2 ? &tx2 : &tx3;
+
+  if (c != DMA_MODEL_Byte(tx->checked)) {
+    DMA_MODEL_Error("USART%u: byte %llu sent wrong", usart == &usart2 ? 2 : 3,
+        (unsigned long long)tx->checked);
+  }
+
+  tx->checked++;
+  usart->sent++;
+}
+/**
+ * @brief A byte time of the TX line of a USART.
+ */
+static void DMA_MODEL_Transmit(DMA_MODEL_Usart_TypeDef* usart) {
+
+  DMA_MODEL_Stream_TypeDef* stream = DMA_MODEL_Serving(usart, 0);
+  DMA_MODEL_Tx_TypeDef* tx = usart == &usart2 ? &tx2 : &tx3;
+  uint8_t* mem;
+
+  if (!stream) {
+    return;
+  }
+
+  if (!(usart->dmaReq & USART_DMAReq_Tx)) {
+    DMA_MODEL_Error("USART%u: TX stream runs without DMA request",
+        usart == &usart2 ? 2 : 3);
+    stream->enabled = 0;
+    return;
+  }
+
+  mem = DMA_MODEL_Move(stream);
+
+  if (mem < tx->buf || mem >= tx->buf + DMA_MODEL_TX_LEN) {
+    DMA_MODEL_Error("USART%u: DMA reads outside the ring", usart == &usart2 ? 2 : 3);
+    return;
+  }
+
+  DMA_MODEL_Sent(usart, *mem);
+}
+
+/*
+ * StdPeriph functions used by the drivers.
+ */
+
+void DMA_DeInit(DMA_Stream_TypeDef* regs) {
+
+  DMA_MODEL_Stream_TypeDef* stream = DMA_MODEL_Stream(regs);
+  IRQn_Type irq = stream->irq;
+  void (*handler)(void) = stream->handler;
+  uint8_t index = stream->index;
+
+  memset(stream, 0, sizeof(*stream));
+
+  stream->index   = index;
+  stream->irq     = irq;
+  stream->handler = handler;
+}
+
+void DMA_StructInit(DMA_InitTypeDef* init) {
+
+  memset(init, 0, sizeof(*init));
+}
+
+void DMA_Init(DMA_Stream_TypeDef* regs, DMA_InitTypeDef* init) {
+
+  DMA_MODEL_Stream_TypeDef* stream = DMA_MODEL_Stream(regs);
+
+  if (stream->enabled) {
+    DMA_MODEL_Error("stream %u: DMA_Init while enabled", stream->index);
+  }
+
+  if (init->DMA_MemoryInc != DMA_MemoryInc_Enable ||
+      init->DMA_PeripheralInc != DMA_PeripheralInc_Disable ||
+      init->DMA_MemoryDataSize != DMA_MemoryDataSize_Byte ||
+      init->DMA_PeripheralDataSize != DMA_PeripheralDataSize_Byte) {
+    DMA_MODEL_Error("stream %u: only byte transfers to a data register "
+        "are modelled", stream->index);
+  }
+
+  stream->circular = init->DMA_Mode == DMA_Mode_Circular;
+  stream->toMemory = init->DMA_DIR == DMA_DIR_PeripheralToMemory;
+  stream->par      = init->DMA_PeripheralBaseAddr;
+  stream->m0ar     = init->DMA_Memory0BaseAddr;
+  stream->ndtr     = init->DMA_BufferSize;
+}
+
+void DMA_Cmd(DMA_Stream_TypeDef* regs, FunctionalState state) {
+
+  DMA_MODEL_Stream_TypeDef* stream = DMA_MODEL_Stream(regs);
+
+  if (state == DISABLE) {
+    stream->enabled = 0;
+    return;
+  }
+
+  if (stream->enabled) {
+    return;
+  }
+
+  if (stream->flags & (DMA_MODEL_Flag(stream, 5) | DMA_MODEL_Flag(stream, 4))) {
+    DMA_MODEL_Error("stream %u: enabled with flags of previous transfer set",
+        stream->index);
+  }
+  if (stream->ndtr == 0) {
+    DMA_MODEL_Error("stream %u: enabled with NDTR 0", stream->index);
+  }
+
+  stream->enabled = 1;
+  stream->length  = stream->ndtr;
+  stream->address = stream->m0ar;
+}
+
+void DMA_SetCurrDataCounter(DMA_Stream_TypeDef* regs, uint16_t counter) {
+
+  DMA_MODEL_Stream_TypeDef* stream = DMA_MODEL_Stream(regs);
+
+  if (stream->enabled) {
+    DMA_MODEL_Error("stream %u: NDTR written while enabled", stream->index);
+    return; // the hardware ignores it
+  }
+
+  stream->ndtr = counter;
+}
+
+uint16_t DMA_GetCurrDataCounter(DMA_Stream_TypeDef* regs) {
+
+  return DMA_MODEL_Stream(regs)->ndtr;
+}
+
+void DMA_MemoryTargetConfig(DMA_Stream_TypeDef* regs, uint32_t address,
+    uint32_t target) {
+
+  DMA_MODEL_Stream_TypeDef* stream = DMA_MODEL_Stream(regs);
+
+  if (stream->enabled) {
+    DMA_MODEL_Error("stream %u: memory address written while enabled",
+        stream->index);
+    return;
+  }
+
+  if (target != DMA_Memory_0) {
+    DMA_MODEL_Error("stream %u: double buffer mode isn't modelled",
+        stream->index);
+  }
+
+  stream->m0ar = address;
+}
+
+void DMA_ClearFlag(DMA_Stream_TypeDef* regs, uint32_t flags) {
+
+  DMA_MODEL_Stream_TypeDef* stream = DMA_MODEL_Stream(regs);
+
+  stream->flags &= ~(flags & 0x0F7D0F7D);
+}
+
+void DMA_ITConfig(DMA_Stream_TypeDef* regs, uint32_t it, FunctionalState state) {
+
+  DMA_MODEL_Stream_TypeDef* stream = DMA_MODEL_Stream(regs);
+
+  if (state == ENABLE) {
+    stream->itEnable |= it;
+  } else {
+    stream->itEnable &= ~it;
+  }
+}
+
+ITStatus DMA_GetITStatus(DMA_Stream_TypeDef* regs, uint32_t it) {
+
+  DMA_MODEL_Stream_TypeDef* stream = DMA_MODEL_Stream(regs);
+  uint32_t flag = it & 0x0F7D0F7D;
+
+  if (flag == DMA_MODEL_Flag(stream, 5)) {
+    return (stream->flags & flag) && (stream->itEnable & DMA_IT_TC);
+  }
+  if (flag == DMA_MODEL_Flag(stream, 4)) {
+    return (stream->flags & flag) && (stream->itEnable & DMA_IT_HT);
+  }
+
+  DMA_MODEL_Error("stream %u: flag %08lx of another stream checked",
+      stream->index, (unsigned long)it);
+
+  return RESET;
+}
+
+void DMA_ClearITPendingBit(DMA_Stream_TypeDef* regs, uint32_t it) {
+
+  DMA_ClearFlag(regs, it);
+}
+
+void USART_Init(USART_TypeDef* regs, USART_InitTypeDef* init) {
+
+  DMA_MODEL_Usart(regs);
+}
+
+void USART_Cmd(USART_TypeDef* regs, FunctionalState state) {
+
+}
+
+void USART_ITConfig(USART_TypeDef* regs, uint16_t it, FunctionalState state) {
+
+  DMA_MODEL_Usart_TypeDef* usart = DMA_MODEL_Usart(regs);
+
+  if (state == ENABLE) {
+    usart->itEnable |= 1 << (it & 0x1f);
+  } else {
+    usart->itEnable &= ~(1 << (it & 0x1f));
+  }
+}
+
+ITStatus USART_GetITStatus(USART_TypeDef* regs, uint16_t it) {
+
+  DMA_MODEL_Usart_TypeDef* usart = DMA_MODEL_Usart(regs);
+  uint8_t flag = 0;
+
+  if (it == USART_IT_IDLE) {
+    flag = usart->idle;
+  } else if (it == USART_IT_RXNE) {
+    flag = usart->rxne;
+  } else if (it == USART_IT_TXE) {
+    flag = 1;
+  }
+
+  return flag && (usart->itEnable & (1 << (it & 0x1f)));
+}
+
+void USART_DMACmd(USART_TypeDef* regs, uint16_t req, FunctionalState state) {
+
+  DMA_MODEL_Usart_TypeDef* usart = DMA_MODEL_Usart(regs);
+
+  if (state == ENABLE) {
+    usart->dmaReq |= req;
+  } else {
+    usart->dmaReq &= ~req;
+  }
+}
+
+void USART_SendData(USART_TypeDef* regs, uint16_t data) {
+
+  DMA_MODEL_Sent(DMA_MODEL_Usart(regs), data);
+}
+
+uint16_t USART_ReceiveData(USART_TypeDef* regs) {
+
+  DMA_MODEL_Usart_TypeDef* usart = DMA_MODEL_Usart(regs);
+
+  usart->rxne = 0;
+
+  return usart->data;
+}
+
+void GPIO_Init(GPIO_TypeDef* regs, GPIO_InitTypeDef* init) {
+
+}
+
+void GPIO_PinAFConfig(GPIO_TypeDef* regs, uint16_t source, uint8_t af) {
+
+}
+
+void RCC_AHB1PeriphClockCmd(uint32_t periph, FunctionalState state) {
+
+}
+
+void RCC_APB1PeriphClockCmd(uint32_t periph, FunctionalState state) {
+
+}
+
+void TRACE_HAL_Record(uint8_t channel, const uint8_t* data, uint16_t len) {
+
+  traced[channel] += len;
+}
+
+/*
+ * Higher layer (COMM and SIM900).
+ */
+
+/**
+ * @brief Checks a block received by DMA.
+ */
+static void DMA_MODEL_RxBlock(const uint8_t* data, uint16_t len) {
+
+  DMA_MODEL_Stream_TypeDef* stream = DMA_MODEL_Stream(DMA1_Stream1);
+
+  if ((uint32_t)(uintptr_t)data < stream->m0ar ||
+      (uint32_t)(uintptr_t)(data + len) > stream->m0ar + stream->length) {
+    DMA_MODEL_Error("USART3: block outside the DMA buffer");
+    return;
+  }
+
+  for (uint16_t i = 0; i < len; i++) {
+    if (data[i] != DMA_MODEL_Byte(rxReceived)) {
+      DMA_MODEL_Error("USART3: byte %llu received wrong",
+          (unsigned long long)rxReceived);
+    }
+    rxReceived++;
+  }
+
+  rxBlocks++;
+}
+/**
+ * @brief Byte received with RXNE (not used in DMA mode).
+ */
+static void DMA_MODEL_RxByte(uint8_t c) {
+
+  DMA_MODEL_Error("USART%u: byte received without DMA", usart2.rxne ? 2 : 3);
+}
+/**
+ * @brief Byte to send with TXE (not used in DMA mode).
+ */
+static uint8_t DMA_MODEL_TxByte(uint8_t* c) {
+
+  DMA_MODEL_Error("USART: byte sent without DMA");
+
+  return 0;
+}
+/**
+ * @brief Returns the contiguous data of a ring.
+ */
+static uint16_t DMA_MODEL_Peek(DMA_MODEL_Tx_TypeDef* tx, uint8_t** data) {
+
+  uint16_t count  = tx->head - tx->tail;
+  uint16_t offset = tx->tail & (DMA_MODEL_TX_LEN - 1);
+
+  *data = &tx->buf[offset];
+
+  if (count > DMA_MODEL_TX_LEN - offset) {
+    count = DMA_MODEL_TX_LEN - offset;
+  }
+
+  if (count) {
+    tx->transfers++;
+    if (offset + count == DMA_MODEL_TX_LEN) {
+      tx->wraps++;
+    }
+  }
+
+  return count;
+}
+/**
+ * @brief Releases data sent by DMA from a ring.
+ */
+static void DMA_MODEL_Done(DMA_MODEL_Tx_TypeDef* tx, uint16_t len) {
+
+  if (tx->stream->enabled || len != tx->stream->completed) {
+    DMA_MODEL_Error("stream %u: %u bytes released, transfer of %u %s",
+        tx->stream->index, len, tx->stream->completed,
+        tx->stream->enabled ? "still running" : "completed");
+  }
+
+  if (len > (uint16_t)(tx->head - tx->tail)) {
+    DMA_MODEL_Error("stream %u: more bytes released than pushed", tx->stream->index);
+    return;
+  }
+
+  tx->tail += len;
+  tx->stream->completed = 0;
+}
+
+static uint16_t DMA_MODEL_Peek2(uint8_t** data) { return DMA_MODEL_Peek(&tx2, data); }
+static uint16_t DMA_MODEL_Peek3(uint8_t** data) { return DMA_MODEL_Peek(&tx3, data); }
+static void DMA_MODEL_Done2(uint16_t len) { DMA_MODEL_Done(&tx2, len); }
+static void DMA_MODEL_Done3(uint16_t len) { DMA_MODEL_Done(&tx3, len); }
+
+/**
+ * @brief Main loop side of a transmitter - pushes data now and then,
+ * masks the interrupts for a while.
+ * @param tx Transmitter
+ * @param more Nonzero - push more data
+ */
+static void DMA_MODEL_MainTx(DMA_MODEL_Tx_TypeDef* tx, uint8_t more) {
+
+  if (tx->lockTicks) {
+
+    // bytes in flight stay put while the transmitter is masked
+    if (tx->stream->enabled && tx->txInFlight() != tx->stream->length) {
+      DMA_MODEL_Error("stream %u: %u bytes in flight, transfer of %u",
+          tx->stream->index, tx->txInFlight(), tx->stream->length);
+    }
+    if (--tx->lockTicks == 0) {
+      if (!tx->stream->enabled && tx->stream->completed) {
+        tx->locked++; // TC waits for the interrupt
+      }
+      tx->txUnlock();
+      DMA_MODEL_SyncNvic();
+    }
+    return;
+  }
+
+  if (more && DMA_MODEL_Random(4) == 0) {
+
+    uint16_t n = DMA_MODEL_Random(DMA_MODEL_TX_LEN / 2) + 1;
+
+    while (n-- && (uint16_t)(tx->head - tx->tail) < DMA_MODEL_TX_LEN) {
+      tx->buf[tx->head++ & (DMA_MODEL_TX_LEN - 1)] = DMA_MODEL_Byte(tx->pushed++);
+    }
+
+    tx->txEnable();
+    DMA_MODEL_SyncNvic();
+  }
+
+  if (more && DMA_MODEL_Random(64) == 0) {
+    tx->txLock();
+    DMA_MODEL_SyncNvic();
+    tx->lockTicks = DMA_MODEL_Random(DMA_MODEL_MAX_LOCK) + 1;
+  }
+}
+/**
+ * @brief Length of the next burst received on USART3 - around the
+ * half and the whole DMA buffer or random.
+ */
+static uint32_t DMA_MODEL_Burst(void) {
+
+  static const uint16_t lengths[] = {1, 2, 127, 128, 129, 255, 256, 257, 512, 1000};
+
+  if (DMA_MODEL_Random(2)) {
+    return lengths[DMA_MODEL_Random(sizeof(lengths) / sizeof(lengths[0]))];
+  }
+
+  return DMA_MODEL_Random(300) + 1;
+}
+/**
+ * @brief Maps a page of registers, which the drivers access directly.
+ */
+static void DMA_MODEL_Map(uint32_t address) {
+
+  void* page = (void*)(uintptr_t)(address & ~(DMA_MODEL_PAGE - 1));
+
+  if (mmap(page, DMA_MODEL_PAGE, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) != page) {
+    perror("Mapping registers");
+    exit(1);
+  }
+}
+
+int main(int argc, char* argv[]) {
+
+  uint64_t total = 1000000;
+  uint32_t burst = 0;
+  uint32_t gap = 0;
+  uint32_t ticks = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+    switch (opt) {
+    case 'n': total = strtoull(optarg, 0, 0); break;
+    case 's': seed = strtoul(optarg, 0, 0) | 1; break;
+    default:
+      fprintf(stderr, "Usage: %s [-n bytes] [-s seed]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  DMA_MODEL_Map(USART2_BASE); // USART3 is on the same page
+  DMA_MODEL_Map((uint32_t)(uintptr_t)NVIC);
+
+  DMA_MODEL_Stream(DMA1_Stream1)->irq     = DMA1_Stream1_IRQn;
+  DMA_MODEL_Stream(DMA1_Stream1)->handler = DMA1_Stream1_IRQHandler;
+  DMA_MODEL_Stream(DMA1_Stream3)->irq     = DMA1_Stream3_IRQn;
+  DMA_MODEL_Stream(DMA1_Stream3)->handler = DMA1_Stream3_IRQHandler;
+  DMA_MODEL_Stream(DMA1_Stream6)->irq     = DMA1_Stream6_IRQn;
+  DMA_MODEL_Stream(DMA1_Stream6)->handler = DMA1_Stream6_IRQHandler;
+  tx2.stream = DMA_MODEL_Stream(DMA1_Stream6);
+  tx3.stream = DMA_MODEL_Stream(DMA1_Stream3);
+
+  UART2_Init(115200, DMA_MODEL_RxByte, DMA_MODEL_TxByte);
+  UART2_TxDmaInit(DMA_MODEL_Peek2, DMA_MODEL_Done2);
+  UART3_Init(115200, DMA_MODEL_RxByte, DMA_MODEL_TxByte);
+  UART3_TxDmaInit(DMA_MODEL_Peek3, DMA_MODEL_Done3);
+  UART3_RxDmaInit(DMA_MODEL_RxBlock);
+  DMA_MODEL_SyncNvic();
+
+  while (rxSent < total || tx2.checked < tx2.pushed || tx3.checked < tx3.pushed ||
+      rxReceived < rxSent) {
+
+    uint8_t more = rxSent < total;
+
+    if (!more && ticks++ == DMA_MODEL_DRAIN) {
+      DMA_MODEL_Error("transfers not finished");
+      break;
+    }
+
+    // main loop
+    DMA_MODEL_MainTx(&tx2, more);
+    DMA_MODEL_MainTx(&tx3, more);
+
+    // lines
+    if (burst) {
+      DMA_MODEL_Receive(&usart3, DMA_MODEL_Byte(rxSent++));
+      if (--burst == 0) {
+        gap = DMA_MODEL_Random(3) ? DMA_MODEL_Random(20) + 1 : 0; // back to back
+      }
+    } else if (gap) {
+      DMA_MODEL_Idle(&usart3);
+      gap--;
+    } else if (more) {
+      burst = DMA_MODEL_Burst();
+      if (burst > total - rxSent) {
+        burst = total - rxSent;
+      }
+    } else {
+      DMA_MODEL_Idle(&usart3);
+    }
+
+    DMA_MODEL_Transmit(&usart2);
+    DMA_MODEL_Transmit(&usart3);
+
+    // interrupts
+    DMA_MODEL_Interrupts();
+  }
+
+  printf("USART3 RX: %llu bytes in %u blocks, %u HT, %u TC (wraps), %u IDLE\n",
+      (unsigned long long)rxReceived, (unsigned)rxBlocks,
+      (unsigned)streams[1].ht, (unsigned)streams[1].tc, (unsigned)usart3.idles);
+
+  DMA_MODEL_Tx_TypeDef* txs[] = {&tx2, &tx3};
+
+  for (uint8_t i = 0; i < 2; i++) {
+    printf("USART%u TX: %llu bytes in %u transfers, %u at the end of the "
+        "ring, %u completed while masked\n", i + 2,
+        (unsigned long long)txs[i]->checked, (unsigned)txs[i]->transfers,
+        (unsigned)txs[i]->wraps, (unsigned)txs[i]->locked);
+  }
+
+  if (traced[TRACE_HAL_UART3_RX] != rxReceived ||
+      traced[TRACE_HAL_UART2_TX] != tx2.checked ||
+      traced[TRACE_HAL_UART3_TX] != tx3.checked) {
+    DMA_MODEL_Error("capture hook saw different data");
+  }
+
+  printf(errors ? "FAILED\n" : "OK\n");
+
+  return errors != 0;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,553 @@
+/**
+ * @file:   fleet.c
+ * @brief:  Load simulator running many instances of the application
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details Every instance has its own COMM, SIM900 and TIMER contexts
+ * (see instance_hal.h) and its own emulated modem. Instances are spread
+ * over a pool of threads, one per core by default. At start every
+ * instance gets a burst of SMS requests from the "backend" (like the
+ * whole fleet coming back after an outage): a :FLEET number command
+ * is received by COMM, the handler sends AT+CMGS and the message text
+ * through SIM900, and when the modem confirms it, the result goes back
+ * through COMM and the next request comes. The latency of a message is
+ * the time from the request to the confirmation.
+ *
+ * Usage:
+ *   stm32f4_sim900_fleet [-t threads] [-m messages] [-l latency] [N...]
+ *
+ * - threads - size of the thread pool (default - number of cores)
+ * - messages - messages sent by every instance (default 100)
+ * - latency - response time of the modems in ms (default 0)
+ * - N - numbers of instances, one run each (default 1 4 16 64 256 1024)
+ *
+ * A line with the throughput and latency percentiles is printed for
+ * every run.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#define _GNU_SOURCE
+
+#include <comm.h>
+#include <sim900.h>
+#include <timers.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @defgroup  FLEET FLEET
+ * @brief     Load simulator running many instances of the application.
+ */
+
+/**
+ * @addtogroup FLEET
+ * @{
+ */
+
+#define FLEET_TICK_FREQ   1000  ///< Frequency of the system time (as in main.c)
+#define FLEET_CMD_TIMEOUT 10000 ///< Timeout of AT+CMGS in ms
+#define FLEET_REPLY_LEN   64    ///< Size of the modem output buffer
+#define FLEET_MAX_RUNS    32    ///< Maximum number of instance counts
+#define FLEET_MAX_WAIT    1000000 ///< Maximum sleep of an idle thread in ns (timers need ms resolution)
+#define FLEET_TEXT "Power restored, device back online." ///< Message text
+
+/**
+ * @brief Instance of the application with its emulated modem.
+ */
+typedef struct {
+  COMM_Context_TypeDef*   comm;   ///< COMM state
+  SIM900_Context_TypeDef* sim900; ///< SIM900 state
+  TIMER_Context_TypeDef*  timers; ///< TIMER state
+  char     modemCmd[SIM900_FRAME_LEN]; ///< Command received by the modem
+  uint16_t modemCmdLen;         ///< Length of modemCmd
+  uint8_t  modemData;           ///< Nonzero - modem receives the message text
+  uint32_t modemRef;            ///< Reference number of the last message
+  uint8_t  reply[FLEET_REPLY_LEN]; ///< Modem output waiting for replyTime
+  uint16_t replyLen;            ///< Length of reply
+  uint64_t replyTime;           ///< Time the reply is sent in ns
+  uint32_t sent;                ///< Requests sent
+  uint32_t done;                ///< Messages confirmed by the modem
+  uint32_t failed;              ///< Messages not sent
+  uint64_t requestTime;         ///< Time of the current request in ns
+  uint32_t* latency;            ///< Latency of every message in us
+  uint64_t commBytes;           ///< Bytes sent to the backend
+} FLEET_Instance_TypeDef;
+
+/**
+ * @brief Thread of the pool.
+ */
+typedef struct {
+  pthread_t thread;             ///< Thread
+  uint32_t  index;              ///< Thread number
+  FLEET_Instance_TypeDef* instances; ///< Instances of this thread
+  uint32_t  count;              ///< Number of instances
+  uint64_t  start;              ///< Start of the run in ns
+  uint64_t  end;                ///< End of the run in ns
+} FLEET_Thread_TypeDef;
+
+static uint32_t messages = 100; ///< Messages sent by every instance
+static uint64_t latency;        ///< Modem latency in ns
+static pthread_barrier_t barrier; ///< Starts all threads of a run at once
+static __thread FLEET_Instance_TypeDef* current; ///< Instance running on this thread
+
+uint16_t COMM_TxPeekCallback(uint8_t** data);
+void     COMM_TxDoneCallback(uint16_t len);
+void     COMM_RxCallback(uint8_t c);
+uint16_t SIM900_TxPeekCallback(uint8_t** data);
+void     SIM900_TxDoneCallback(uint16_t len);
+void     SIM900_RxBlockCallback(const uint8_t* data, uint16_t len);
+
+/**
+ * @brief Prints to the standard output file descriptor
+ * (stdout itself is redirected to COMM).
+ */
+static void FLEET_Print(const char* fmt, ...) {
+
+  va_list args;
+
+  va_start(args, fmt);
+  vdprintf(STDOUT_FILENO, fmt, args);
+  va_end(args);
+}
+/**
+ * @brief Returns the monotonic time in ns.
+ */
+static uint64_t FLEET_Now(void) {
+
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+/**
+ * @brief Makes an instance current on the calling thread.
+ * @param inst Instance
+ */
+static void FLEET_Switch(FLEET_Instance_TypeDef* inst) {
+
+  current = inst;
+  COMM_SetContext(inst->comm);
+  SIM900_SetContext(inst->sim900);
+  TIMER_SetContext(inst->timers);
+}
+/**
+ * @brief Allocates a context aligned to a cache line, so instances
+ * on different cores don't share lines.
+ * @param size Context size
+ * @return Context
+ */
+static void* FLEET_Alloc(uint32_t size) {
+
+  void* mem = aligned_alloc(64, (size + 63) & ~63);
+
+  if (!mem) {
+    perror("fleet");
+    exit(1);
+  }
+
+  return mem;
+}
+/**
+ * @brief Queues modem output.
+ * @details Output which doesn't fit in the buffer is dropped whole,
+ * like a lost line - the command times out and the message counts
+ * as failed.
+ * @param inst Instance
+ * @param fmt Format string (printf)
+ */
+static void FLEET_ModemReply(FLEET_Instance_TypeDef* inst, const char* fmt, ...) {
+
+  va_list args;
+  int n;
+
+  va_start(args, fmt);
+  n = vsnprintf((char*)&inst->reply[inst->replyLen],
+      FLEET_REPLY_LEN - inst->replyLen, fmt, args);
+  va_end(args);
+
+  if (n < 0 || n >= FLEET_REPLY_LEN - inst->replyLen) {
+    return; // doesn't fit (n is the untruncated length)
+  }
+
+  inst->replyLen += n;
+
+  inst->replyTime = FLEET_Now() + latency;
+}
+/**
+ * @brief Emulates the modem (echo off): AT+CMGS gets the prompt,
+ * the text ended with Ctrl+Z gets +CMGS and OK, other commands OK.
+ * @param inst Instance
+ * @param data Data sent by SIM900
+ * @param len Data length
+ */
+static void FLEET_ModemInput(FLEET_Instance_TypeDef* inst,
+    const uint8_t* data, uint16_t len) {
+
+  while (len--) {
+
+    uint8_t c = *data++;
+
+    if (inst->modemData) {
+      if (c == 0x1a) {
+        inst->modemData = 0;
+        FLEET_ModemReply(inst, "\r\n+CMGS: %u\r\n\r\nOK\r\n",
+            (unsigned)(++inst->modemRef & 0xff));
+      }
+      continue; // message text
+    }
+
+    if (c != '\r') {
+      if (inst->modemCmdLen < sizeof(inst->modemCmd) - 1) {
+        inst->modemCmd[inst->modemCmdLen++] = c;
+      }
+      continue;
+    }
+
+    inst->modemCmd[inst->modemCmdLen] = 0;
+    inst->modemCmdLen = 0;
+
+    if (!strncmp(inst->modemCmd, "AT+CMGS=", 8)) {
+      inst->modemData = 1;
+      FLEET_ModemReply(inst, "\r\n> ");
+    } else if (inst->modemCmd[0]) {
+      FLEET_ModemReply(inst, "\r\nOK\r\n");
+    }
+  }
+}
+/**
+ * @brief Sends the next request from the backend to the current instance.
+ */
+static void FLEET_Request(void) {
+
+  char frame[32];
+  int len = snprintf(frame, sizeof(frame), ":FLEET +48600%06u\r",
+      (unsigned)current->sent);
+
+  current->sent++;
+  current->requestTime = FLEET_Now();
+
+  for (int i = 0; i < len; i++) {
+    COMM_RxCallback(frame[i]);
+  }
+}
+/**
+ * @brief Called when the modem confirms a message (or it fails).
+ * @param result Result of AT+CMGS
+ * @param ctx Instance
+ */
+static void FLEET_SmsCallback(uint8_t result, void* ctx) {
+
+  FLEET_Instance_TypeDef* inst = ctx;
+  char reply[16];
+  uint32_t n = inst->done + inst->failed;
+
+  inst->latency[n] = (FLEET_Now() - inst->requestTime) / 1000;
+
+  if (result == SIM900_RESULT_OK) {
+    inst->done++;
+  } else {
+    inst->failed++;
+  }
+
+  snprintf(reply, sizeof(reply), "+FLEET %u\r", (unsigned)result);
+  COMM_Write((uint8_t*)reply, strlen(reply));
+
+  if (inst->sent < messages) {
+    FLEET_Request();
+  }
+}
+/**
+ * @brief Sends an SMS (:FLEET number).
+ */
+static void FLEET_Sms(COMM_Arg_TypeDef* argv) {
+
+  char cmd[32];
+
+  snprintf(cmd, sizeof(cmd), "AT+CMGS=\"%s\"\r", argv[0].s);
+
+  if (SIM900_SendCommandData(cmd, FLEET_TEXT, SIM900_RESULT_OK,
+      FLEET_CMD_TIMEOUT, FLEET_SmsCallback, current)) {
+    FLEET_SmsCallback(SIM900_RESULT_ERROR, current);
+  }
+}
+COMM_COMMAND(FLEET, "p", FLEET_Sms);
+
+/**
+ * @brief Runs the main loop of an instance once.
+ * @param inst Instance
+ * @param now Current time in ns
+ * @retval 1 Something was done
+ * @retval 0 Instance is idle
+ */
+static uint8_t FLEET_Step(FLEET_Instance_TypeDef* inst, uint64_t now) {
+
+  uint8_t frame[COMM_FRAME_LEN];
+  uint8_t len;
+  uint8_t ret;
+  uint8_t* data;
+  uint16_t n;
+  uint8_t work = 0;
+
+  FLEET_Switch(inst);
+
+  if (inst->replyLen && now >= inst->replyTime) { // "UART interrupt"
+    SIM900_RxBlockCallback(inst->reply, inst->replyLen);
+    inst->replyLen = 0;
+    work = 1;
+  }
+
+  while ((ret = COMM_GetFrame(frame, &len)) != 1) {
+    if (ret == 0) {
+      COMM_Dispatch((char*)frame);
+    }
+    work = 1;
+  }
+
+  if (SIM900_FramePending()) {
+    SIM900_Update();
+    work = 1;
+  }
+
+  TIMER_SoftTimersUpdate();
+
+  while ((n = SIM900_TxPeekCallback(&data)) != 0) { // "DMA"
+    FLEET_ModemInput(inst, data, n);
+    SIM900_TxDoneCallback(n);
+    work = 1;
+  }
+
+  while ((n = COMM_TxPeekCallback(&data)) != 0) {
+    inst->commBytes += n;
+    COMM_TxDoneCallback(n);
+  }
+
+  return work;
+}
+/**
+ * @brief Thread of the pool - runs its instances round robin.
+ * @param arg Thread
+ */
+static void* FLEET_Worker(void* arg) {
+
+  FLEET_Thread_TypeDef* thread = arg;
+  FLEET_Instance_TypeDef* inst;
+  cpu_set_t cpus;
+
+  CPU_ZERO(&cpus); // one thread per core (if possible)
+  CPU_SET(thread->index % sysconf(_SC_NPROCESSORS_ONLN), &cpus);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+  // contexts are allocated here, so they are local to the core
+  for (uint32_t i = 0; i < thread->count; i++) {
+
+    inst = &thread->instances[i];
+    inst->comm    = FLEET_Alloc(COMM_ContextSize());
+    inst->sim900  = FLEET_Alloc(SIM900_ContextSize());
+    inst->timers  = FLEET_Alloc(TIMER_ContextSize());
+    inst->latency = FLEET_Alloc(messages * sizeof(uint32_t));
+
+    COMM_ContextInit(inst->comm);
+    SIM900_ContextInit(inst->sim900);
+    TIMER_ContextInit(inst->timers);
+  }
+
+  pthread_barrier_wait(&barrier);
+  thread->start = FLEET_Now();
+
+  for (uint32_t i = 0; i < thread->count; i++) {
+    FLEET_Switch(&thread->instances[i]);
+    FLEET_Request(); // all requests come at once
+  }
+
+  while (1) {
+
+    uint64_t now = FLEET_Now();
+    uint64_t wake = now + FLEET_MAX_WAIT;
+    uint8_t work = 0;
+    uint32_t active = 0;
+
+    for (uint32_t i = 0; i < thread->count; i++) {
+
+      inst = &thread->instances[i];
+
+      if (inst->done + inst->failed == messages) {
+        continue;
+      }
+
+      active++;
+      work |= FLEET_Step(inst, now);
+
+      if (inst->replyLen && inst->replyTime < wake) {
+        wake = inst->replyTime;
+      }
+    }
+
+    if (!active) {
+      thread->end = FLEET_Now();
+      break;
+    }
+
+    if (!work) { // sleep until the next modem reply
+      struct timespec until = {wake / 1000000000, wake % 1000000000};
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, 0);
+    }
+  }
+
+  FLEET_Switch(&(FLEET_Instance_TypeDef){0}); // back to the default contexts
+
+  return 0;
+}
+/**
+ * @brief Compares latencies (qsort).
+ */
+static int FLEET_Compare(const void* a, const void* b) {
+
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+
+  return (x > y) - (x < y);
+}
+/**
+ * @brief Runs a number of instances and prints the results.
+ * @param count Number of instances
+ * @param threadCount Size of the thread pool
+ */
+static void FLEET_Run(uint32_t count, uint32_t threadCount) {
+
+  FLEET_Instance_TypeDef* instances = calloc(count, sizeof(FLEET_Instance_TypeDef));
+  FLEET_Thread_TypeDef* threads;
+  uint32_t* all = malloc((size_t)count * messages * sizeof(uint32_t));
+  uint64_t done = 0, failed = 0, n = 0;
+  uint64_t start = UINT64_MAX, end = 0;
+  double seconds;
+
+  if (threadCount > count) {
+    threadCount = count;
+  }
+
+  threads = calloc(threadCount, sizeof(FLEET_Thread_TypeDef));
+
+  if (!instances || !threads || !all) {
+    perror("fleet");
+    exit(1);
+  }
+
+  pthread_barrier_init(&barrier, 0, threadCount + 1);
+
+  for (uint32_t t = 0, first = 0; t < threadCount; t++) {
+
+    threads[t].index     = t;
+    threads[t].instances = &instances[first];
+    threads[t].count     = count / threadCount + (t < count % threadCount);
+    first += threads[t].count;
+
+    if (pthread_create(&threads[t].thread, 0, FLEET_Worker, &threads[t])) {
+      perror("fleet");
+      exit(1);
+    }
+  }
+
+  pthread_barrier_wait(&barrier);
+
+  for (uint32_t t = 0; t < threadCount; t++) {
+    pthread_join(threads[t].thread, 0);
+    if (threads[t].start < start) {
+      start = threads[t].start;
+    }
+    if (threads[t].end > end) {
+      end = threads[t].end;
+    }
+  }
+
+  seconds = (end - start) / 1e9;
+
+  for (uint32_t i = 0; i < count; i++) {
+    done   += instances[i].done;
+    failed += instances[i].failed;
+    memcpy(&all[n], instances[i].latency, messages * sizeof(uint32_t));
+    n += messages;
+    free(instances[i].comm);
+    free(instances[i].sim900);
+    free(instances[i].timers);
+    free(instances[i].latency);
+  }
+
+  qsort(all, n, sizeof(uint32_t), FLEET_Compare);
+
+  FLEET_Print("%9u %7u %9llu %6llu %8.3f %10.0f %8u %8u %8u %8u\n",
+      (unsigned)count, (unsigned)threadCount, (unsigned long long)done,
+      (unsigned long long)failed, seconds, done / seconds,
+      (unsigned)all[n / 2], (unsigned)all[n * 99 / 100],
+      (unsigned)all[n * 999 / 1000], (unsigned)all[n - 1]);
+
+  pthread_barrier_destroy(&barrier);
+  free(all);
+  free(threads);
+  free(instances);
+}
+
+int main(int argc, char* argv[]) {
+
+  uint32_t threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t counts[FLEET_MAX_RUNS] = {1, 4, 16, 64, 256, 1024};
+  uint32_t runs = 6;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:m:l:")) != -1) {
+    switch (opt) {
+    case 't': threadCount = atoi(optarg); break;
+    case 'm': messages = atoi(optarg); break;
+    case 'l': latency = (uint64_t)atoi(optarg) * 1000000; break;
+    default:
+      fprintf(stderr, "Usage: %s [-t threads] [-m messages] [-l latency_ms] [instances...]\n",
+          argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind < argc) {
+    for (runs = 0; optind < argc && runs < FLEET_MAX_RUNS; optind++) {
+      counts[runs++] = atoi(argv[optind]);
+    }
+  }
+
+  if (threadCount == 0 || messages == 0) {
+    fprintf(stderr, "Threads and messages have to be nonzero\n");
+    return 1;
+  }
+
+  TIMER_Init(FLEET_TICK_FREQ); // system time shared by all instances
+
+  FLEET_Print("# STM32F4_SIM900 fleet, %u messages per instance, modem latency %u ms\n",
+      (unsigned)messages, (unsigned)(latency / 1000000));
+  FLEET_Print("# instances threads  messages failed  seconds      msg/s   p50_us   p99_us  p999_us   max_us\n");
+
+  for (uint32_t i = 0; i < runs; i++) {
+    if (counts[i]) {
+      FLEET_Run(counts[i], threadCount);
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @}
+ */
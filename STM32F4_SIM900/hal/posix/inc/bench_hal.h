@@ -0,0 +1,84 @@
+/**
+ * @file:   bench_hal.h
+ * @brief:  HAL for the benchmarks - POSIX port
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details Counts nanoseconds of the monotonic clock. Results go
+ * directly to the standard output file descriptor (stdout itself
+ * is redirected to COMM).
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef BENCH_HAL_H_
+#define BENCH_HAL_H_
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @defgroup  BENCH_HAL BENCH_HAL
+ * @brief     HAL - benchmarks.
+ */
+
+/**
+ * @addtogroup BENCH_HAL
+ * @{
+ */
+
+#define BENCH_HAL_UNIT "ns" ///< What the counter counts
+
+/**
+ * @brief Starts the counter.
+ */
+static inline void BENCH_HAL_Init(void) {
+
+}
+/**
+ * @brief Reads the counter.
+ * @return Counter value (wraps around)
+ */
+static inline uint32_t BENCH_HAL_Count(void) {
+
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint32_t)((uint64_t)now.tv_sec * 1000000000 + now.tv_nsec);
+}
+/**
+ * @brief Writes a string to the host console.
+ * @param str String
+ */
+static inline void BENCH_HAL_Print(const char* str) {
+
+  if (write(STDOUT_FILENO, str, strlen(str)) < 0) {
+    return; // nothing to report it to
+  }
+}
+/**
+ * @brief Ends the program.
+ * @param status Exit status
+ */
+static inline void BENCH_HAL_Exit(int status) {
+
+  _exit(status);
+}
+
+/**
+ * @}
+ */
+
+#endif /* BENCH_HAL_H_ */
@@ -0,0 +1,31 @@
+/**
+ * @file:   crc_hal.h
+ * @brief:  HAL for the CRC calculation unit - POSIX port
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details The host has no CRC unit (CRC_HAL_HW isn't defined),
+ * so the software implementation is used.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef CRC_HAL_H_
+#define CRC_HAL_H_
+
+#include <inttypes.h>
+
+/**
+ * @defgroup  CRC_HAL CRC_HAL
+ * @brief     HAL - CRC calculation unit.
+ */
+
+#endif /* CRC_HAL_H_ */
@@ -0,0 +1,50 @@
+/**
+ * @file:   instance_hal.h
+ * @brief:  HAL for instances of the application - POSIX port
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details The pointer to the current context is thread local, so
+ * every thread can run its own instances (see hal/posix/fleet).
+ * It points at the default context in new threads, so the
+ * interrupt thread always works on the default instance.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef INSTANCE_HAL_H_
+#define INSTANCE_HAL_H_
+
+/**
+ * @defgroup  INSTANCE_HAL INSTANCE_HAL
+ * @brief     HAL - instances of the application.
+ */
+
+/**
+ * @addtogroup INSTANCE_HAL
+ * @{
+ */
+
+#define INSTANCE_CONTEXTS 1 ///< Nonzero - contexts can be switched (see e.g. COMM_SetContext)
+
+/**
+ * @brief Defines the pointer to the current context of a module.
+ * @param type Context type
+ * @param name Pointer name
+ * @param init Default context
+ */
+#define INSTANCE_POINTER(type, name, init) static __thread type* name = (init)
+
+/**
+ * @}
+ */
+
+#endif /* INSTANCE_HAL_H_ */
@@ -0,0 +1,56 @@
+/**
+ * @file:   log_hal.h
+ * @brief:  HAL for the deferred log - POSIX port
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef LOG_HAL_H_
+#define LOG_HAL_H_
+
+#include <posix_hal.h>
+
+/**
+ * @defgroup  LOG_HAL LOG_HAL
+ * @brief     HAL - deferred log.
+ */
+
+/**
+ * @addtogroup LOG_HAL
+ * @{
+ */
+
+/**
+ * @brief Enters a critical section (records are written from
+ * the main loop and from interrupts).
+ * @return Value for LOG_HAL_Unlock
+ */
+static inline uint32_t LOG_HAL_Lock(void) {
+
+  POSIX_HAL_IrqLock();
+  return 0;
+}
+/**
+ * @brief Leaves a critical section.
+ * @param state Value returned by LOG_HAL_Lock
+ */
+static inline void LOG_HAL_Unlock(uint32_t state) {
+
+  POSIX_HAL_IrqUnlock();
+}
+
+/**
+ * @}
+ */
+
+#endif /* LOG_HAL_H_ */
@@ -0,0 +1,60 @@
+/**
+ * @file:   posix_hal.h
+ * @brief:  Core of the POSIX (Linux host) HAL port
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details The host port runs the unmodified application on Linux.
+ * Interrupts are emulated by a single thread waiting for file
+ * descriptors (timerfd for SysTick, pseudo-terminals for UARTs,
+ * control socket for LEDs and keys). Handlers run with the
+ * interrupt lock taken, so they never run in parallel with each
+ * other or with code which "disables interrupts".
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef POSIX_HAL_H_
+#define POSIX_HAL_H_
+
+#include <inttypes.h>
+
+/**
+ * @defgroup  POSIX_HAL POSIX_HAL
+ * @brief     HAL - Linux host port.
+ */
+
+/**
+ * @addtogroup POSIX_HAL
+ * @{
+ */
+
+#define POSIX_HAL_MAX_SOURCES 8 ///< Maximum number of interrupt sources
+
+void POSIX_HAL_IrqLock    (void);
+void POSIX_HAL_IrqUnlock  (void);
+void POSIX_HAL_AddSource  (int fd, short events, void (*handler)(int fd, short revents));
+void POSIX_HAL_SetEvents  (int fd, short events);
+void POSIX_HAL_Wait       (void);
+void POSIX_HAL_SetIdleHook(uint8_t (*hook)(void));
+int  POSIX_HAL_OpenPty    (const char* name, const char* linkVar, uint32_t baud);
+void POSIX_HAL_Control    (const char* fmt, ...);
+void POSIX_HAL_ControlInit(void);
+
+// Board state for the control socket (led_hal.c, keys_hal.c)
+uint8_t LED_HAL_GetState  (uint8_t led);
+void KEYS_HAL_SetKey      (uint8_t row, uint8_t col, uint8_t pressed);
+
+/**
+ * @}
+ */
+
+#endif /* POSIX_HAL_H_ */
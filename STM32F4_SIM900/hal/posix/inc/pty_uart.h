@@ -0,0 +1,60 @@
+/**
+ * @file:   pty_uart.h
+ * @brief:  Serial port emulated with a pseudo-terminal (POSIX port)
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef PTY_UART_H_
+#define PTY_UART_H_
+
+#include <inttypes.h>
+
+/**
+ * @addtogroup POSIX_HAL
+ * @{
+ */
+
+#define PTY_UART_BUF_LEN 256 ///< Size of read and write blocks
+
+/**
+ * @brief Emulated serial port.
+ */
+typedef struct {
+  const char* name;     ///< Port name for messages
+  const char* linkVar;  ///< Environment variable with symlink name for the pty
+  int fd;               ///< Pseudo-terminal master (-1 - not initialized)
+  uint8_t channel;      ///< Trace channel of received data (transmitted - channel + 1)
+  uint8_t discard;      ///< Nonzero - transmitted data is dropped instead of written (replay)
+  uint32_t discarded;   ///< Number of dropped bytes
+  void     (*rxCallback)(uint8_t);                  ///< Received byte
+  uint8_t  (*txCallback)(uint8_t*);                 ///< Next byte to send
+  uint16_t (*txPeekCallback)(uint8_t**);            ///< Contiguous data to send ("DMA" mode)
+  void     (*txDoneCallback)(uint16_t);             ///< Releases sent data ("DMA" mode)
+  void     (*rxBlockCallback)(const uint8_t*, uint16_t); ///< Received block ("DMA" mode)
+  uint8_t  txBuf[PTY_UART_BUF_LEN]; ///< Bytes taken from txCallback, not written yet
+  uint16_t txLen;                   ///< Number of bytes in txBuf
+} PTY_UART_TypeDef;
+
+void PTY_UART_Init     (PTY_UART_TypeDef* uart, uint32_t baud,
+    void (*handler)(int fd, short revents));
+void PTY_UART_TxEnable (PTY_UART_TypeDef* uart);
+void PTY_UART_Handler  (PTY_UART_TypeDef* uart, short revents);
+void PTY_UART_Receive  (PTY_UART_TypeDef* uart, const uint8_t* data, uint16_t len);
+PTY_UART_TypeDef* PTY_UART_Find(uint8_t channel);
+
+/**
+ * @}
+ */
+
+#endif /* PTY_UART_H_ */
@@ -0,0 +1,67 @@
+/**
+ * @file:   trace_hal.h
+ * @brief:  HAL for UART traffic capture - POSIX port
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details Same channels as on the target, the pseudo-terminal
+ * UARTs record every block read and written.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef TRACE_HAL_H_
+#define TRACE_HAL_H_
+
+#include <posix_hal.h>
+
+/**
+ * @defgroup  TRACE_HAL TRACE_HAL
+ * @brief     HAL - UART traffic capture.
+ */
+
+/**
+ * @addtogroup TRACE_HAL
+ * @{
+ */
+
+#define TRACE_HAL_UART2_RX 0 ///< Received on USART2 (PC)
+#define TRACE_HAL_UART2_TX 1 ///< Transmitted on USART2 (PC)
+#define TRACE_HAL_UART3_RX 2 ///< Received on USART3 (SIM900)
+#define TRACE_HAL_UART3_TX 3 ///< Transmitted on USART3 (SIM900)
+#define TRACE_HAL_CHANNELS 4 ///< Number of channels
+
+void TRACE_HAL_SetCallback(void (*callback)(uint8_t channel, const uint8_t* data, uint16_t len));
+void TRACE_HAL_Record(uint8_t channel, const uint8_t* data, uint16_t len);
+
+/**
+ * @brief Enters a critical section (all UART interrupts record).
+ * @return Value for TRACE_HAL_Unlock
+ */
+static inline uint32_t TRACE_HAL_Lock(void) {
+
+  POSIX_HAL_IrqLock();
+  return 0;
+}
+/**
+ * @brief Leaves a critical section.
+ * @param state Value returned by TRACE_HAL_Lock
+ */
+static inline void TRACE_HAL_Unlock(uint32_t state) {
+
+  POSIX_HAL_IrqUnlock();
+}
+
+/**
+ * @}
+ */
+
+#endif /* TRACE_HAL_H_ */
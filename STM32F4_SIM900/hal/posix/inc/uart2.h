@@ -0,0 +1,53 @@
+/**
+ * @file:   uart2.h
+ * @brief:  USART2 - POSIX port (pseudo-terminal)
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+#include <inttypes.h>
+
+/**
+ * @defgroup  USART2 USART2
+ * @brief     USART2 low level functions
+ */
+
+/**
+ * @addtogroup USART2
+ * @{
+ */
+
+void    UART2_Init(uint32_t baud, void(*rxCb)(uint8_t), uint8_t(*txCb)(uint8_t*));
+void    UART2_TxEnable(void);
+void    UART2_TxDmaInit(uint16_t(*peekCb)(uint8_t**), void(*doneCb)(uint16_t));
+void    UART2_TxLock(void);
+void    UART2_TxUnlock(void);
+uint16_t UART2_TxInFlight(void);
+
+// HAL functions for use in higher level
+#define COMM_HAL_Init       UART2_Init
+#define COMM_HAL_TxEnable   UART2_TxEnable
+#define COMM_HAL_TxDmaInit  UART2_TxDmaInit
+#define COMM_HAL_TxLock     UART2_TxLock
+#define COMM_HAL_TxUnlock   UART2_TxUnlock
+#define COMM_HAL_TxInFlight UART2_TxInFlight
+#define COMM_HAL_TX_DMA     1 ///< Transmission using DMA is available
+
+/**
+ * @}
+ */
+
+#endif /* UART_H_ */
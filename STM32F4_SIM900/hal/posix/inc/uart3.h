@@ -0,0 +1,56 @@
+/**
+ * @file:   uart3.h
+ * @brief:  USART3 - POSIX port (pseudo-terminal)
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#ifndef INC_UART3_H_
+#define INC_UART3_H_
+
+#include <inttypes.h>
+
+/**
+ * @defgroup  USART3 USART3
+ * @brief     USART3 low level functions
+ */
+
+/**
+ * @addtogroup USART3
+ * @{
+ */
+
+void    UART3_Init(uint32_t baud, void(*rxCb)(uint8_t), uint8_t(*txCb)(uint8_t*));
+void    UART3_TxEnable(void);
+void    UART3_TxDmaInit(uint16_t(*peekCb)(uint8_t**), void(*doneCb)(uint16_t));
+void    UART3_TxLock(void);
+void    UART3_TxUnlock(void);
+uint16_t UART3_TxInFlight(void);
+void    UART3_RxDmaInit(void(*rxBlockCb)(const uint8_t*, uint16_t));
+
+// HAL functions for use in higher level
+#define SIM900_HAL_Init       UART3_Init
+#define SIM900_HAL_TxEnable   UART3_TxEnable
+#define SIM900_HAL_TxDmaInit  UART3_TxDmaInit
+#define SIM900_HAL_TxLock     UART3_TxLock
+#define SIM900_HAL_TxUnlock   UART3_TxUnlock
+#define SIM900_HAL_TxInFlight UART3_TxInFlight
+#define SIM900_HAL_TX_DMA     1 ///< Transmission using DMA is available
+#define SIM900_HAL_RxDmaInit  UART3_RxDmaInit
+#define SIM900_HAL_RX_DMA     1 ///< Reception using circular DMA is available
+
+/**
+ * @}
+ */
+
+#endif /* INC_UART3_H_ */
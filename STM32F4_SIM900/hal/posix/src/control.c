@@ -0,0 +1,138 @@
+/**
+ * @file:   control.c
+ * @brief:  Control socket for LEDs and keys (POSIX port)
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details A Unix datagram socket (SIM_CONTROL environment variable,
+ * sim_control.sock by default) replaces the board. Commands, one
+ * per datagram:
+ * - KEY row col 1|0 - press/release a key of the matrix keyboard
+ * - LEDS - returns "LEDS s0 s1 s2 s3"
+ *
+ * The last client which sent a command (from a bound address) gets
+ * "LED n 1|0" on every LED change. Example:
+ * socat - UNIX-SENDTO:sim_control.sock,bind=/tmp/client.sock
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <posix_hal.h>
+#include <led_hal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * @addtogroup POSIX_HAL
+ * @{
+ */
+
+#define CONTROL_DEFAULT_PATH "sim_control.sock" ///< Socket path if SIM_CONTROL isn't set
+#define CONTROL_MSG_LEN 64 ///< Maximum command length
+
+static int controlFd = -1;              ///< Control socket
+static struct sockaddr_un client;       ///< Last client
+static socklen_t clientLen;             ///< Length of client address (0 - no client)
+
+/**
+ * @brief Sends a message to the last client.
+ * @param fmt Format string (printf)
+ */
+void POSIX_HAL_Control(const char* fmt, ...) {
+
+  char msg[CONTROL_MSG_LEN];
+  va_list args;
+
+  va_start(args, fmt);
+  int len = vsnprintf(msg, sizeof(msg), fmt, args);
+  va_end(args);
+
+  POSIX_HAL_IrqLock();
+
+  if (clientLen && len > 0) { // nobody listening - message is lost
+    sendto(controlFd, msg, len, MSG_DONTWAIT, (struct sockaddr*)&client, clientLen);
+  }
+
+  POSIX_HAL_IrqUnlock();
+}
+/**
+ * @brief Handles a command from the control socket.
+ */
+static void POSIX_HAL_ControlHandler(int fd, short revents) {
+
+  char msg[CONTROL_MSG_LEN];
+  struct sockaddr_un from;
+  socklen_t fromLen = sizeof(from);
+  unsigned row, col, pressed;
+
+  ssize_t len = recvfrom(fd, msg, sizeof(msg) - 1, MSG_DONTWAIT,
+      (struct sockaddr*)&from, &fromLen);
+
+  if (len <= 0) {
+    return;
+  }
+
+  msg[len] = 0;
+
+  if (fromLen > sizeof(sa_family_t)) { // client has an address - can get replies
+    client    = from;
+    clientLen = fromLen;
+  }
+
+  if (sscanf(msg, "KEY %u %u %u", &row, &col, &pressed) == 3) {
+    KEYS_HAL_SetKey(row, col, pressed);
+  } else if (strncmp(msg, "LEDS", 4) == 0) {
+    POSIX_HAL_Control("LEDS %d %d %d %d\n", LED_HAL_GetState(0),
+        LED_HAL_GetState(1), LED_HAL_GetState(2), LED_HAL_GetState(3));
+  } else {
+    POSIX_HAL_Control("ERROR %s", msg);
+  }
+}
+/**
+ * @brief Opens the control socket (once).
+ */
+void POSIX_HAL_ControlInit(void) {
+
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  const char* path = getenv("SIM_CONTROL");
+
+  if (controlFd >= 0) {
+    return;
+  }
+
+  if (!path) {
+    path = CONTROL_DEFAULT_PATH;
+  }
+
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  unlink(path);
+
+  controlFd = socket(AF_UNIX, SOCK_DGRAM, 0);
+
+  if (controlFd < 0 || bind(controlFd, (struct sockaddr*)&addr, sizeof(addr))) {
+    perror(path);
+    exit(1);
+  }
+
+  fprintf(stderr, "Control: %s\n", path);
+
+  POSIX_HAL_AddSource(controlFd, POLLIN, POSIX_HAL_ControlHandler);
+}
+
+/**
+ * @}
+ */
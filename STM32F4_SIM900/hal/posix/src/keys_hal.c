@@ -0,0 +1,110 @@
+/**
+ * @file:   keys_hal.c
+ * @brief:  Matrix keyboard HAL - POSIX port
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details Keys are pressed and released through the control socket.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <keys_hal.h>
+#include <posix_hal.h>
+#include <stddef.h>
+
+#define KEYS_ROWS 4 ///< Number of rows of the keyboard
+#define KEYS_COLS 4 ///< Number of columns of the keyboard
+
+static volatile uint8_t keys[KEYS_ROWS]; ///< Pressed keys (bit per column)
+static uint8_t column;                   ///< Selected column
+static uint8_t allColumns;               ///< All columns selected
+static void (*wakeupCallback)(void);     ///< Called on next key press (NULL - none)
+
+/**
+ * @brief Initialize 4x4 matrix keyboard
+ */
+void KEYS_HAL_Init(void) {
+
+  POSIX_HAL_ControlInit();
+}
+/**
+ * @brief Select a column
+ * @param col Column number
+ */
+void KEYS_HAL_SelectColumn(uint8_t col) {
+
+  column     = col;
+  allColumns = 0;
+}
+/**
+ * @brief Select all columns (any pressed key pulls its row low).
+ */
+void KEYS_HAL_SelectAll(void) {
+
+  allColumns = 1;
+}
+/**
+ * @brief Wakes up the core on the next key press (like the row
+ * interrupts on the board).
+ * @param callback Function called once on key press
+ */
+void KEYS_HAL_EnableWakeup(void (*callback)(void)) {
+
+  POSIX_HAL_IrqLock();
+
+  KEYS_HAL_SelectAll();
+
+  if (KEYS_HAL_ReadRow() != -1) {
+    callback(); // a key held down now
+  } else {
+    wakeupCallback = callback;
+  }
+
+  POSIX_HAL_IrqUnlock();
+}
+/**
+ * @brief Read keyboard row.
+ * @return Row value
+ */
+int8_t KEYS_HAL_ReadRow(void) {
+
+  for (uint8_t row = 0; row < KEYS_ROWS; row++) {
+    if (allColumns ? keys[row] : (column < KEYS_COLS && (keys[row] & (1 << column)))) {
+      return row;
+    }
+  }
+
+  return -1;
+}
+/**
+ * @brief Presses or releases a key (control socket).
+ * @param row Row of the key
+ * @param col Column of the key
+ * @param pressed 1 - pressed, 0 - released
+ */
+void KEYS_HAL_SetKey(uint8_t row, uint8_t col, uint8_t pressed) {
+
+  if (row >= KEYS_ROWS || col >= KEYS_COLS) {
+    return;
+  }
+
+  if (pressed) {
+    keys[row] |= 1 << col;
+    if (wakeupCallback) {
+      void (*callback)(void) = wakeupCallback;
+      wakeupCallback = NULL; // once - scanning takes over
+      callback();
+    }
+  } else {
+    keys[row] &= ~(1 << col);
+  }
+}
@@ -0,0 +1,60 @@
+/**
+ * @file:   led_hal.c
+ * @brief:  LED HAL - POSIX port
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details LED changes are sent to the control socket client.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <led_hal.h>
+#include <posix_hal.h>
+
+static uint8_t ledState[MAX_LEDS]; ///< Emulated pin states
+
+/**
+ * @brief Initialize an LED.
+ * @param led LED number.
+ */
+void LED_HAL_Init(uint8_t led) {
+
+  POSIX_HAL_ControlInit();
+  LED_HAL_ChangeState(led, 0); // turn LED off
+}
+/**
+ * @brief Toggle an LED.
+ * @param led LED number.
+ */
+void LED_HAL_Toggle(uint8_t led) {
+
+  LED_HAL_ChangeState(led, !ledState[led]);
+}
+/**
+ * @brief Change the state of an LED.
+ * @param led LED number.
+ * @param state New state.
+ */
+void LED_HAL_ChangeState(uint8_t led, uint8_t state) {
+
+  ledState[led] = (state == 1);
+  POSIX_HAL_Control("LED %d %d\n", (int)led, (int)ledState[led]);
+}
+/**
+ * @brief Returns state of an LED.
+ * @param led LED number.
+ * @return 1 - LED on, 0 - LED off
+ */
+uint8_t LED_HAL_GetState(uint8_t led) {
+
+  return led < MAX_LEDS ? ledState[led] : 0;
+}
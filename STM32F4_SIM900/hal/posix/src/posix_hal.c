@@ -0,0 +1,307 @@
+/**
+ * @file:   posix_hal.c
+ * @brief:  Core of the POSIX (Linux host) HAL port
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#define _GNU_SOURCE
+
+#include <posix_hal.h>
+#include <pthread.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/eventfd.h>
+
+/**
+ * @addtogroup POSIX_HAL
+ * @{
+ */
+
+/**
+ * @brief Interrupt source.
+ */
+typedef struct {
+  int   fd;     ///< Watched file descriptor
+  short events; ///< Poll events (0 - source disabled)
+  void (*handler)(int fd, short revents); ///< "Interrupt handler"
+} POSIX_HAL_Source_TypeDef;
+
+static pthread_mutex_t irqLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP; ///< Taken by handlers and critical sections
+static pthread_cond_t  irqCond = PTHREAD_COND_INITIALIZER; ///< Signalled after handlers run (wakes up POSIX_HAL_Wait)
+static pthread_once_t  irqOnce = PTHREAD_ONCE_INIT;
+static POSIX_HAL_Source_TypeDef sources[POSIX_HAL_MAX_SOURCES]; ///< Interrupt sources
+static int sourceCount;  ///< Number of sources
+static int kickFd = -1;  ///< Wakes up the interrupt thread after sources change
+static uint8_t (*idleHook)(void); ///< Called before waiting (replay.c)
+
+extern int _write(int fileHandle, char *buf, int len); // stubs.c
+
+/**
+ * @brief Enters a critical section ("disables interrupts").
+ * @details Can be nested.
+ */
+void POSIX_HAL_IrqLock(void) {
+
+  pthread_mutex_lock(&irqLock);
+}
+/**
+ * @brief Leaves a critical section.
+ */
+void POSIX_HAL_IrqUnlock(void) {
+
+  pthread_mutex_unlock(&irqLock);
+}
+/**
+ * @brief Handles wake up requests.
+ */
+static void POSIX_HAL_KickHandler(int fd, short revents) {
+
+  uint64_t count;
+
+  if (read(fd, &count, sizeof(count)) < 0) {
+    return; // nothing to clear
+  }
+}
+/**
+ * @brief Emulates the interrupt controller.
+ * @details Waits for events on all sources and runs their
+ * handlers with the interrupt lock taken.
+ */
+static void* POSIX_HAL_Thread(void* arg) {
+
+  struct pollfd fds[POSIX_HAL_MAX_SOURCES];
+  POSIX_HAL_Source_TypeDef active[POSIX_HAL_MAX_SOURCES];
+  int n;
+
+  while (1) {
+
+    POSIX_HAL_IrqLock();
+    n = sourceCount;
+    memcpy(active, sources, sizeof(active));
+    POSIX_HAL_IrqUnlock();
+
+    for (int i = 0; i < n; i++) {
+      fds[i].fd      = active[i].fd;
+      fds[i].events  = active[i].events;
+      fds[i].revents = 0;
+    }
+
+    if (poll(fds, n, -1) <= 0) {
+      continue; // interrupted by a signal
+    }
+
+    POSIX_HAL_IrqLock();
+
+    for (int i = 0; i < n; i++) {
+      if (fds[i].revents) {
+        active[i].handler(fds[i].fd, fds[i].revents);
+      }
+    }
+
+    pthread_cond_broadcast(&irqCond); // "WFI" returns after an interrupt
+    POSIX_HAL_IrqUnlock();
+  }
+
+  return 0;
+}
+/**
+ * @brief Starts the interrupt thread.
+ */
+static void POSIX_HAL_Start(void) {
+
+  pthread_t thread;
+
+  kickFd = eventfd(0, EFD_NONBLOCK);
+  sources[0].fd      = kickFd;
+  sources[0].events  = POLLIN;
+  sources[0].handler = POSIX_HAL_KickHandler;
+  sourceCount = 1;
+
+  if (kickFd < 0 || pthread_create(&thread, 0, POSIX_HAL_Thread, 0)) {
+    perror("POSIX HAL");
+    exit(1);
+  }
+}
+/**
+ * @brief Wakes up the interrupt thread, so it sees changed sources.
+ */
+static void POSIX_HAL_Kick(void) {
+
+  uint64_t one = 1;
+
+  if (write(kickFd, &one, sizeof(one)) < 0) {
+    return; // counter full - thread wakes up anyway
+  }
+}
+/**
+ * @brief Adds an interrupt source.
+ * @param fd File descriptor
+ * @param events Poll events which trigger the handler
+ * @param handler Handler (runs with interrupt lock taken)
+ */
+void POSIX_HAL_AddSource(int fd, short events, void (*handler)(int fd, short revents)) {
+
+  pthread_once(&irqOnce, POSIX_HAL_Start);
+
+  POSIX_HAL_IrqLock();
+
+  if (sourceCount == POSIX_HAL_MAX_SOURCES) {
+    fprintf(stderr, "POSIX HAL: too many interrupt sources\n");
+    exit(1);
+  }
+
+  sources[sourceCount].fd      = fd;
+  sources[sourceCount].events  = events;
+  sources[sourceCount].handler = handler;
+  sourceCount++;
+
+  POSIX_HAL_IrqUnlock();
+  POSIX_HAL_Kick();
+}
+/**
+ * @brief Changes events of an interrupt source (e.g. enables POLLOUT
+ * while there is data to send).
+ * @param fd File descriptor of the source
+ * @param events New events
+ */
+void POSIX_HAL_SetEvents(int fd, short events) {
+
+  POSIX_HAL_IrqLock();
+
+  for (int i = 0; i < sourceCount; i++) {
+    if (sources[i].fd == fd && sources[i].events != events) {
+      sources[i].events = events;
+      POSIX_HAL_Kick();
+    }
+  }
+
+  POSIX_HAL_IrqUnlock();
+}
+/**
+ * @brief Sets function called with interrupt lock taken every time
+ * the application waits for an interrupt.
+ * @param hook Hook, returns nonzero if it gave the application
+ * work to do, so it doesn't wait (NULL - none)
+ */
+void POSIX_HAL_SetIdleHook(uint8_t (*hook)(void)) {
+
+  idleHook = hook;
+}
+/**
+ * @brief Waits for an interrupt (WFI).
+ * @details Has to be called with interrupt lock taken once,
+ * the lock is released while waiting.
+ */
+void POSIX_HAL_Wait(void) {
+
+  pthread_once(&irqOnce, POSIX_HAL_Start);
+
+  if (idleHook && idleHook()) {
+    return; // there is work again
+  }
+
+  pthread_cond_wait(&irqCond, &irqLock);
+}
+/**
+ * @brief Converts baud rate to termios speed.
+ */
+static speed_t POSIX_HAL_Speed(uint32_t baud) {
+
+  switch (baud) {
+  case 9600:   return B9600;
+  case 19200:  return B19200;
+  case 38400:  return B38400;
+  case 57600:  return B57600;
+  case 230400: return B230400;
+  case 460800: return B460800;
+  case 921600: return B921600;
+  default:     return B115200;
+  }
+}
+/**
+ * @brief Opens a pseudo-terminal emulating a serial port.
+ *
+ * @details The slave side is kept open (in raw mode), so the port
+ * works whether a terminal is connected or not. Its name is printed
+ * on stderr and, if the environment variable linkVar is set, a symlink
+ * with that name is created (e.g. SIM_UART2=/tmp/comm).
+ *
+ * @param name Port name for messages
+ * @param linkVar Environment variable with symlink name
+ * @param baud Baud rate (only set in the terminal settings)
+ * @return Master file descriptor (nonblocking)
+ */
+int POSIX_HAL_OpenPty(const char* name, const char* linkVar, uint32_t baud) {
+
+  struct termios tio;
+  int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+  if (fd < 0 || grantpt(fd) || unlockpt(fd)) {
+    perror(name);
+    exit(1);
+  }
+
+  const char* slave = ptsname(fd);
+  int slaveFd = open(slave, O_RDWR | O_NOCTTY);
+
+  if (slaveFd >= 0 && tcgetattr(slaveFd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, POSIX_HAL_Speed(baud));
+    tcsetattr(slaveFd, TCSANOW, &tio);
+  }
+
+  const char* link = getenv(linkVar);
+
+  if (link) {
+    unlink(link);
+    if (symlink(slave, link)) {
+      perror(link);
+    }
+  }
+
+  fprintf(stderr, "%s: %s%s%s\n", name, slave, link ? " -> " : "", link ? link : "");
+
+  return fd;
+}
+/**
+ * @brief Writes stdout through the newlib hook, like on the target.
+ */
+static ssize_t POSIX_HAL_StdoutWrite(void* cookie, const char* buf, size_t len) {
+
+  return _write(1, (char*)buf, len);
+}
+/**
+ * @brief Redirects stdout (printf) to the _write stub, so it goes
+ * to the COMM port. Diagnostics of the port use stderr.
+ */
+__attribute__((constructor))
+static void POSIX_HAL_RedirectStdout(void) {
+
+  cookie_io_functions_t io = {.write = POSIX_HAL_StdoutWrite};
+  FILE* f = fopencookie(0, "w", io);
+
+  if (f) {
+    setvbuf(f, 0, _IOLBF, 0);
+    stdout = f;
+  }
+}
+
+/**
+ * @}
+ */
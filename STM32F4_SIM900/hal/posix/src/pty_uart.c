@@ -0,0 +1,192 @@
+/**
+ * @file:   pty_uart.c
+ * @brief:  Serial port emulated with a pseudo-terminal (POSIX port)
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details The data is passed at the speed of the pseudo-terminal,
+ * the baud rate is only set in the terminal settings.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <pty_uart.h>
+#include <posix_hal.h>
+#include <trace_hal.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+/**
+ * @addtogroup POSIX_HAL
+ * @{
+ */
+
+static PTY_UART_TypeDef* ports[TRACE_HAL_CHANNELS]; ///< Initialized ports by RX channel
+
+/**
+ * @brief Opens the port.
+ * @param uart Port
+ * @param baud Baud rate
+ * @param handler Interrupt handler of the port (calls PTY_UART_Handler)
+ */
+void PTY_UART_Init(PTY_UART_TypeDef* uart, uint32_t baud,
+    void (*handler)(int fd, short revents)) {
+
+  uart->fd = POSIX_HAL_OpenPty(uart->name, uart->linkVar, baud);
+  ports[uart->channel] = uart;
+  POSIX_HAL_AddSource(uart->fd, POLLIN, handler);
+}
+/**
+ * @brief Finds an initialized port.
+ * @param channel Trace channel of received data (TRACE_HAL_UARTx_RX)
+ * @return Port (NULL - not initialized)
+ */
+PTY_UART_TypeDef* PTY_UART_Find(uint8_t channel) {
+
+  return channel < TRACE_HAL_CHANNELS ? ports[channel] : 0;
+}
+/**
+ * @brief Writes data to the pseudo-terminal.
+ * @param uart Port
+ * @param data Data
+ * @param len Data length
+ * @return Number of bytes written, 0 if the terminal is full
+ */
+static uint16_t PTY_UART_WriteData(PTY_UART_TypeDef* uart,
+    const uint8_t* data, uint16_t len) {
+
+  ssize_t n;
+
+  if (uart->discard) {
+    uart->discarded += len;
+    n = len;
+  } else {
+    n = write(uart->fd, data, len);
+  }
+
+  if (n >= 0) {
+    TRACE_HAL_Record(uart->channel + 1, data, n);
+    return n;
+  }
+
+  if (errno == EAGAIN || errno == EINTR) {
+    return 0;
+  }
+
+  return len; // port broken - data is lost like on a disconnected line
+}
+/**
+ * @brief Sends as much data as the pseudo-terminal accepts.
+ * @details Called with interrupt lock taken. If data is left,
+ * the handler is called again when the terminal has space.
+ * @param uart Port
+ */
+static void PTY_UART_Send(PTY_UART_TypeDef* uart) {
+
+  uint8_t* data;
+  uint16_t len;
+  uint16_t n;
+
+  while (1) {
+
+    if (uart->txPeekCallback) { // "DMA" - write data in place
+
+      if ((len = uart->txPeekCallback(&data)) == 0) {
+        break;
+      }
+      if ((n = PTY_UART_WriteData(uart, data, len)) == 0) {
+        POSIX_HAL_SetEvents(uart->fd, POLLIN | POLLOUT);
+        return;
+      }
+      uart->txDoneCallback(n);
+
+    } else { // byte by byte, through txBuf
+
+      while (uart->txLen < PTY_UART_BUF_LEN &&
+          uart->txCallback(&uart->txBuf[uart->txLen])) {
+        uart->txLen++;
+      }
+      if (uart->txLen == 0) {
+        break;
+      }
+      if ((n = PTY_UART_WriteData(uart, uart->txBuf, uart->txLen)) == 0) {
+        POSIX_HAL_SetEvents(uart->fd, POLLIN | POLLOUT);
+        return;
+      }
+      uart->txLen -= n;
+      for (uint16_t i = 0; i < uart->txLen; i++) {
+        uart->txBuf[i] = uart->txBuf[i + n];
+      }
+    }
+  }
+
+  POSIX_HAL_SetEvents(uart->fd, POLLIN); // nothing more to send
+}
+/**
+ * @brief Enable transmitter.
+ * @param uart Port
+ */
+void PTY_UART_TxEnable(PTY_UART_TypeDef* uart) {
+
+  if (uart->fd < 0) {
+    return; // output before initialization is lost
+  }
+
+  POSIX_HAL_IrqLock();
+  PTY_UART_Send(uart);
+  POSIX_HAL_IrqUnlock();
+}
+/**
+ * @brief Passes received data to the higher layer.
+ * @details Called with interrupt lock taken - by the handler or
+ * by the replay of a trace (replay.c).
+ * @param uart Port
+ * @param data Data
+ * @param len Data length
+ */
+void PTY_UART_Receive(PTY_UART_TypeDef* uart, const uint8_t* data, uint16_t len) {
+
+  TRACE_HAL_Record(uart->channel, data, len);
+
+  if (uart->rxBlockCallback) {
+    uart->rxBlockCallback(data, len);
+  } else if (uart->rxCallback) {
+    for (uint16_t i = 0; i < len; i++) {
+      uart->rxCallback(data[i]);
+    }
+  }
+}
+/**
+ * @brief Interrupt handler of the port.
+ * @param uart Port
+ * @param revents Poll events
+ */
+void PTY_UART_Handler(PTY_UART_TypeDef* uart, short revents) {
+
+  uint8_t buf[PTY_UART_BUF_LEN];
+  ssize_t n;
+
+  if (revents & POLLIN) {
+
+    while ((n = read(uart->fd, buf, sizeof(buf))) > 0) {
+      PTY_UART_Receive(uart, buf, n);
+    }
+  }
+
+  if (revents & POLLOUT) {
+    PTY_UART_Send(uart);
+  }
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,310 @@
+/**
+ * @file:   replay.c
+ * @brief:  Replay of captured UART traffic (POSIX port)
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details Feeds a trace captured on the board (see trace.h) to the
+ * application instead of the pseudo-terminals. Received data goes
+ * through the same path as data read from a terminal, so COMM and
+ * SIM900 see exactly the captured blocks. Transmitted data is
+ * dropped, only the number of bytes is compared with the transmit
+ * records of the trace.
+ * Environment variables:
+ * - SIM_REPLAY - trace file (payloads of COMM_PACKET_TRACE packets,
+ *   see tools/log_decode.py --trace)
+ * - SIM_REPLAY_SPEED - 1 (default) keeps the captured timing, 2 plays
+ *   twice as fast etc., 0 feeds the next block as soon as the
+ *   application is idle (as fast as possible)
+ * - SIM_REPLAY_EXIT - 1 (default) ends the program after the trace,
+ *   0 keeps it running
+ *
+ * Statistics are printed on stderr at the end of the trace.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <posix_hal.h>
+#include <pty_uart.h>
+#include <trace_hal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+/**
+ * @addtogroup POSIX_HAL
+ * @{
+ */
+
+/**
+ * @brief Record of the trace.
+ */
+typedef struct {
+  uint8_t  channel;     ///< Channel
+  uint8_t  len;         ///< Data length
+  const uint8_t* data;  ///< Data
+  uint64_t time;        ///< Time since start of the trace in us
+  size_t   next;        ///< Position of the next record
+} POSIX_HAL_Record_TypeDef;
+
+static uint8_t* trace;      ///< Trace
+static size_t   traceLen;   ///< Trace length
+static size_t   pos;        ///< Position of the next record
+static uint64_t traceTime;  ///< Time of the last replayed record in us
+static double   speed;      ///< Speed (0 - as fast as possible)
+static uint8_t  exitAtEnd;  ///< Nonzero - end the program after the trace
+static uint8_t  started;    ///< Replay started
+static uint8_t  done;       ///< Whole trace replayed
+static int      timerFd = -1; ///< Timer of the next record (speed > 0)
+static uint64_t startTime;  ///< Start of the replay in ns
+static unsigned long records;  ///< Replayed records
+static unsigned long rxBytes;  ///< Bytes fed to the application
+static unsigned long txBytes;  ///< Bytes transmitted in the trace
+
+/**
+ * @brief Returns the monotonic time in ns.
+ */
+static uint64_t POSIX_HAL_Now(void) {
+
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+/**
+ * @brief Parses the next record.
+ * @param rec Returns the record
+ * @retval 0 Record parsed
+ * @retval 1 End of the trace (or a truncated record)
+ */
+static uint8_t POSIX_HAL_ReplayParse(POSIX_HAL_Record_TypeDef* rec) {
+
+  size_t i = pos;
+  uint64_t delta = 0;
+  uint8_t shift = 0;
+
+  if (i >= traceLen) {
+    return 1;
+  }
+
+  rec->channel = trace[i] >> 6;
+  rec->len     = (trace[i] & 0x3f) + 1;
+  i++;
+
+  do { // LEB128 time
+    if (i >= traceLen || shift > 63) {
+      return 1;
+    }
+    delta |= (uint64_t)(trace[i] & 0x7f) << shift;
+    shift += 7;
+  } while (trace[i++] & 0x80);
+
+  if (i + rec->len > traceLen) {
+    return 1;
+  }
+
+  rec->data = &trace[i];
+  rec->time = traceTime + delta;
+  rec->next = i + rec->len;
+
+  return 0;
+}
+/**
+ * @brief Replays a record (with interrupt lock taken).
+ * @param rec Record
+ */
+static void POSIX_HAL_ReplayRecord(POSIX_HAL_Record_TypeDef* rec) {
+
+  PTY_UART_TypeDef* uart = PTY_UART_Find(rec->channel);
+
+  if (rec->channel & 1) {
+    txBytes += rec->len; // sent by the board - the application sends it itself
+  } else if (uart) {
+    PTY_UART_Receive(uart, rec->data, rec->len);
+    rxBytes += rec->len;
+  }
+
+  records++;
+  pos       = rec->next;
+  traceTime = rec->time;
+}
+/**
+ * @brief Prints the statistics and ends the program (or the replay).
+ */
+static void POSIX_HAL_ReplayEnd(void) {
+
+  double elapsed = (POSIX_HAL_Now() - startTime) / 1e9;
+  unsigned long sent = 0;
+
+  for (uint8_t ch = 0; ch < TRACE_HAL_CHANNELS; ch++) {
+    if (PTY_UART_Find(ch)) {
+      sent += PTY_UART_Find(ch)->discarded;
+    }
+  }
+
+  if (pos < traceLen) {
+    fprintf(stderr, "Replay: truncated record at offset %zu\n", pos);
+  }
+
+  fprintf(stderr, "Replay: %lu records, %lu bytes received, %lu bytes "
+      "transmitted (trace %lu), trace %.3f s, replay %.3f s, %.0f bytes/s\n",
+      records, rxBytes, sent, txBytes, traceTime / 1e6, elapsed,
+      elapsed > 0 ? rxBytes / elapsed : 0.0);
+
+  POSIX_HAL_SetIdleHook(0);
+
+  if (exitAtEnd) {
+    exit(0);
+  }
+}
+/**
+ * @brief Replays the records which are due and sets the timer
+ * for the next one (interrupt handler, speed > 0).
+ */
+static void POSIX_HAL_ReplayTimer(int fd, short revents) {
+
+  POSIX_HAL_Record_TypeDef rec;
+  struct itimerspec next = {{0, 0}, {0, 0}};
+  uint64_t expirations;
+  uint64_t due;
+
+  if (read(fd, &expirations, sizeof(expirations)) < 0 || done) {
+    return;
+  }
+
+  while (POSIX_HAL_ReplayParse(&rec) == 0) {
+
+    due = startTime + (uint64_t)(rec.time * 1000 / speed);
+
+    if (due > POSIX_HAL_Now()) {
+      next.it_value.tv_sec  = due / 1000000000;
+      next.it_value.tv_nsec = due % 1000000000;
+      timerfd_settime(fd, TFD_TIMER_ABSTIME, &next, 0);
+      return;
+    }
+
+    POSIX_HAL_ReplayRecord(&rec);
+  }
+
+  done = 1; // ends in the next idle hook - after the application handled the data
+}
+/**
+ * @brief Loads the trace and starts the replay.
+ */
+static void POSIX_HAL_ReplayStart(void) {
+
+  const char* path = getenv("SIM_REPLAY");
+  FILE* f = fopen(path, "rb");
+  size_t n;
+
+  if (!f) {
+    perror(path);
+    exit(1);
+  }
+
+  while (1) {
+    trace = realloc(trace, traceLen + 4096);
+    if (!trace) {
+      perror("Replay");
+      exit(1);
+    }
+    if ((n = fread(trace + traceLen, 1, 4096, f)) == 0) {
+      break;
+    }
+    traceLen += n;
+  }
+
+  fclose(f);
+
+  for (uint8_t ch = 0; ch < TRACE_HAL_CHANNELS; ch++) {
+    if (PTY_UART_Find(ch)) {
+      PTY_UART_Find(ch)->discard = 1; // nobody reads the terminals
+    }
+  }
+
+  fprintf(stderr, "Replay: %s, %zu bytes, speed %g\n", path, traceLen, speed);
+
+  started   = 1;
+  startTime = POSIX_HAL_Now();
+
+  if (speed > 0) {
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    struct itimerspec now = {{0, 0}, {0, 1}}; // first records right away
+    if (timerFd < 0 || timerfd_settime(timerFd, 0, &now, 0)) {
+      perror("Replay");
+      exit(1);
+    }
+    POSIX_HAL_AddSource(timerFd, POLLIN, POSIX_HAL_ReplayTimer);
+  }
+}
+/**
+ * @brief Idle hook - starts the replay when the application first
+ * waits (it is initialized then), feeds the next record when running
+ * as fast as possible and ends the replay.
+ * @retval 1 Record fed - the application has work
+ * @retval 0 Nothing to do
+ */
+static uint8_t POSIX_HAL_ReplayIdle(void) {
+
+  POSIX_HAL_Record_TypeDef rec;
+
+  if (!started) {
+    POSIX_HAL_ReplayStart();
+  }
+
+  if (speed > 0) {
+    if (done) {
+      POSIX_HAL_ReplayEnd();
+    }
+    return 0;
+  }
+
+  while (POSIX_HAL_ReplayParse(&rec) == 0) {
+
+    POSIX_HAL_ReplayRecord(&rec);
+
+    if (!(rec.channel & 1)) {
+      return 1; // one received block at a time
+    }
+  }
+
+  POSIX_HAL_ReplayEnd();
+
+  return 0;
+}
+/**
+ * @brief Reads the settings and installs the idle hook
+ * if a trace is to be replayed.
+ */
+__attribute__((constructor))
+static void POSIX_HAL_ReplayInit(void) {
+
+  const char* value;
+
+  if (!getenv("SIM_REPLAY")) {
+    return;
+  }
+
+  value = getenv("SIM_REPLAY_SPEED");
+  speed = value ? strtod(value, 0) : 1.0;
+  value = getenv("SIM_REPLAY_EXIT");
+  exitAtEnd = value ? atoi(value) != 0 : 1;
+
+  POSIX_HAL_SetIdleHook(POSIX_HAL_ReplayIdle);
+}
+
+/**
+ * @}
+ */
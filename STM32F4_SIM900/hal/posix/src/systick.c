@@ -0,0 +1,122 @@
+/**
+ * @file:   systick.c
+ * @brief:  System tick - POSIX port (timerfd)
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <systick.h>
+#include <posix_hal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+
+/**
+ * @addtogroup SYSTICK
+ * @{
+ */
+
+static volatile uint32_t sysTicks;  ///< Delay timer.
+static void (*tickCallback)(void);  ///< Function called on every tick
+
+/**
+ * @brief Timer expired - runs the SysTick handler for every tick
+ * which passed (the thread could have been delayed).
+ */
+static void SYSTICK_TimerHandler(int fd, short revents) {
+
+  uint64_t ticks;
+
+  if (read(fd, &ticks, sizeof(ticks)) != sizeof(ticks)) {
+    return;
+  }
+
+  while (ticks--) {
+
+    sysTicks++; // Update system time
+
+    if (tickCallback) {
+      tickCallback();
+    }
+  }
+}
+/**
+ * @brief Initialize the SysTick with a given frequency
+ * @param freq SysTick frequency
+ */
+void SYSTICK_Init(uint32_t freq) {
+
+  struct itimerspec period;
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+
+  period.it_interval.tv_sec  = 0;
+  period.it_interval.tv_nsec = 1000000000UL / freq;
+  period.it_value = period.it_interval;
+
+  if (fd < 0 || timerfd_settime(fd, 0, &period, 0)) {
+    perror("SYSTICK");
+    exit(1);
+  }
+
+  POSIX_HAL_AddSource(fd, POLLIN, SYSTICK_TimerHandler);
+}
+/**
+ * @brief Get the system time
+ * @return System time.
+ */
+uint32_t SYSTICK_GetTime(void) {
+  return sysTicks;
+}
+/**
+ * @brief Sets function called from SysTick interrupt on every tick.
+ * @param callback Tick function (NULL - none)
+ */
+void SYSTICK_SetTickCallback(void (*callback)(void)) {
+
+  tickCallback = callback;
+}
+/**
+ * @brief Sleeps for a given number of ticks or until an interrupt.
+ * @details The timer keeps ticking on the host, so the sleep goes on
+ * through ticks and interrupts, which don't give the application
+ * work, until the requested ticks pass (like on the board, where
+ * SysTick is reprogrammed for the whole sleep). Each return is
+ * a wakeup the main loop acts on.
+ * @param ticks Number of ticks to sleep
+ * @param abort Function checked with interrupts disabled just before
+ * sleeping - if it returns nonzero, there is work to do and the core
+ * doesn't sleep (can be NULL - waits for one interrupt)
+ */
+void SYSTICK_Sleep(uint32_t ticks, uint8_t (*abort)(void)) {
+
+  uint32_t end = sysTicks + ticks;
+
+  POSIX_HAL_IrqLock();
+
+  while (!abort || !abort()) {
+
+    POSIX_HAL_Wait();
+
+    if (!abort || (int32_t)(sysTicks - end) >= 0) {
+      break;
+    }
+  }
+
+  POSIX_HAL_IrqUnlock();
+}
+
+/**
+ * @}
+ */
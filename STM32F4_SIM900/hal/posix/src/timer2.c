@@ -0,0 +1,50 @@
+/**
+ * @file:   timer2.c
+ * @brief:  Microsecond counter - POSIX port
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <timer2.h>
+#include <time.h>
+
+static uint64_t startTime; ///< Time of TIMER2_Init in us
+
+/**
+ * @brief Reads the monotonic clock.
+ * @return Time in microseconds
+ */
+static uint64_t TIMER2_Clock(void) {
+
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+/**
+ * @brief Initialize microsecond counter
+ * @details Counts from zero like the 32-bit TIM2 on the target.
+ */
+void TIMER2_Init(void) {
+
+  startTime = TIMER2_Clock();
+}
+/**
+ * @brief Get time value
+ * @return Time in microseconds
+ */
+uint32_t TIMER2_GetTime(void) {
+
+  return (uint32_t)(TIMER2_Clock() - startTime);
+}
@@ -0,0 +1,53 @@
+/**
+ * @file:   trace_hal.c
+ * @brief:  HAL for UART traffic capture - POSIX port
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <trace_hal.h>
+
+/**
+ * @addtogroup TRACE_HAL
+ * @{
+ */
+
+/// Capture function (NULL - capture disabled)
+static void (*traceCallback)(uint8_t channel, const uint8_t* data, uint16_t len);
+
+/**
+ * @brief Sets the capture function.
+ * @param callback Function called from the UART interrupts
+ * with every received and transmitted block (NULL - none)
+ */
+void TRACE_HAL_SetCallback(void (*callback)(uint8_t channel,
+    const uint8_t* data, uint16_t len)) {
+
+  traceCallback = callback;
+}
+/**
+ * @brief Passes UART data to the capture function.
+ * @param channel Channel (TRACE_HAL_UARTx_RX/TX)
+ * @param data Data
+ * @param len Data length
+ */
+void TRACE_HAL_Record(uint8_t channel, const uint8_t* data, uint16_t len) {
+
+  if (traceCallback) {
+    traceCallback(channel, data, len);
+  }
+}
+
+/**
+ * @}
+ */
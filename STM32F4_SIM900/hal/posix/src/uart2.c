@@ -0,0 +1,100 @@
+/**
+ * @file:   uart2.c
+ * @brief:  USART2 - POSIX port (pseudo-terminal)
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details The pseudo-terminal name is printed on stderr, a symlink
+ * to it can be created with the SIM_UART2 environment variable.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <uart2.h>
+#include <pty_uart.h>
+#include <posix_hal.h>
+#include <trace_hal.h>
+
+/**
+ * @addtogroup USART2
+ * @{
+ */
+
+static PTY_UART_TypeDef uart = {.name = "USART2", .linkVar = "SIM_UART2", .fd = -1,
+    .channel = TRACE_HAL_UART2_RX};
+
+/**
+ * @brief Interrupt handler of USART2
+ */
+static void UART2_Handler(int fd, short revents) {
+
+  PTY_UART_Handler(&uart, revents);
+}
+/**
+ * @brief Initialize USART2
+ * @param baud Baud rate
+ * @param rxCb Receive callback
+ * @param txCb Transmit callback
+ */
+void UART2_Init(uint32_t baud, void(*rxCb)(uint8_t), uint8_t(*txCb)(uint8_t*)) {
+
+  uart.rxCallback = rxCb;
+  uart.txCallback = txCb;
+
+  PTY_UART_Init(&uart, baud, UART2_Handler);
+}
+/**
+ * @brief Switch USART2 transmitter to DMA mode (block writes).
+ * @param peekCb Returns contiguous data to send
+ * @param doneCb Releases sent data
+ */
+void UART2_TxDmaInit(uint16_t(*peekCb)(uint8_t**), void(*doneCb)(uint16_t)) {
+
+  POSIX_HAL_IrqLock();
+  uart.txPeekCallback = peekCb;
+  uart.txDoneCallback = doneCb;
+  POSIX_HAL_IrqUnlock();
+}
+/**
+ * @brief Enable transmitter.
+ */
+void UART2_TxEnable(void) {
+
+  PTY_UART_TxEnable(&uart);
+}
+/**
+ * @brief Masks the transmitter interrupts.
+ */
+void UART2_TxLock(void) {
+
+  POSIX_HAL_IrqLock();
+}
+/**
+ * @brief Unmasks the transmitter interrupts.
+ */
+void UART2_TxUnlock(void) {
+
+  POSIX_HAL_IrqUnlock();
+}
+/**
+ * @brief Returns number of bytes being sent by DMA.
+ * @details Writes are done with the interrupt lock taken,
+ * so nothing is in flight for the lock holder.
+ * @return Number of bytes
+ */
+uint16_t UART2_TxInFlight(void) {
+
+  return 0;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,110 @@
+/**
+ * @file:   uart3.c
+ * @brief:  USART3 - POSIX port (pseudo-terminal)
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details The pseudo-terminal name is printed on stderr, a symlink
+ * to it can be created with the SIM_UART3 environment variable.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <uart3.h>
+#include <pty_uart.h>
+#include <posix_hal.h>
+#include <trace_hal.h>
+
+/**
+ * @addtogroup USART3
+ * @{
+ */
+
+static PTY_UART_TypeDef uart = {.name = "USART3", .linkVar = "SIM_UART3", .fd = -1,
+    .channel = TRACE_HAL_UART3_RX};
+
+/**
+ * @brief Interrupt handler of USART3
+ */
+static void UART3_Handler(int fd, short revents) {
+
+  PTY_UART_Handler(&uart, revents);
+}
+/**
+ * @brief Initialize USART3
+ * @param baud Baud rate
+ * @param rxCb Receive callback
+ * @param txCb Transmit callback
+ */
+void UART3_Init(uint32_t baud, void(*rxCb)(uint8_t), uint8_t(*txCb)(uint8_t*)) {
+
+  uart.rxCallback = rxCb;
+  uart.txCallback = txCb;
+
+  PTY_UART_Init(&uart, baud, UART3_Handler);
+}
+/**
+ * @brief Switch USART3 transmitter to DMA mode (block writes).
+ * @param peekCb Returns contiguous data to send
+ * @param doneCb Releases sent data
+ */
+void UART3_TxDmaInit(uint16_t(*peekCb)(uint8_t**), void(*doneCb)(uint16_t)) {
+
+  POSIX_HAL_IrqLock();
+  uart.txPeekCallback = peekCb;
+  uart.txDoneCallback = doneCb;
+  POSIX_HAL_IrqUnlock();
+}
+/**
+ * @brief Switch USART3 receiver to DMA mode (block reads).
+ * @param rxBlockCb Gets received blocks
+ */
+void UART3_RxDmaInit(void(*rxBlockCb)(const uint8_t*, uint16_t)) {
+
+  POSIX_HAL_IrqLock();
+  uart.rxBlockCallback = rxBlockCb;
+  POSIX_HAL_IrqUnlock();
+}
+/**
+ * @brief Enable transmitter.
+ */
+void UART3_TxEnable(void) {
+
+  PTY_UART_TxEnable(&uart);
+}
+/**
+ * @brief Masks the transmitter interrupts.
+ */
+void UART3_TxLock(void) {
+
+  POSIX_HAL_IrqLock();
+}
+/**
+ * @brief Unmasks the transmitter interrupts.
+ */
+void UART3_TxUnlock(void) {
+
+  POSIX_HAL_IrqUnlock();
+}
+/**
+ * @brief Returns number of bytes being sent by DMA.
+ * @details Writes are done with the interrupt lock taken,
+ * so nothing is in flight for the lock holder.
+ * @return Number of bytes
+ */
+uint16_t UART3_TxInFlight(void) {
+
+  return 0;
+}
+
+/**
+ * @}
+ */
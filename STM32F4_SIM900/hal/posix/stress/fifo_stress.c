@@ -0,0 +1,380 @@
+/**
+ * @file:   fifo_stress.c
+ * @brief:  Stress test of the lock-free FIFO
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @details A producer thread and a consumer thread (an interrupt
+ * handler and the main loop on the board) exchange a known sequence
+ * through a small FIFO, without any lock, so the ring is full and
+ * empty very often. Both sides switch at random between the single
+ * byte, block and zero-copy functions. The consumer checks every byte,
+ * at the end the statistics counters are checked too. A second pass
+ * sends 32-bit words through a FIFO_DEFINE FIFO, which would show torn
+ * elements.
+ *
+ * Usage:
+ *   stm32f4_sim900_stress [-n bytes] [-s size]
+ *
+ * - bytes - bytes (and words) sent through the FIFO (default 20000000)
+ * - size - FIFO length, power of two (default 64)
+ *
+ * The exit status is 1 if any data got lost, reordered or corrupted.
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <fifo.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @defgroup  STRESS STRESS
+ * @brief     Stress test of the lock-free FIFO.
+ */
+
+/**
+ * @addtogroup STRESS
+ * @{
+ */
+
+#define STRESS_MAX_LEN   0x8000 ///< Maximum FIFO length
+#define STRESS_BLOCK_LEN 48     ///< Maximum length of a block
+#define STRESS_WORDS_LEN 64     ///< Length of the FIFO of words
+
+FIFO_DEFINE(STRESS_Words, uint32_t, STRESS_WORDS_LEN)
+
+/**
+ * @brief State of a test.
+ */
+typedef struct {
+  uint64_t total;     ///< Bytes (words) to send
+  uint64_t sent;      ///< Sent by the producer
+  uint64_t received;  ///< Checked by the consumer
+  uint64_t full;      ///< Pushes which didn't fit (whole or part)
+  uint64_t dropped;   ///< Bytes which didn't fit
+  uint64_t empty;     ///< Pops from an empty FIFO
+  uint64_t errors;    ///< Wrong bytes (words)
+  uint64_t firstError; ///< Position of the first wrong byte (word)
+} STRESS_Test_TypeDef;
+
+static uint8_t buf[STRESS_MAX_LEN];  ///< Storage of the byte FIFO
+static FIFO_TypeDef fifo = {.buf = buf, .len = 64}; ///< Byte FIFO
+static STRESS_Words_TypeDef words = FIFO_INIT(words); ///< FIFO of words
+
+/**
+ * @brief Prints to the standard output file descriptor
+ * (stdout itself is redirected to COMM).
+ */
+static void STRESS_Print(const char* fmt, ...) {
+
+  va_list args;
+
+  va_start(args, fmt);
+  vdprintf(STDOUT_FILENO, fmt, args);
+  va_end(args);
+}
+/**
+ * @brief Returns the monotonic time in s.
+ */
+static double STRESS_Now(void) {
+
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+/**
+ * @brief Pseudo-random number generator (xorshift32).
+ * @param state Generator state (nonzero)
+ * @return Next number
+ */
+static uint32_t STRESS_Random(uint32_t* state) {
+
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  return *state = x;
+}
+/**
+ * @brief Byte of the sequence (the period isn't a power of two,
+ * so it doesn't line up with the ring).
+ * @param n Position in the sequence
+ */
+static inline uint8_t STRESS_Byte(uint64_t n) {
+  return n % 251;
+}
+/**
+ * @brief Checks a received byte.
+ * @param test Test
+ * @param c Received byte
+ */
+static inline void STRESS_Check(STRESS_Test_TypeDef* test, uint8_t c) {
+
+  if (c != STRESS_Byte(test->received)) {
+    if (!test->errors) {
+      test->firstError = test->received;
+    }
+    test->errors++;
+  }
+  test->received++;
+}
+/**
+ * @brief Producer of the byte test (interrupt handler on the board).
+ * @param arg Test
+ */
+static void* STRESS_BytesProducer(void* arg) {
+
+  STRESS_Test_TypeDef* test = arg;
+  uint8_t block[STRESS_BLOCK_LEN];
+  uint32_t random = 0x12345678;
+  uint16_t len, n;
+
+  while (test->sent < test->total) {
+
+    uint32_t r = STRESS_Random(&random);
+
+    if (r & 1) {
+      if (FIFO_Push(&fifo, STRESS_Byte(test->sent))) {
+        test->full++;
+        test->dropped++;
+        sched_yield(); // let the consumer run (on one core)
+        continue;
+      }
+      test->sent++;
+    } else {
+      len = (r >> 8) % STRESS_BLOCK_LEN + 1;
+      if (len > test->total - test->sent) {
+        len = test->total - test->sent;
+      }
+      for (uint16_t i = 0; i < len; i++) {
+        block[i] = STRESS_Byte(test->sent + i);
+      }
+      n = FIFO_PushBlock(&fifo, block, len);
+      if (n < len) { // the rest is sent again
+        test->full++;
+        test->dropped += len - n;
+        sched_yield();
+      }
+      test->sent += n;
+    }
+  }
+
+  return 0;
+}
+/**
+ * @brief Consumer of the byte test (main loop on the board).
+ * @param arg Test
+ */
+static void* STRESS_BytesConsumer(void* arg) {
+
+  STRESS_Test_TypeDef* test = arg;
+  uint8_t block[STRESS_BLOCK_LEN];
+  uint32_t random = 0x9abcdef0;
+  uint8_t* data;
+  uint8_t c;
+  uint16_t n;
+
+  while (test->received < test->total) {
+
+    uint32_t r = STRESS_Random(&random);
+
+    switch (r % 3) {
+    case 0:
+      if (FIFO_Pop(&fifo, &c)) {
+        test->empty++;
+        sched_yield(); // let the producer run (on one core)
+        break;
+      }
+      STRESS_Check(test, c);
+      break;
+    case 1:
+      n = FIFO_PopBlock(&fifo, block, (r >> 8) % STRESS_BLOCK_LEN + 1);
+      if (n == 0) {
+        test->empty++;
+        sched_yield();
+      }
+      for (uint16_t i = 0; i < n; i++) {
+        STRESS_Check(test, block[i]);
+      }
+      break;
+    default: // zero-copy, part of the region
+      n = FIFO_PeekContiguous(&fifo, &data);
+      if (n == 0) {
+        test->empty++;
+        sched_yield();
+        break;
+      }
+      n = (r >> 8) % n + 1;
+      for (uint16_t i = 0; i < n; i++) {
+        STRESS_Check(test, data[i]);
+      }
+      FIFO_Consume(&fifo, n);
+      break;
+    }
+  }
+
+  return 0;
+}
+/**
+ * @brief Producer of the word test.
+ * @param arg Test
+ */
+static void* STRESS_WordsProducer(void* arg) {
+
+  STRESS_Test_TypeDef* test = arg;
+
+  while (test->sent < test->total) {
+    // both halves carry the position - a torn word doesn't match
+    uint32_t w = (uint32_t)test->sent * 0x10001;
+    if (STRESS_Words_Push(&words, w)) {
+      test->full++;
+      test->dropped++;
+      sched_yield();
+      continue;
+    }
+    test->sent++;
+  }
+
+  return 0;
+}
+/**
+ * @brief Consumer of the word test.
+ * @param arg Test
+ */
+static void* STRESS_WordsConsumer(void* arg) {
+
+  STRESS_Test_TypeDef* test = arg;
+  uint32_t w;
+
+  while (test->received < test->total) {
+    if (STRESS_Words_Pop(&words, &w)) {
+      test->empty++;
+      sched_yield();
+      continue;
+    }
+    if (w != (uint32_t)test->received * 0x10001) {
+      if (!test->errors) {
+        test->firstError = test->received;
+      }
+      test->errors++;
+    }
+    test->received++;
+  }
+
+  return 0;
+}
+/**
+ * @brief Runs a test and prints the results.
+ * @param name Test name
+ * @param header FIFO header (for the statistics)
+ * @param producer Producer thread
+ * @param consumer Consumer thread
+ * @param total Bytes (words) to send
+ * @retval 0 Test passed
+ * @retval 1 Test failed
+ */
+static uint8_t STRESS_Run(const char* name, FIFO_TypeDef* header,
+    void* (*producer)(void*), void* (*consumer)(void*), uint64_t total) {
+
+  STRESS_Test_TypeDef test = {.total = total};
+  pthread_t threads[2];
+  uint8_t failed = 0;
+  double start = STRESS_Now();
+  double seconds;
+
+  if (pthread_create(&threads[0], 0, consumer, &test) ||
+      pthread_create(&threads[1], 0, producer, &test)) {
+    perror("stress");
+    exit(1);
+  }
+
+  pthread_join(threads[1], 0);
+  pthread_join(threads[0], 0);
+
+  seconds = STRESS_Now() - start;
+
+  STRESS_Print("%-6s len %5u: %llu in %.3f s (%.1f M/s), %llu full, "
+      "%llu empty\n", name, (unsigned)header->len,
+      (unsigned long long)test.received, seconds, test.received / seconds / 1e6,
+      (unsigned long long)test.full, (unsigned long long)test.empty);
+
+  if (test.errors) {
+    STRESS_Print("%-6s FAILED: %llu wrong, first at %llu\n", name,
+        (unsigned long long)test.errors, (unsigned long long)test.firstError);
+    failed = 1;
+  }
+
+#if FIFO_STATS
+  // counters are 32-bit, they wrap around like on the board
+  if (header->stats.pushed != (uint32_t)total ||
+      header->stats.popped != (uint32_t)total ||
+      header->stats.dropped != (uint32_t)test.dropped ||
+      header->stats.overflows != (uint32_t)test.full ||
+      header->stats.highWater > header->len) {
+    STRESS_Print("%-6s FAILED: wrong statistics\n", name);
+    failed = 1;
+  }
+#endif
+
+  if (!FIFO_IsEmpty(header)) {
+    STRESS_Print("%-6s FAILED: FIFO not empty at the end\n", name);
+    failed = 1;
+  }
+
+  return failed;
+}
+
+int main(int argc, char* argv[]) {
+
+  uint64_t total = 20000000;
+  uint8_t failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+    switch (opt) {
+    case 'n': total = strtoull(optarg, 0, 0); break;
+    case 's': fifo.len = atoi(optarg); break;
+    default:
+      fprintf(stderr, "Usage: %s [-n bytes] [-s size]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (fifo.len > STRESS_MAX_LEN || FIFO_Add(&fifo)) {
+    fprintf(stderr, "Size has to be a power of two up to %u\n", STRESS_MAX_LEN);
+    return 1;
+  }
+
+  STRESS_Words_Init(&words);
+
+  failed |= STRESS_Run("bytes", &fifo, STRESS_BytesProducer,
+      STRESS_BytesConsumer, total);
+  failed |= STRESS_Run("words", &words.fifo, STRESS_WordsProducer,
+      STRESS_WordsConsumer, total);
+
+  STRESS_Print(failed ? "FAILED\n" : "OK\n");
+
+  return failed;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,83 @@
+/**
+ * @file:   crc_hal.c
+ * @brief:  HAL for the CRC calculation unit
+ * @date:   17 paź 2026
+ * @author: Michal Ksiezopolski
+ *
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the
+ * accompanying materials are made available
+ * under the terms of the GNU Public License
+ * v3.0 which accompanies this distribution,
+ * and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <crc_hal.h>
+#include <stm32f4xx.h>
+
+/**
+ * @addtogroup CRC_HAL
+ * @{
+ */
+
+#define CRC_HAL_POLY 0x04c11db7 ///< Polynomial of the CRC unit
+
+/**
+ * @brief Initializes the CRC unit.
+ */
+void CRC_HAL_Init(void) {
+
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_CRC, ENABLE);
+}
+/**
+ * @brief Reverses the processing of one word by the CRC unit.
+ * @param crc CRC after the word
+ * @return CRC XORed with the word before processing it
+ */
+static uint32_t CRC_HAL_Unstep(uint32_t crc) {
+
+  for (uint8_t i = 0; i < 32; i++) {
+    if (crc & 1) { // polynomial was XORed (it is odd, shifted value is even)
+      crc = ((crc ^ CRC_HAL_POLY) >> 1) | 0x80000000;
+    } else {
+      crc >>= 1;
+    }
+  }
+
+  return crc;
+}
+/**
+ * @brief Continues CRC calculation using the CRC unit.
+ *
+ * @details The data register can't be written directly, so after reset
+ * a word is written, which takes the unit from the initial value
+ * to the given CRC. Then the calculation can continue where it
+ * stopped, even if the unit was used for other data meanwhile.
+ * The CRC unit isn't reentrant - don't use it from interrupts.
+ *
+ * @param crc CRC of previous data (0xffffffff - start)
+ * @param words Data (bytes of each word are processed from the lowest address)
+ * @param count Number of words
+ * @return CRC
+ */
+uint32_t CRC_HAL_Update(uint32_t crc, const uint32_t* words, uint32_t count) {
+
+  CRC_ResetDR();
+
+  if (crc != 0xffffffff) {
+    CRC->DR = CRC_HAL_Unstep(crc) ^ 0xffffffff;
+  }
+
+  while (count--) {
+    CRC->DR = __REV(*words++); // unit takes the most significant byte first
+  }
+
+  return CRC->DR;
+}
+
+/**
+ * @}
+ */
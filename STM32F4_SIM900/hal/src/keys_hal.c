@@ -38,6 +38,15 @@
 #define KEYS_COL_PORT   GPIOE
 #define KEYS_COL_CLOCK  RCC_AHB1Periph_GPIOE
 
+/*
+ * External interrupts of the rows (wake up on key press).
+ */
+#define KEYS_ROW_EXTI_PORT  EXTI_PortSourceGPIOE
+#define KEYS_ROW_EXTI_LINES (EXTI_Line11 | EXTI_Line12 | EXTI_Line13 | EXTI_Line14)
+#define KEYS_ROW_IRQn       EXTI15_10_IRQn
+
+static void (*wakeupCallback)(void); ///< Called on key press after KEYS_HAL_EnableWakeup
+
 /**
  * @brief Initialize 4x4 matrix keyboard
  */
@@ -69,6 +78,57 @@ void KEYS_HAL_Init(void) {
 
   GPIO_Init(KEYS_COL_PORT, &GPIO_InitStructure);
 
+  // Connect rows to EXTI lines, falling edge (key press), masked for now
+  RCC_APB2PeriphClockCmd(RCC_APB2Periph_SYSCFG, ENABLE);
+
+  SYSCFG_EXTILineConfig(KEYS_ROW_EXTI_PORT, EXTI_PinSource11);
+  SYSCFG_EXTILineConfig(KEYS_ROW_EXTI_PORT, EXTI_PinSource12);
+  SYSCFG_EXTILineConfig(KEYS_ROW_EXTI_PORT, EXTI_PinSource13);
+  SYSCFG_EXTILineConfig(KEYS_ROW_EXTI_PORT, EXTI_PinSource14);
+
+  EXTI_InitTypeDef EXTI_InitStructure;
+
+  EXTI_InitStructure.EXTI_Line    = KEYS_ROW_EXTI_LINES;
+  EXTI_InitStructure.EXTI_Mode    = EXTI_Mode_Interrupt;
+  EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Falling;
+  EXTI_InitStructure.EXTI_LineCmd = DISABLE;
+
+  EXTI_Init(&EXTI_InitStructure);
+
+  NVIC_EnableIRQ(KEYS_ROW_IRQn);
+
+}
+/**
+ * @brief Select all columns (any pressed key pulls its row low).
+ */
+void KEYS_HAL_SelectAll(void) {
+
+  GPIO_ResetBits(KEYS_COL_PORT, KEYS_COL0_PIN | KEYS_COL1_PIN |
+      KEYS_COL2_PIN | KEYS_COL3_PIN);
+}
+/**
+ * @brief Wakes up the core on the next key press.
+ *
+ * @details Selects all columns and unmasks the row interrupts. The
+ * callback is called once from the interrupt, then the interrupts are
+ * masked again. If a key is already pressed, it is called at once
+ * (from the interrupt too). Select a column before scanning again.
+ *
+ * @param callback Function called on key press
+ */
+void KEYS_HAL_EnableWakeup(void (*callback)(void)) {
+
+  wakeupCallback = callback;
+
+  EXTI_ClearITPendingBit(KEYS_ROW_EXTI_LINES);
+  EXTI->IMR |= KEYS_ROW_EXTI_LINES;
+
+  KEYS_HAL_SelectAll();
+
+  // a key held down now doesn't give an edge
+  if (KEYS_HAL_ReadRow() != -1) {
+    EXTI_GenerateSWInterrupt(KEYS_ROW_EXTI_LINES);
+  }
 }
 /**
  * @brief Select a column
@@ -119,3 +179,15 @@ int8_t KEYS_HAL_ReadRow(void) {
 
   return -1;
 }
+/**
+ * @brief Interrupt handler for the rows (EXTI lines 10 to 15).
+ */
+void EXTI15_10_IRQHandler(void) {
+
+  EXTI->IMR &= ~KEYS_ROW_EXTI_LINES; // once - scanning takes over
+  EXTI_ClearITPendingBit(KEYS_ROW_EXTI_LINES);
+
+  if (wakeupCallback) {
+    wakeupCallback();
+  }
+}
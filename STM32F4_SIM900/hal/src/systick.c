@@ -29,6 +29,8 @@
  */
 
 static volatile uint32_t sysTicks;  ///< Delay timer.
+static uint32_t tickReload;         ///< Core clock cycles per tick
+static void (*tickCallback)(void);  ///< Function called on every tick
 
 /**
  * @brief Initialize the SysTick with a given frequency
@@ -40,7 +42,13 @@ void SYSTICK_Init(uint32_t freq) {
 
   RCC_GetClocksFreq(&RCC_Clocks); // Complete the clocks structure with current clock settings.
 
-  SysTick_Config(RCC_Clocks.HCLK_Frequency / freq); // Set SysTick frequency
+#ifdef HAL_QEMU
+  RCC_Clocks.HCLK_Frequency = SystemCoreClock; // RCC isn't emulated, the core clock is fixed
+#endif
+
+  tickReload = RCC_Clocks.HCLK_Frequency / freq;
+
+  SysTick_Config(tickReload); // Set SysTick frequency
 
 }
 /**
@@ -51,6 +59,92 @@ uint32_t SYSTICK_GetTime(void) {
   return sysTicks;
 }
 
+/**
+ * @brief Sets function called from SysTick interrupt on every tick.
+ * @param callback Tick function (NULL - none)
+ */
+void SYSTICK_SetTickCallback(void (*callback)(void)) {
+
+  tickCallback = callback;
+}
+/**
+ * @brief Sleeps for a given number of ticks or until an interrupt.
+ *
+ * @details SysTick is reprogrammed to fire only after the requested
+ * number of ticks and the core waits for an interrupt. Any interrupt
+ * (UART, EXTI etc.) wakes it up earlier. After waking up the ticks
+ * which passed are added to the system time, so it stays correct.
+ * The sleep is limited by the 24-bit SysTick counter.
+ *
+ * @param ticks Number of ticks to sleep
+ * @param abort Function checked with interrupts disabled just before
+ * sleeping - if it returns nonzero, there is work to do and the core
+ * doesn't sleep (can be NULL)
+ */
+void SYSTICK_Sleep(uint32_t ticks, uint8_t (*abort)(void)) {
+
+  uint32_t maxTicks = SysTick_LOAD_RELOAD_Msk / tickReload;
+
+  if (ticks > maxTicks) {
+    ticks = maxTicks;
+  }
+
+  __disable_irq(); // pending interrupts will still wake up WFI
+
+  if (abort && abort()) {
+    __enable_irq();
+    return;
+  }
+
+  if (ticks <= 1) { // next SysTick interrupt wakes us anyway
+    __DSB();
+    __WFI();
+    __enable_irq();
+    return;
+  }
+
+  // Stop SysTick and make it expire at the end of the last tick
+  SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+  uint32_t remaining = SysTick->VAL; // cycles left in current tick
+
+  SysTick->LOAD = remaining + tickReload * (ticks - 1) - 1;
+  SysTick->VAL  = 0;
+  SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+  __DSB();
+  __WFI();
+
+  // Woken up - interrupts are still disabled
+  uint32_t ctrl = SysTick->CTRL; // reading clears COUNTFLAG
+  SysTick->CTRL = ctrl & ~SysTick_CTRL_ENABLE_Msk;
+
+  if (ctrl & SysTick_CTRL_COUNTFLAG_Msk) {
+
+    // Slept the whole time - the pending SysTick interrupt counts the last tick
+    sysTicks += ticks - 1;
+    SysTick->LOAD = tickReload - 1;
+    SysTick->VAL  = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+  } else {
+
+    // Woken up by another interrupt - count the ticks which passed
+    uint32_t elapsed = (tickReload - remaining) + (SysTick->LOAD - SysTick->VAL);
+    uint32_t left    = tickReload - (elapsed % tickReload); // cycles to end of tick
+
+    sysTicks += elapsed / tickReload;
+
+    // Finish the current tick, then continue with normal ticks
+    SysTick->LOAD = (left > 1) ? left - 1 : 1;
+    SysTick->VAL  = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = tickReload - 1;
+  }
+
+  __enable_irq();
+}
+
 /**
  * @brief Interrupt handler for SysTick.
  */
@@ -58,6 +152,10 @@ void SysTick_Handler(void) {
 
   sysTicks++; // Update system time
 
+  if (tickCallback) {
+    tickCallback();
+  }
+
 }
 
 /**
@@ -0,0 +1,64 @@
+/**
+ * @file: 	timer2.c
+ * @brief:	Free-running microsecond counter
+ * @date: 	10 paź 2014
+ * @author: Michal Ksiezopolski
+ * 
+ * @verbatim
+ * Copyright (c) 2014 Michal Ksiezopolski.
+ * All rights reserved. This program and the 
+ * accompanying materials are made available 
+ * under the terms of the GNU Public License 
+ * v3.0 which accompanies this distribution, 
+ * and is available at 
+ * http://www.gnu.org/licenses/gpl.html
+ * @endverbatim
+ */
+
+#include <stm32f4xx.h>
+#include <timer2.h>
+
+/**
+ * @brief Initialize timer2 as microsecond counter
+ *
+ * @details TIM2 is a 32-bit timer, so prescaled to 1 MHz it counts
+ * microseconds over the whole uint32_t range on its own. No interrupt
+ * is used - the time is read directly from the counter register.
+ */
+void TIMER2_Init(void) {
+
+  RCC_ClocksTypeDef RCC_Clocks;
+
+  RCC_GetClocksFreq(&RCC_Clocks);
+
+  // APB1 timers run at twice the bus clock if APB1 is prescaled
+  uint32_t timerClock = RCC_Clocks.PCLK1_Frequency;
+  if (RCC_Clocks.PCLK1_Frequency != RCC_Clocks.HCLK_Frequency) {
+    timerClock *= 2;
+  }
+
+#ifdef HAL_QEMU
+  timerClock = 1000000000; // QEMU timers count nanoseconds of virtual time
+#endif
+
+  RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
+
+  TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+  TIM_TimeBaseStructure.TIM_Prescaler = timerClock / 1000000 - 1; // count every microsecond
+  TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+  TIM_TimeBaseStructure.TIM_Period = UINT32_MAX; // use whole 32-bit range
+  TIM_TimeBaseStructure.TIM_ClockDivision = 0;
+  TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
+  TIM_TimeBaseInit(TIM2, &TIM_TimeBaseStructure);
+
+  TIM_Cmd(TIM2, ENABLE); // enable timer
+}
+/**
+ * @brief Get time value
+ * @return Time in microseconds
+ */
+uint32_t TIMER2_GetTime(void) {
+
+  return TIM2->CNT;
+
+}
@@ -16,6 +16,7 @@
  */
 
 #include <uart2.h>
+#include <trace_hal.h>
 #include <stm32f4xx.h>
 
 /**
@@ -26,6 +27,17 @@
 static void    (*rxCallback)(uint8_t);   ///< Callback function for receiving data
 static uint8_t (*txCallback)(uint8_t*);  ///< Callback function for transmitting data
 
+#define UART2_TX_DMA_STREAM   DMA1_Stream6      ///< DMA stream for USART2 TX
+#define UART2_TX_DMA_CHANNEL  DMA_Channel_4     ///< DMA channel for USART2 TX
+#define UART2_TX_DMA_IRQn     DMA1_Stream6_IRQn ///< DMA stream interrupt
+#define UART2_TX_DMA_IT_TC    DMA_IT_TCIF6      ///< Transfer complete interrupt
+#define UART2_TX_DMA_FLAGS    (DMA_FLAG_TCIF6 | DMA_FLAG_HTIF6 | \
+    DMA_FLAG_TEIF6 | DMA_FLAG_DMEIF6 | DMA_FLAG_FEIF6)   ///< All flags of the stream
+
+static uint16_t (*txPeekCallback)(uint8_t**); ///< Callback returning contiguous data to send (DMA mode)
+static void     (*txDoneCallback)(uint16_t);  ///< Callback releasing sent data (DMA mode)
+static volatile uint16_t txDmaLen;            ///< Length of DMA transfer in progress (0 - DMA idle)
+
 /**
  * @brief Initialize USART2
  * @param baud
@@ -87,13 +99,141 @@ void UART2_Init(uint32_t baud, void(*rxCb)(uint8_t), uint8_t(*txCb)(uint8_t*) )
   NVIC_EnableIRQ(USART2_IRQn);
 
 }
+/**
+ * @brief Switch USART2 transmitter to DMA mode.
+ *
+ * @details Instead of one TXE interrupt per byte, the largest contiguous
+ * block of data returned by peekCb is handed over to the DMA stream.
+ * When the transfer completes, doneCb is called with the number of
+ * bytes sent and the next block is started. Call after UART2_Init.
+ *
+ * @param peekCb Returns pointer to and length of the data to send
+ * @param doneCb Releases the given number of sent bytes
+ */
+void UART2_TxDmaInit(uint16_t(*peekCb)(uint8_t**), void(*doneCb)(uint16_t)) {
+
+  DMA_InitTypeDef DMA_InitStructure;
+
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+
+  DMA_DeInit(UART2_TX_DMA_STREAM);
+
+  // Memory to USART data register, memory address and length
+  // are set for every transfer
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.DMA_Channel             = UART2_TX_DMA_CHANNEL;
+  DMA_InitStructure.DMA_PeripheralBaseAddr  = (uint32_t)&USART2->DR;
+  DMA_InitStructure.DMA_DIR                 = DMA_DIR_MemoryToPeripheral;
+  DMA_InitStructure.DMA_BufferSize          = 1;
+  DMA_InitStructure.DMA_PeripheralInc       = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc           = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize  = DMA_PeripheralDataSize_Byte;
+  DMA_InitStructure.DMA_MemoryDataSize      = DMA_MemoryDataSize_Byte;
+  DMA_InitStructure.DMA_Mode                = DMA_Mode_Normal;
+  DMA_InitStructure.DMA_Priority            = DMA_Priority_Medium;
+  DMA_InitStructure.DMA_FIFOMode            = DMA_FIFOMode_Disable;
+  DMA_Init(UART2_TX_DMA_STREAM, &DMA_InitStructure);
+
+  DMA_ITConfig(UART2_TX_DMA_STREAM, DMA_IT_TC, ENABLE);
+
+  // TXE interrupt isn't used any more
+  USART_ITConfig(USART2, USART_IT_TXE, DISABLE);
+  USART_DMACmd(USART2, USART_DMAReq_Tx, ENABLE);
+
+  txDmaLen       = 0;
+  txDoneCallback = doneCb;
+  txPeekCallback = peekCb;
+
+  NVIC_EnableIRQ(UART2_TX_DMA_IRQn);
+}
+/**
+ * @brief Starts a DMA transfer of the next block of data.
+ * @details Has to be called with the stream disabled and
+ * its interrupt masked (or from the interrupt itself).
+ */
+static void UART2_TxDmaStart(void) {
+
+  uint8_t* data;
+  uint16_t len = txPeekCallback(&data);
+
+  txDmaLen = len;
+
+  if (len == 0) {
+    return; // nothing to send - DMA stays idle
+  }
+
+  TRACE_HAL_Record(TRACE_HAL_UART2_TX, data, len);
+
+  DMA_ClearFlag(UART2_TX_DMA_STREAM, UART2_TX_DMA_FLAGS);
+  DMA_MemoryTargetConfig(UART2_TX_DMA_STREAM, (uint32_t)data, DMA_Memory_0);
+  DMA_SetCurrDataCounter(UART2_TX_DMA_STREAM, len);
+  DMA_Cmd(UART2_TX_DMA_STREAM, ENABLE);
+}
 /**
  * @brief Enable transmitter.
  * @details This function has to be called by the higher layer
  * in order to start the transmitter.
  */
 void UART2_TxEnable(void) {
-  USART_ITConfig(USART2, USART_IT_TXE, ENABLE);
+
+  if (txPeekCallback) { // DMA mode
+
+    // if DMA is idle, start it - otherwise the new data is
+    // picked up when the current transfer completes
+    NVIC_DisableIRQ(UART2_TX_DMA_IRQn);
+    if (txDmaLen == 0) {
+      UART2_TxDmaStart();
+    }
+    NVIC_EnableIRQ(UART2_TX_DMA_IRQn);
+
+  } else {
+    USART_ITConfig(USART2, USART_IT_TXE, ENABLE);
+  }
+}
+/**
+ * @brief Masks the transmitter interrupts (USART and TX DMA).
+ * @details Lets the higher layer modify data, which the interrupts
+ * would read meanwhile. A DMA transfer in progress continues,
+ * see UART2_TxInFlight.
+ */
+void UART2_TxLock(void) {
+
+  NVIC_DisableIRQ(USART2_IRQn);
+  NVIC_DisableIRQ(UART2_TX_DMA_IRQn);
+}
+/**
+ * @brief Unmasks the transmitter interrupts.
+ */
+void UART2_TxUnlock(void) {
+
+  NVIC_EnableIRQ(USART2_IRQn);
+  if (txPeekCallback) { // DMA mode
+    NVIC_EnableIRQ(UART2_TX_DMA_IRQn);
+  }
+}
+/**
+ * @brief Returns number of bytes being sent by DMA.
+ * @details These bytes are still in the buffer of the higher
+ * layer and can't be modified until the transfer completes.
+ * @return Length of current DMA transfer (0 - DMA idle or TXE mode)
+ */
+uint16_t UART2_TxInFlight(void) {
+
+  return txDmaLen;
+}
+/**
+ * @brief IRQ handler for USART2 TX DMA stream
+ */
+void DMA1_Stream6_IRQHandler(void) {
+
+  // If transfer complete interrupt
+  if (DMA_GetITStatus(UART2_TX_DMA_STREAM, UART2_TX_DMA_IT_TC) != RESET) {
+
+    DMA_ClearITPendingBit(UART2_TX_DMA_STREAM, UART2_TX_DMA_IT_TC);
+
+    txDoneCallback(txDmaLen); // release sent data
+    UART2_TxDmaStart();      // and send the rest
+  }
 }
 
 /**
@@ -110,6 +250,7 @@ void USART2_IRQHandler(void) {
       // get data from higher layer using callback
       if (txCallback(&c)) {
         USART_SendData(USART2, c); // Send data
+        TRACE_HAL_Record(TRACE_HAL_UART2_TX, &c, 1);
       } else { // if no more data to send disable the transmitter
         USART_ITConfig(USART2, USART_IT_TXE, DISABLE);
       }
@@ -121,6 +262,8 @@ void USART2_IRQHandler(void) {
 
     uint8_t c = USART_ReceiveData(USART2); // Get data from UART
 
+    TRACE_HAL_Record(TRACE_HAL_UART2_RX, &c, 1);
+
     if (rxCallback) { // if not NULL
       rxCallback(c); // send received data to higher layer
     }
@@ -17,6 +17,7 @@
  */
 
 #include <uart3.h>
+#include <trace_hal.h>
 #include <stm32f4xx.h>
 
 /**
@@ -27,6 +28,28 @@
 static void    (*rxCallback)(uint8_t);   ///< Callback function for receiving data
 static uint8_t (*txCallback)(uint8_t*);  ///< Callback function for transmitting data
 
+#define UART3_TX_DMA_STREAM   DMA1_Stream3      ///< DMA stream for USART3 TX
+#define UART3_TX_DMA_CHANNEL  DMA_Channel_4     ///< DMA channel for USART3 TX
+#define UART3_TX_DMA_IRQn     DMA1_Stream3_IRQn ///< DMA stream interrupt
+#define UART3_TX_DMA_IT_TC    DMA_IT_TCIF3      ///< Transfer complete interrupt
+#define UART3_TX_DMA_FLAGS    (DMA_FLAG_TCIF3 | DMA_FLAG_HTIF3 | \
+    DMA_FLAG_TEIF3 | DMA_FLAG_DMEIF3 | DMA_FLAG_FEIF3)   ///< All flags of the stream
+
+static uint16_t (*txPeekCallback)(uint8_t**); ///< Callback returning contiguous data to send (DMA mode)
+static void     (*txDoneCallback)(uint16_t);  ///< Callback releasing sent data (DMA mode)
+static volatile uint16_t txDmaLen;            ///< Length of DMA transfer in progress (0 - DMA idle)
+
+#define UART3_RX_DMA_STREAM   DMA1_Stream1      ///< DMA stream for USART3 RX
+#define UART3_RX_DMA_CHANNEL  DMA_Channel_4     ///< DMA channel for USART3 RX
+#define UART3_RX_DMA_IRQn     DMA1_Stream1_IRQn ///< DMA stream interrupt
+#define UART3_RX_DMA_IT_HT    DMA_IT_HTIF1      ///< Half transfer interrupt
+#define UART3_RX_DMA_IT_TC    DMA_IT_TCIF1      ///< Transfer complete interrupt
+#define UART3_RX_DMA_LEN      256               ///< Length of circular RX buffer
+
+static uint8_t  rxDmaBuffer[UART3_RX_DMA_LEN];      ///< Circular buffer written by DMA
+static uint16_t rxDmaPos;                           ///< Position up to which data was passed on
+static void (*rxBlockCallback)(const uint8_t*, uint16_t); ///< Callback for received blocks (DMA mode)
+
 /**
  * @brief Initialize USART3
  * @param baud
@@ -88,17 +111,245 @@ void UART3_Init(uint32_t baud, void(*rxCb)(uint8_t), uint8_t(*txCb)(uint8_t*) )
   NVIC_EnableIRQ(USART3_IRQn);
 
 }
+/**
+ * @brief Switch USART3 transmitter to DMA mode.
+ *
+ * @details Instead of one TXE interrupt per byte, the largest contiguous
+ * block of data returned by peekCb is handed over to the DMA stream.
+ * When the transfer completes, doneCb is called with the number of
+ * bytes sent and the next block is started. Call after UART3_Init.
+ *
+ * @param peekCb Returns pointer to and length of the data to send
+ * @param doneCb Releases the given number of sent bytes
+ */
+void UART3_TxDmaInit(uint16_t(*peekCb)(uint8_t**), void(*doneCb)(uint16_t)) {
+
+  DMA_InitTypeDef DMA_InitStructure;
+
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+
+  DMA_DeInit(UART3_TX_DMA_STREAM);
+
+  // Memory to USART data register, memory address and length
+  // are set for every transfer
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.DMA_Channel             = UART3_TX_DMA_CHANNEL;
+  DMA_InitStructure.DMA_PeripheralBaseAddr  = (uint32_t)&USART3->DR;
+  DMA_InitStructure.DMA_DIR                 = DMA_DIR_MemoryToPeripheral;
+  DMA_InitStructure.DMA_BufferSize          = 1;
+  DMA_InitStructure.DMA_PeripheralInc       = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc           = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize  = DMA_PeripheralDataSize_Byte;
+  DMA_InitStructure.DMA_MemoryDataSize      = DMA_MemoryDataSize_Byte;
+  DMA_InitStructure.DMA_Mode                = DMA_Mode_Normal;
+  DMA_InitStructure.DMA_Priority            = DMA_Priority_Medium;
+  DMA_InitStructure.DMA_FIFOMode            = DMA_FIFOMode_Disable;
+  DMA_Init(UART3_TX_DMA_STREAM, &DMA_InitStructure);
+
+  DMA_ITConfig(UART3_TX_DMA_STREAM, DMA_IT_TC, ENABLE);
+
+  // TXE interrupt isn't used any more
+  USART_ITConfig(USART3, USART_IT_TXE, DISABLE);
+  USART_DMACmd(USART3, USART_DMAReq_Tx, ENABLE);
+
+  txDmaLen       = 0;
+  txDoneCallback = doneCb;
+  txPeekCallback = peekCb;
+
+  NVIC_EnableIRQ(UART3_TX_DMA_IRQn);
+}
+/**
+ * @brief Starts a DMA transfer of the next block of data.
+ * @details Has to be called with the stream disabled and
+ * its interrupt masked (or from the interrupt itself).
+ */
+static void UART3_TxDmaStart(void) {
+
+  uint8_t* data;
+  uint16_t len = txPeekCallback(&data);
+
+  txDmaLen = len;
+
+  if (len == 0) {
+    return; // nothing to send - DMA stays idle
+  }
+
+  TRACE_HAL_Record(TRACE_HAL_UART3_TX, data, len);
+
+  DMA_ClearFlag(UART3_TX_DMA_STREAM, UART3_TX_DMA_FLAGS);
+  DMA_MemoryTargetConfig(UART3_TX_DMA_STREAM, (uint32_t)data, DMA_Memory_0);
+  DMA_SetCurrDataCounter(UART3_TX_DMA_STREAM, len);
+  DMA_Cmd(UART3_TX_DMA_STREAM, ENABLE);
+}
 /**
  * @brief Enable transmitter.
  * @details This function has to be called by the higher layer
  * in order to start the transmitter.
  */
 void UART3_TxEnable(void) {
-  USART_ITConfig(USART3, USART_IT_TXE, ENABLE);
+
+  if (txPeekCallback) { // DMA mode
+
+    // if DMA is idle, start it - otherwise the new data is
+    // picked up when the current transfer completes
+    NVIC_DisableIRQ(UART3_TX_DMA_IRQn);
+    if (txDmaLen == 0) {
+      UART3_TxDmaStart();
+    }
+    NVIC_EnableIRQ(UART3_TX_DMA_IRQn);
+
+  } else {
+    USART_ITConfig(USART3, USART_IT_TXE, ENABLE);
+  }
+}
+/**
+ * @brief Masks the transmitter interrupts (USART and TX DMA).
+ * @details Lets the higher layer modify data, which the interrupts
+ * would read meanwhile. A DMA transfer in progress continues,
+ * see UART3_TxInFlight.
+ */
+void UART3_TxLock(void) {
+
+  NVIC_DisableIRQ(USART3_IRQn);
+  NVIC_DisableIRQ(UART3_TX_DMA_IRQn);
+}
+/**
+ * @brief Unmasks the transmitter interrupts.
+ */
+void UART3_TxUnlock(void) {
+
+  NVIC_EnableIRQ(USART3_IRQn);
+  if (txPeekCallback) { // DMA mode
+    NVIC_EnableIRQ(UART3_TX_DMA_IRQn);
+  }
+}
+/**
+ * @brief Returns number of bytes being sent by DMA.
+ * @details These bytes are still in the buffer of the higher
+ * layer and can't be modified until the transfer completes.
+ * @return Length of current DMA transfer (0 - DMA idle or TXE mode)
+ */
+uint16_t UART3_TxInFlight(void) {
+
+  return txDmaLen;
 }
+/**
+ * @brief IRQ handler for USART3 TX DMA stream
+ */
+void DMA1_Stream3_IRQHandler(void) {
+
+  // If transfer complete interrupt
+  if (DMA_GetITStatus(UART3_TX_DMA_STREAM, UART3_TX_DMA_IT_TC) != RESET) {
+
+    DMA_ClearITPendingBit(UART3_TX_DMA_STREAM, UART3_TX_DMA_IT_TC);
+
+    txDoneCallback(txDmaLen); // release sent data
+    UART3_TxDmaStart();       // and send the rest
+  }
+}
+
+/**
+ * @brief Switch USART3 receiver to circular DMA mode.
+ *
+ * @details DMA writes received data continuously into a circular
+ * buffer. New data is passed to the higher layer in blocks when
+ * half of the buffer or the whole buffer is filled and when the
+ * line goes idle (end of a burst). So there is no interrupt per
+ * byte and short interrupt latency spikes don't cause overruns.
+ * Call after UART3_Init.
+ *
+ * @param rxBlockCb Callback receiving blocks of data
+ */
+void UART3_RxDmaInit(void(*rxBlockCb)(const uint8_t*, uint16_t)) {
+
+  DMA_InitTypeDef DMA_InitStructure;
+
+  rxBlockCallback = rxBlockCb;
+  rxDmaPos        = 0;
+
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+
+  DMA_DeInit(UART3_RX_DMA_STREAM);
+
+  // USART data register to circular buffer
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.DMA_Channel             = UART3_RX_DMA_CHANNEL;
+  DMA_InitStructure.DMA_PeripheralBaseAddr  = (uint32_t)&USART3->DR;
+  DMA_InitStructure.DMA_Memory0BaseAddr     = (uint32_t)rxDmaBuffer;
+  DMA_InitStructure.DMA_DIR                 = DMA_DIR_PeripheralToMemory;
+  DMA_InitStructure.DMA_BufferSize          = UART3_RX_DMA_LEN;
+  DMA_InitStructure.DMA_PeripheralInc       = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc           = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize  = DMA_PeripheralDataSize_Byte;
+  DMA_InitStructure.DMA_MemoryDataSize      = DMA_MemoryDataSize_Byte;
+  DMA_InitStructure.DMA_Mode                = DMA_Mode_Circular;
+  DMA_InitStructure.DMA_Priority            = DMA_Priority_High;
+  DMA_InitStructure.DMA_FIFOMode            = DMA_FIFOMode_Disable;
+  DMA_Init(UART3_RX_DMA_STREAM, &DMA_InitStructure);
+
+  DMA_ITConfig(UART3_RX_DMA_STREAM, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+  // RXNE interrupt isn't used any more - idle line ends a burst
+  USART_ITConfig(USART3, USART_IT_RXNE, DISABLE);
+  USART_ITConfig(USART3, USART_IT_IDLE, ENABLE);
+  USART_DMACmd(USART3, USART_DMAReq_Rx, ENABLE);
+
+  DMA_Cmd(UART3_RX_DMA_STREAM, ENABLE);
+
+  NVIC_EnableIRQ(UART3_RX_DMA_IRQn);
+}
+/**
+ * @brief Passes a block received by DMA to higher layer.
+ * @param data Data
+ * @param len Data length
+ */
+static void UART3_RxDmaBlock(const uint8_t* data, uint16_t len) {
+
+  TRACE_HAL_Record(TRACE_HAL_UART3_RX, data, len);
+  rxBlockCallback(data, len);
+}
+/**
+ * @brief Passes data written by DMA since the last call to higher layer.
+ * @details Called from the DMA and USART interrupts, which have the
+ * same priority, so they don't preempt each other.
+ */
+static void UART3_RxDmaFlush(void) {
+
+  // DMA write position in circular buffer
+  uint16_t pos = UART3_RX_DMA_LEN - DMA_GetCurrDataCounter(UART3_RX_DMA_STREAM);
 
+  if (pos == rxDmaPos) {
+    return; // no new data
+  }
+
+  if (pos > rxDmaPos) {
+    UART3_RxDmaBlock(&rxDmaBuffer[rxDmaPos], pos - rxDmaPos);
+  } else { // DMA wrapped around
+    UART3_RxDmaBlock(&rxDmaBuffer[rxDmaPos], UART3_RX_DMA_LEN - rxDmaPos);
+    if (pos) {
+      UART3_RxDmaBlock(rxDmaBuffer, pos);
+    }
+  }
+
+  rxDmaPos = pos & (UART3_RX_DMA_LEN - 1);
+}
 /**
- * @brief IRQ handler for USART2
+ * @brief IRQ handler for USART3 RX DMA stream
+ */
+void DMA1_Stream1_IRQHandler(void) {
+
+  // If half or whole buffer was filled
+  if (DMA_GetITStatus(UART3_RX_DMA_STREAM, UART3_RX_DMA_IT_HT) != RESET) {
+    DMA_ClearITPendingBit(UART3_RX_DMA_STREAM, UART3_RX_DMA_IT_HT);
+    UART3_RxDmaFlush();
+  }
+  if (DMA_GetITStatus(UART3_RX_DMA_STREAM, UART3_RX_DMA_IT_TC) != RESET) {
+    DMA_ClearITPendingBit(UART3_RX_DMA_STREAM, UART3_RX_DMA_IT_TC);
+    UART3_RxDmaFlush();
+  }
+}
+/**
+ * @brief IRQ handler for USART3
  */
 void USART3_IRQHandler(void) {
 
@@ -111,6 +362,7 @@ void USART3_IRQHandler(void) {
       // get data from higher layer using callback
       if (txCallback(&c)) {
         USART_SendData(USART3, c); // Send data
+        TRACE_HAL_Record(TRACE_HAL_UART3_TX, &c, 1);
       } else { // if no more data to send disable the transmitter
         USART_ITConfig(USART3, USART_IT_TXE, DISABLE);
       }
@@ -122,10 +374,22 @@ void USART3_IRQHandler(void) {
 
     uint8_t c = USART_ReceiveData(USART3); // Get data from UART
 
+    TRACE_HAL_Record(TRACE_HAL_UART3_RX, &c, 1);
+
     if (rxCallback) { // if not NULL
       rxCallback(c); // send received data to higher layer
     }
   }
+
+  // If line went idle (DMA mode - end of burst)
+  if(USART_GetITStatus(USART3, USART_IT_IDLE) != RESET) {
+
+    // IDLE flag is cleared by reading SR and then DR
+    (void)USART3->SR;
+    (void)USART3->DR;
+
+    UART3_RxDmaFlush();
+  }
 }
 
 /**
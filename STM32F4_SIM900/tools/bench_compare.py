@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+Compares two results of the benchmarks (bench/bench.c).
+
+Prints the change of the count per iteration of every benchmark.
+Under QEMU with -icount the counts are instruction counts, so any
+change comes from the code, not from the host.
+
+Usage:
+  bench_compare.py BASELINE RESULTS [THRESHOLD]
+
+THRESHOLD is the allowed increase in percent (default 2). The exit
+status is 1 if any benchmark got slower by more than that, or if
+a benchmark is missing from RESULTS.
+
+Copyright (c) 2014 Michal Ksiezopolski.
+GNU Public License v3.0 (http://www.gnu.org/licenses/gpl.html)
+"""
+
+import sys
+
+
+def read_results(path):
+    """Returns {name: count per iteration} and the unit."""
+    results = {}
+    unit = "?"
+    with open(path) as f:
+        for line in f:
+            if line.startswith("#"):
+                if "unit:" in line:
+                    unit = line.split("unit:")[1].strip()
+                continue
+            fields = line.split()
+            if len(fields) == 4:
+                results[fields[0]] = float(fields[3])
+    return results, unit
+
+
+def main(argv):
+    if len(argv) not in (3, 4):
+        sys.stderr.write(__doc__)
+        return 2
+
+    base, base_unit = read_results(argv[1])
+    new, new_unit = read_results(argv[2])
+    threshold = float(argv[3]) if len(argv) == 4 else 2.0
+
+    if base_unit != new_unit:
+        print("Units differ: %s and %s" % (base_unit, new_unit))
+        return 1
+
+    failed = False
+    print("%-14s %12s %12s %8s" % ("name", "baseline", "new", "change"))
+
+    for name, old in base.items():
+        if name not in new:
+            print("%-14s %12.2f %12s" % (name, old, "missing"))
+            failed = True
+            continue
+        change = (new[name] - old) * 100 / old if old else 0.0
+        mark = ""
+        if change > threshold:
+            mark = " SLOWER"
+            failed = True
+        elif change < -threshold:
+            mark = " faster"
+        print("%-14s %12.2f %12.2f %+7.1f%%%s" % (name, old, new[name], change, mark))
+
+    for name in new:
+        if name not in base:
+            print("%-14s %12s %12.2f" % (name, "new", new[name]))
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""
+Reference encoder/decoder of the COMM binary protocol (COMM_MODE_BINARY).
+
+Packet before encoding: sequence number, type, payload,
+CRC-16/CCITT (polynomial 0x1021, initial 0xffff, big endian)
+of the previous bytes. Packets are COBS encoded and delimited
+with a zero byte.
+
+Usage:
+  comm_packet.py encode TYPE HEXDATA [SEQ]   - print encoded packet (hex)
+  comm_packet.py decode HEXDATA              - decode packet(s)
+  comm_packet.py bench [SIZE]                - throughput of this implementation
+                                               and wire efficiency at 115200 baud
+
+Copyright (c) 2014 Michal Ksiezopolski.
+GNU Public License v3.0 (http://www.gnu.org/licenses/gpl.html)
+"""
+
+import sys
+import time
+
+PACKET_COMMAND = 0x01
+PACKET_TEXT = 0x02
+PACKET_TEXT_MODE = 0x03
+
+MAX_PAYLOAD = 249  # COMM_PACKET_LEN
+
+
+def crc16(data):
+    crc = 0xffff
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xffff
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos = 0
+    code = 1
+    for b in data:
+        if b == 0:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+        else:
+            out.append(b)
+            code += 1
+            if code == 0xff:
+                out[code_pos] = code
+                code_pos = len(out)
+                out.append(0)
+                code = 1
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            raise ValueError("invalid COBS data")
+        block = data[i:i + code - 1]
+        if 0 in block:
+            raise ValueError("zero in COBS data")
+        out += block
+        i += code - 1
+        if code != 0xff and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode(ptype, payload, seq=0):
+    """Returns packet with delimiter, ready to be sent."""
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError("payload too long")
+    packet = bytes([seq & 0xff, ptype]) + bytes(payload)
+    crc = crc16(packet)
+    return cobs_encode(packet + bytes([crc >> 8, crc & 0xff])) + b"\x00"
+
+
+def decode(frame):
+    """Decodes one frame (without delimiter), returns (seq, type, payload)."""
+    packet = cobs_decode(frame)
+    if len(packet) < 4:
+        raise ValueError("packet too short")
+    if crc16(packet[:-2]) != (packet[-2] << 8) | packet[-1]:
+        raise ValueError("CRC error")
+    return packet[0], packet[1], packet[2:-2]
+
+
+class Decoder:
+    """Splits a byte stream into packets."""
+
+    def __init__(self):
+        self.buf = bytearray()
+
+    def feed(self, data):
+        """Returns list of (seq, type, payload) or ValueError for bad frames."""
+        self.buf += data
+        result = []
+        while 0 in self.buf:
+            end = self.buf.index(0)
+            frame = bytes(self.buf[:end])
+            del self.buf[:end + 1]
+            if frame:
+                try:
+                    result.append(decode(frame))
+                except ValueError as e:
+                    result.append(e)
+        return result
+
+
+def bench(size):
+    import os
+    payload = os.urandom(size)
+    packets = [payload[i:i + MAX_PAYLOAD] for i in range(0, size, MAX_PAYLOAD)]
+
+    t = time.perf_counter()
+    stream = b"".join(encode(PACKET_TEXT, p, i) for i, p in enumerate(packets))
+    t_enc = time.perf_counter() - t
+
+    t = time.perf_counter()
+    decoded = Decoder().feed(stream)
+    t_dec = time.perf_counter() - t
+
+    assert b"".join(d[2] for d in decoded) == payload
+
+    hex_text = len(payload) * 2 + len(packets)  # hex in text with CR per line
+    byte_time = 10 / 115200.0  # start + 8 data + stop bits
+    print("payload          %d bytes in %d packets" % (size, len(packets)))
+    print("encode           %.2f MB/s" % (size / t_enc / 1e6))
+    print("decode           %.2f MB/s" % (size / t_dec / 1e6))
+    print("binary on wire   %d bytes, %.1f kB/s payload at 115200"
+          % (len(stream), size / (len(stream) * byte_time) / 1e3))
+    print("hex text on wire %d bytes, %.1f kB/s payload at 115200"
+          % (hex_text, size / (hex_text * byte_time) / 1e3))
+
+
+def main(argv):
+    if len(argv) >= 3 and argv[1] == "encode":
+        seq = int(argv[4], 0) if len(argv) > 4 else 0
+        print(encode(int(argv[2], 0), bytes.fromhex(argv[3]), seq).hex())
+    elif len(argv) == 3 and argv[1] == "decode":
+        for p in Decoder().feed(bytes.fromhex(argv[2]) + b"\x00"):
+            if isinstance(p, ValueError):
+                print("error:", p)
+            else:
+                print("seq %d type %d payload %s" % (p[0], p[1], p[2].hex()))
+    elif len(argv) >= 2 and argv[1] == "bench":
+        bench(int(argv[2]) if len(argv) > 2 else 100000)
+    else:
+        print(__doc__)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
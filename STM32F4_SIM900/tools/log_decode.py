@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""
+Decoder of the deferred log (log.h).
+
+Reads the COMM output (serial port or capture file), prints text as is
+and rebuilds log records (COMM_PACKET_LOG packets) using the format
+strings from the log_fmt section of the ELF file. Captured UART traffic
+(COMM_PACKET_TRACE packets, see trace.h) is saved to a file with --trace
+or skipped. Other packets and invalid data are printed as text.
+
+Record format (little endian): format string ID (offset in log_fmt),
+record length, level << 4 | number of arguments, timestamp in ms,
+arguments (4 bytes each), characters of string arguments (a string
+argument holds its length). A hex dump record (15 arguments) holds the
+buffer length and the bytes of the buffer instead.
+
+Usage:
+  log_decode.py [--trace FILE] ELF [INPUT]
+                              - INPUT defaults to stdin, a serial port
+                                has to be configured before, e.g.
+                                stty -F /dev/ttyUSB0 115200 raw
+                                FILE gets the trace (replayed by the
+                                host build with SIM_REPLAY=FILE)
+
+Copyright (c) 2014 Michal Ksiezopolski.
+GNU Public License v3.0 (http://www.gnu.org/licenses/gpl.html)
+"""
+
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from comm_packet import cobs_decode, crc16, PACKET_TEXT  # noqa: E402
+
+PACKET_LOG = 0x04
+PACKET_TRACE = 0x05
+
+HEADER_LEN = 8
+ID_DROPPED = 0xffff
+ARGC_HEX = 0x0f
+LEVELS = {1: "E", 2: "W", 3: "I", 4: "D"}
+
+SPEC = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z|j|t)?([diouxXcsfeEgGp%])")
+
+
+def log_strings(path):
+    """Returns contents of the log_fmt section of an ELF file."""
+    with open(path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF":
+        raise ValueError("not an ELF file")
+    is64 = elf[4] == 2
+    end = "<" if elf[5] == 1 else ">"
+    if is64:
+        shoff, = struct.unpack_from(end + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(end + "HHH", elf, 0x3a)
+        fmt = end + "IIQQQQ"
+    else:
+        shoff, = struct.unpack_from(end + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(end + "HHH", elf, 0x2e)
+        fmt = end + "IIIIII"
+
+    def section(i):
+        name, _, _, _, offset, size = struct.unpack_from(fmt, elf, shoff + i * shentsize)
+        return name, offset, size
+
+    _, stroff, _ = section(shstrndx)
+    for i in range(shnum):
+        name, offset, size = section(i)
+        name = elf[stroff + name:elf.index(b"\0", stroff + name)]
+        if name in (b".log_fmt", b"log_fmt"):
+            return elf[offset:offset + size]
+    raise ValueError("no log_fmt section (built with LOG_DEFERRED=0?)")
+
+
+def format_record(fmt, args, strings):
+    """Formats arguments like printf."""
+    values = []
+    args = list(args)
+
+    def arg():
+        return args.pop(0) if args else 0
+
+    def convert(m):
+        flags, width, prec, _, conv = m.groups()
+        if conv == "%":
+            return "%%"
+        if width == "*":
+            values.append(struct.unpack("<i", struct.pack("<I", arg()))[0])
+        if prec == "*":
+            values.append(struct.unpack("<i", struct.pack("<I", arg()))[0])
+        value = arg()
+        if conv == "s":
+            values.append(strings[:value].decode("latin-1"))
+            del strings[:value]
+        elif conv in "di":
+            values.append(struct.unpack("<i", struct.pack("<I", value))[0])
+            conv = "d"
+        elif conv in "feEgG":
+            values.append(struct.unpack("<f", struct.pack("<I", value))[0])
+        elif conv == "c":
+            values.append(chr(value & 0xff))
+        elif conv == "p":
+            values.append(value)
+            flags += "#"
+            conv = "x"
+        else:
+            values.append(value)
+            conv = "d" if conv == "u" else conv
+        return "%" + flags + (width or "") + ("." + prec if prec else "") + conv
+
+    try:
+        return SPEC.sub(convert, fmt) % tuple(values)
+    except (TypeError, ValueError) as e:
+        return "%s %r (%s)" % (fmt, values, e)
+
+
+def decode_records(data, strings):
+    """Yields decoded records of a COMM_PACKET_LOG payload."""
+    i = 0
+    while i + HEADER_LEN <= len(data):
+        rid, length, info, time = struct.unpack_from("<HBBI", data, i)
+        argc = info & 0x0f
+        level = LEVELS.get(info >> 4, "?")
+        if argc == ARGC_HEX:
+            if length < HEADER_LEN + 4 or i + length > len(data):
+                yield "<invalid record>"
+                return
+            total, = struct.unpack_from("<I", data, i + HEADER_LEN)
+            dump = data[i + HEADER_LEN + 4:i + length]
+            text = strings[rid:strings.index(b"\0", rid)].decode("latin-1") \
+                if rid < len(strings) else "<unknown format %#x>" % rid
+            msg = " ".join([text] + ["%02x" % b for b in dump])
+            if len(dump) < total:
+                msg += " ... (%d bytes)" % total
+            yield "[%10.3f] %s %s" % (time / 1000.0, level, msg)
+            i += length
+            continue
+        if length < HEADER_LEN + 4 * argc or i + length > len(data):
+            yield "<invalid record>"
+            return
+        args = struct.unpack_from("<%dI" % argc, data, i + HEADER_LEN)
+        text = bytearray(data[i + HEADER_LEN + 4 * argc:i + length])
+        if rid == ID_DROPPED:
+            msg = "%d log records lost" % args[0]
+        elif rid < len(strings):
+            fmt = strings[rid:strings.index(b"\0", rid)].decode("latin-1")
+            msg = format_record(fmt, args, text)
+        else:
+            msg = "<unknown format %#x> %r" % (rid, args)
+        yield "[%10.3f] %s %s" % (time / 1000.0, level, msg)
+        i += length
+
+
+def decode_stream(stream, strings, out, trace=None):
+    """Splits input on packet delimiters and prints text and records."""
+    pending = b""
+    while True:
+        chunk = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+        if not chunk:
+            break
+        pending += chunk
+        *segments, pending = pending.split(b"\0")
+        for segment in segments:
+            out.write(decode_segment(segment, strings, trace))
+        out.flush()
+    out.write(pending.decode("latin-1"))
+
+
+def decode_segment(segment, strings, trace=None):
+    """Decodes a packet or returns the segment as text."""
+    try:
+        packet = cobs_decode(segment)
+    except ValueError:
+        packet = b""
+    if len(packet) >= 4 and crc16(packet[:-2]) == struct.unpack(">H", packet[-2:])[0]:
+        if packet[1] == PACKET_LOG:
+            return "".join(r + "\n" for r in decode_records(packet[2:-2], strings))
+        if packet[1] == PACKET_TEXT:
+            return packet[2:-2].decode("latin-1")
+        if packet[1] == PACKET_TRACE:
+            if trace:
+                trace.write(packet[2:-2])
+                trace.flush()
+            return ""
+    return segment.decode("latin-1")
+
+
+def main(argv):
+    trace = None
+    if len(argv) > 2 and argv[1] == "--trace":
+        trace = open(argv[2], "wb")
+        argv = argv[:1] + argv[3:]
+    if len(argv) not in (2, 3):
+        print(__doc__)
+        return 1
+    strings = log_strings(argv[1])
+    if len(argv) == 3:
+        with open(argv[2], "rb", buffering=0) as stream:
+            decode_stream(stream, strings, sys.stdout, trace)
+    else:
+        decode_stream(sys.stdin.buffer, strings, sys.stdout, trace)
+    if trace:
+        trace.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
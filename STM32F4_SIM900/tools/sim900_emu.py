@@ -0,0 +1,560 @@
+#!/usr/bin/env python3
+"""
+SIM900 modem emulator for host testing and benchmarking.
+
+Speaks the AT dialect used by sim900.c over a serial device - usually
+the USART3 pseudo-terminal of the host build (hal/posix), but a real
+serial port works too. Supported:
+  AT, ATE0/ATE1, ATI, AT&W, ATA, ATH, ATD, AT+CPIN?, AT+CSQ, AT+CREG,
+  AT+CLIP, AT+CMGF, AT+CMGS (with "> " prompt), AT+CMGL, AT+CMGR,
+  AT+CMGD, AT+CGATT, AT+CIPSHUT, AT+CSTT, AT+CIICR, AT+CIFSR,
+  AT+CIPSTART (real TCP/UDP connection), AT+CIPSEND, AT+CIPCLOSE,
+  AT+CIPSTATUS, AT+CIPHEAD
+and the URCs RING, +CLIP, +CMTI, +CREG, +IPD, CLOSED.
+
+Events (from --script as "TIME EVENT" lines, TIME in seconds from start,
+or typed on stdin):
+  sms NUMBER TEXT   - new SMS (+CMTI)
+  ring [NUMBER]     - incoming call (RING, +CLIP if enabled)
+  hangup            - caller hung up (NO CARRIER)
+  creg STAT         - registration change (+CREG if enabled)
+  csq RSSI          - signal quality
+  raw TEXT          - send a line as is
+  stats             - print statistics
+  quit
+
+Usage:
+  sim900_emu.py [options] DEVICE
+
+  --latency MS      delay of responses (default 20)
+  --baud N          pace output like a serial line, 0 - no pacing
+                    (default 115200)
+  --error-rate P    probability of answering a command with ERROR
+  --drop-rate P     probability of dropping a response line
+  --noise-rate P    probability of corrupting an output byte
+  --script FILE     timed events
+  --seed N          random seed (repeatable error injection)
+  --verbose         print the traffic on stderr
+
+Example (host build):
+  SIM_UART3=/tmp/gsm hal/posix/build/stm32f4_sim900 &
+  tools/sim900_emu.py --script events.txt /tmp/gsm
+
+Copyright (c) 2014 Michal Ksiezopolski.
+GNU Public License v3.0 (http://www.gnu.org/licenses/gpl.html)
+"""
+
+import argparse
+import heapq
+import os
+import random
+import select
+import socket
+import sys
+import termios
+import time
+import tty
+
+CTRL_Z = 0x1a
+ESC = 0x1b
+
+
+class Modem:
+    """State of the emulated modem."""
+
+    def __init__(self, fd, args):
+        self.fd = fd
+        self.args = args
+        self.random = random.Random(args.seed)
+        self.start = time.monotonic()
+        self.events = []  # heap of (time, seq, function, args)
+        self.seq = 0
+        self.out = bytearray()  # paced output
+        self.tx_time = self.start
+        self.line = bytearray()
+        self.data = None  # (callback) while waiting for data after prompt
+        self.echo = True
+        self.text_mode = False
+        self.creg_urc = 0
+        self.creg = 1
+        self.clip = False
+        self.csq = 20
+        self.call = None  # incoming call number
+        self.sms = {}  # index -> [stat, number, time, text]
+        self.mr = 0
+        self.ip_state = "IP INITIAL"
+        self.ip_head = False
+        self.sock = None
+        self.sock_connecting = False
+        self.stats = dict(rx=0, tx=0, commands=0, errors=0, injected=0,
+                          dropped=0, sms_sent=0, ip_sent=0, ip_received=0)
+
+    # output
+
+    def log(self, prefix, data):
+        if self.args.verbose:
+            sys.stderr.write("%8.3f %s %r\n" % (time.monotonic() - self.start, prefix, bytes(data)))
+
+    def write(self, data, delay=0.0):
+        """Queues output after the response latency."""
+        self.at(delay, self._output, bytes(data))
+
+    def _output(self, data):
+        data = bytearray(data)
+        for i in range(len(data)):
+            if self.random.random() < self.args.noise_rate:
+                data[i] ^= 1 << self.random.randrange(8)
+                self.stats["injected"] += 1
+        self.out += data
+
+    def respond(self, *lines, final="OK"):
+        """Sends response lines and the final result code."""
+        text = b""
+        for line in lines + ((final,) if final else ()):
+            if self.random.random() < self.args.drop_rate:
+                self.stats["dropped"] += 1
+                continue
+            text += b"\r\n" + (line.encode("latin-1") if isinstance(line, str) else line) + b"\r\n"
+        self.write(text, self.args.latency / 1000.0)
+
+    def urc(self, *lines):
+        self.respond(*lines, final=None)
+
+    def flush(self):
+        """Writes queued output, limited by the baud rate."""
+        if not self.out:
+            return None
+        now = time.monotonic()
+        if self.args.baud:
+            self.tx_time = max(self.tx_time, now - 0.01)
+            n = int((now - self.tx_time) * self.args.baud / 10)
+            if n == 0:
+                return self.tx_time + 10.0 / self.args.baud
+        else:
+            n = len(self.out)
+        try:
+            n = os.write(self.fd, self.out[:n])
+        except BlockingIOError:
+            return now + 0.001
+        self.log("<-", self.out[:n])
+        del self.out[:n]
+        self.stats["tx"] += n
+        if self.args.baud:
+            self.tx_time += n * 10.0 / self.args.baud
+        return now if self.out else None
+
+    # events
+
+    def at(self, delay, function, *fargs):
+        self.seq += 1
+        heapq.heappush(self.events, (time.monotonic() + delay, self.seq, function, fargs))
+
+    def run_events(self):
+        now = time.monotonic()
+        while self.events and self.events[0][0] <= now:
+            _, _, function, fargs = heapq.heappop(self.events)
+            function(*fargs)
+        return self.events[0][0] if self.events else None
+
+    def event(self, text):
+        """Handles a script or stdin event."""
+        words = text.split(None, 2)
+        if not words:
+            return
+        name = words[0].lower()
+        if name == "sms" and len(words) == 3:
+            index = max(self.sms, default=0) + 1
+            self.sms[index] = ["REC UNREAD", words[1], self.timestamp(), words[2]]
+            self.urc('+CMTI: "SM",%d' % index)
+        elif name == "ring":
+            self.call = words[1] if len(words) > 1 else "+48100200300"
+            self.ring()
+        elif name == "hangup":
+            if self.call:
+                self.call = None
+                self.urc("NO CARRIER")
+        elif name == "creg" and len(words) > 1:
+            self.creg = int(words[1])
+            if self.creg_urc:
+                self.urc("+CREG: %d" % self.creg)
+        elif name == "csq" and len(words) > 1:
+            self.csq = int(words[1])
+        elif name == "raw" and len(words) > 1:
+            self.urc(text.split(None, 1)[1])
+        elif name == "stats":
+            self.print_stats()
+        elif name == "quit":
+            raise KeyboardInterrupt
+        else:
+            sys.stderr.write("unknown event: %s\n" % text)
+
+    def ring(self):
+        if not self.call:
+            return
+        lines = ["RING"]
+        if self.clip:
+            lines.append('+CLIP: "%s",145,"",,"",0' % self.call)
+        self.urc(*lines)
+        self.at(3.0, self.ring)
+
+    @staticmethod
+    def timestamp():
+        return time.strftime("%y/%m/%d,%H:%M:%S+00")
+
+    # input
+
+    def receive(self, data):
+        self.log("->", data)
+        self.stats["rx"] += len(data)
+        for c in data:
+            if self.data is not None:
+                self.receive_data(c)
+                continue
+            if self.echo:
+                self.out.append(c)
+            if c == ord("\r"):
+                line = self.line.decode("latin-1").strip()
+                self.line.clear()
+                if line:
+                    self.command(line)
+            elif c != ord("\n"):
+                self.line.append(c)
+
+    def receive_data(self, c):
+        """Data after the "> " prompt, ended with Ctrl+Z (ESC cancels)."""
+        callback, buf = self.data
+        if c == CTRL_Z:
+            self.data = None
+            callback(bytes(buf))
+        elif c == ESC:
+            self.data = None
+            self.respond()
+        else:
+            if self.echo:
+                self.out.append(c)
+            buf.append(c)
+
+    def prompt(self, callback):
+        self.data = (callback, bytearray())
+        self.write(b"\r\n> ", self.args.latency / 1000.0)
+
+    def command(self, line):
+        self.stats["commands"] += 1
+        upper = line.upper()
+        if not upper.startswith("AT"):
+            return self.error()
+        if self.random.random() < self.args.error_rate:
+            self.stats["injected"] += 1
+            return self.error()
+        body = line[2:]
+        for name, handler in self.COMMANDS:
+            if body.upper().startswith(name):
+                return handler(self, body[len(name):])
+        if body == "":
+            return self.respond()
+        return self.error()
+
+    def error(self):
+        self.stats["errors"] += 1
+        self.respond(final="ERROR")
+
+    def cms_error(self, code):
+        self.stats["errors"] += 1
+        self.respond(final="+CMS ERROR: %d" % code)
+
+    # commands
+
+    def cmd_echo(self, arg):
+        self.echo = arg.startswith("1")
+        self.respond()
+
+    def cmd_info(self, arg):
+        self.respond("SIM900 R11.0 (emulated)")
+
+    def cmd_ok(self, arg):
+        self.respond()
+
+    def cmd_answer(self, arg):
+        if not self.call:
+            return self.respond(final="NO CARRIER")
+        self.respond()
+
+    def cmd_hangup(self, arg):
+        self.call = None
+        self.respond()
+
+    def cmd_dial(self, arg):
+        if arg.endswith(";"):  # voice call
+            return self.respond()
+        self.respond(final="NO CARRIER")  # data calls aren't emulated
+
+    def cmd_cpin(self, arg):
+        self.respond("+CPIN: READY")
+
+    def cmd_csq(self, arg):
+        self.respond("+CSQ: %d,0" % self.csq)
+
+    def cmd_creg(self, arg):
+        if arg == "?":
+            return self.respond("+CREG: %d,%d" % (self.creg_urc, self.creg))
+        if arg.startswith("="):
+            self.creg_urc = int(arg[1:] or 0)
+        self.respond()
+
+    def cmd_clip(self, arg):
+        if arg == "?":
+            return self.respond("+CLIP: %d,1" % self.clip)
+        self.clip = arg.startswith("=1")
+        self.respond()
+
+    def cmd_cmgf(self, arg):
+        if arg == "?":
+            return self.respond("+CMGF: %d" % self.text_mode)
+        if arg in ("=0", "=1"):
+            self.text_mode = arg == "=1"
+            return self.respond()
+        self.error()
+
+    def cmd_cmgs(self, arg):
+        if not self.text_mode:
+            return self.cms_error(304)  # PDU mode isn't emulated
+        if not arg.startswith("="):
+            return self.error()
+
+        def send(text):
+            self.mr = (self.mr + 1) % 256
+            self.stats["sms_sent"] += 1
+            sys.stderr.write("SMS to %s: %s\n" % (arg[1:].strip('"'), text.decode("latin-1")))
+            self.respond("+CMGS: %d" % self.mr)
+        self.prompt(send)
+
+    def sms_header(self, index, entry, cmgl):
+        stat, number, stamp, _ = entry
+        if cmgl:
+            return '+CMGL: %d,"%s","%s","","%s"' % (index, stat, number, stamp)
+        return '+CMGR: "%s","%s","","%s"' % (stat, number, stamp)
+
+    def cmd_cmgl(self, arg):
+        if not self.text_mode:
+            return self.cms_error(304)
+        wanted = arg[1:].strip('"').upper() if arg.startswith("=") else "REC UNREAD"
+        lines = []
+        for index in sorted(self.sms):
+            entry = self.sms[index]
+            if wanted == "ALL" or entry[0] == wanted:
+                lines += [self.sms_header(index, entry, True), entry[3]]
+                if entry[0] == "REC UNREAD":
+                    entry[0] = "REC READ"
+        self.respond(*lines)
+
+    def cmd_cmgr(self, arg):
+        try:
+            index = int(arg[1:])
+        except ValueError:
+            return self.error()
+        entry = self.sms.get(index)
+        if entry is None:
+            return self.respond()  # empty location
+        lines = [self.sms_header(index, entry, False), entry[3]]
+        if entry[0] == "REC UNREAD":
+            entry[0] = "REC READ"
+        self.respond(*lines)
+
+    def cmd_cmgd(self, arg):
+        try:
+            index = int(arg[1:].split(",")[0])
+        except ValueError:
+            return self.error()
+        self.sms.pop(index, None)
+        self.respond()
+
+    def cmd_cgatt(self, arg):
+        if arg == "?":
+            return self.respond("+CGATT: 1")
+        self.respond()
+
+    def cmd_cipshut(self, arg):
+        self.close_socket()
+        self.ip_state = "IP INITIAL"
+        self.respond(final="SHUT OK")
+
+    def cmd_cstt(self, arg):
+        self.ip_state = "IP START"
+        self.respond()
+
+    def cmd_ciicr(self, arg):
+        if self.ip_state != "IP START":
+            return self.error()
+        self.ip_state = "IP GPRSACT"
+        self.respond()
+
+    def cmd_cifsr(self, arg):
+        if self.ip_state not in ("IP GPRSACT", "IP STATUS", "CONNECT OK", "IP CLOSE"):
+            return self.error()
+        if self.ip_state == "IP GPRSACT":
+            self.ip_state = "IP STATUS"
+        self.respond("10.0.0.2", final=None)
+
+    def cmd_cipstart(self, arg):
+        try:
+            proto, host, port = [p.strip().strip('"') for p in arg[1:].split(",")]
+            kind = socket.SOCK_DGRAM if proto.upper() == "UDP" else socket.SOCK_STREAM
+            self.sock = socket.socket(socket.AF_INET, kind)
+            self.sock.setblocking(False)
+            self.sock.connect_ex((host, int(port)))
+        except (ValueError, OSError):
+            return self.error()
+        self.sock_connecting = True
+        self.ip_state = "IP CONNECTING"
+        self.respond()
+
+    def cmd_cipsend(self, arg):
+        if self.sock is None or self.sock_connecting:
+            return self.error()
+
+        def send(data):
+            try:
+                self.sock.send(data)
+                self.stats["ip_sent"] += len(data)
+                self.respond(final="SEND OK")
+            except OSError:
+                self.respond(final="SEND FAIL")
+        self.prompt(send)
+
+    def cmd_cipclose(self, arg):
+        if self.sock is None:
+            return self.error()
+        self.close_socket()
+        self.ip_state = "IP CLOSE"
+        self.respond(final="CLOSE OK")
+
+    def cmd_cipstatus(self, arg):
+        self.respond("", "STATE: %s" % self.ip_state, final=None)
+
+    def cmd_ciphead(self, arg):
+        self.ip_head = arg.startswith("=1")
+        self.respond()
+
+    # longer names first - prefixes are matched
+    COMMANDS = [
+        ("+CIPSTATUS", cmd_cipstatus), ("+CIPSTART", cmd_cipstart),
+        ("+CIPCLOSE", cmd_cipclose), ("+CIPSHUT", cmd_cipshut),
+        ("+CIPSEND", cmd_cipsend), ("+CIPHEAD", cmd_ciphead),
+        ("+CIICR", cmd_ciicr), ("+CIFSR", cmd_cifsr), ("+CSTT", cmd_cstt),
+        ("+CGATT", cmd_cgatt), ("+CMGF", cmd_cmgf), ("+CMGS", cmd_cmgs),
+        ("+CMGL", cmd_cmgl), ("+CMGR", cmd_cmgr), ("+CMGD", cmd_cmgd),
+        ("+CPIN", cmd_cpin), ("+CREG", cmd_creg), ("+CLIP", cmd_clip),
+        ("+CSQ", cmd_csq), ("&W", cmd_ok), ("E", cmd_echo), ("I", cmd_info),
+        ("A", cmd_answer), ("H", cmd_hangup), ("D", cmd_dial),
+    ]
+
+    # TCP/UDP connection
+
+    def close_socket(self):
+        if self.sock is not None:
+            self.sock.close()
+        self.sock = None
+        self.sock_connecting = False
+
+    def socket_event(self, readable, writable):
+        if self.sock_connecting and writable:
+            self.sock_connecting = False
+            if self.sock.getsockopt(socket.SOL_SOCKET, socket.SO_ERROR):
+                self.close_socket()
+                self.ip_state = "PDP DEACT"
+                self.urc("CONNECT FAIL")
+            else:
+                self.ip_state = "CONNECT OK"
+                self.urc("CONNECT OK")
+        elif readable:
+            try:
+                data = self.sock.recv(1460)
+            except OSError:
+                data = b""
+            if not data:
+                self.close_socket()
+                self.ip_state = "IP CLOSE"
+                self.urc("CLOSED")
+                return
+            self.stats["ip_received"] += len(data)
+            head = ("+IPD,%d:" % len(data)).encode() if self.ip_head else b""
+            self.write(b"\r\n" + head + data, self.args.latency / 1000.0)
+
+    def print_stats(self):
+        elapsed = time.monotonic() - self.start
+        s = self.stats
+        sys.stderr.write(
+            "%.1f s: rx %d B (%.0f B/s), tx %d B (%.0f B/s), commands %d, errors %d, "
+            "injected faults %d, dropped lines %d, SMS sent %d, IP sent %d B, received %d B\n"
+            % (elapsed, s["rx"], s["rx"] / elapsed, s["tx"], s["tx"] / elapsed,
+               s["commands"], s["errors"], s["injected"], s["dropped"],
+               s["sms_sent"], s["ip_sent"], s["ip_received"]))
+
+
+def load_script(modem, path):
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if line and not line.startswith("#"):
+                delay, event = line.split(None, 1)
+                modem.at(float(delay), modem.event, event)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(usage=__doc__)
+    parser.add_argument("device")
+    parser.add_argument("--latency", type=float, default=20)
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--error-rate", type=float, default=0.0)
+    parser.add_argument("--drop-rate", type=float, default=0.0)
+    parser.add_argument("--noise-rate", type=float, default=0.0)
+    parser.add_argument("--script")
+    parser.add_argument("--seed", type=int)
+    parser.add_argument("--verbose", action="store_true")
+    args = parser.parse_args(argv[1:])
+
+    fd = os.open(args.device, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+    if os.isatty(fd):
+        tty.setraw(fd, termios.TCSANOW)  # keep data sent before we started
+
+    modem = Modem(fd, args)
+    if args.script:
+        load_script(modem, args.script)
+
+    stdin = sys.stdin.fileno() if sys.stdin.isatty() else None
+
+    try:
+        while True:
+            wakeups = [t for t in (modem.run_events(), modem.flush()) if t is not None]
+            timeout = max(0.0, min(wakeups) - time.monotonic()) if wakeups else None
+
+            rlist = [fd] + ([stdin] if stdin is not None else [])
+            wlist = []
+            if modem.sock is not None:
+                rlist.append(modem.sock)
+                if modem.sock_connecting:
+                    wlist.append(modem.sock)
+
+            readable, writable, _ = select.select(rlist, wlist, [], timeout)
+
+            if fd in readable:
+                try:
+                    modem.receive(os.read(fd, 4096))
+                except BlockingIOError:
+                    pass
+            if stdin is not None and stdin in readable:
+                line = sys.stdin.readline()
+                if not line:
+                    stdin = None
+                modem.event(line.strip())
+            if modem.sock is not None and (modem.sock in readable or modem.sock in writable):
+                modem.socket_event(modem.sock in readable, modem.sock in writable)
+    except KeyboardInterrupt:
+        pass
+
+    modem.print_stats()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
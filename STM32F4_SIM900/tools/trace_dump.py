@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""
+Prints a trace of UART traffic (trace.h), as saved by
+log_decode.py --trace.
+
+Every record is printed as: time in seconds since the start of the
+trace, time since the previous record, channel and data (printable
+characters as text, others escaped).
+
+Usage:
+  trace_dump.py TRACE [CHANNEL...]   - CHANNEL is one of the channel
+                                       names, e.g. SIM900-RX (default all)
+
+Copyright (c) 2014 Michal Ksiezopolski.
+GNU Public License v3.0 (http://www.gnu.org/licenses/gpl.html)
+"""
+
+import sys
+
+CHANNELS = ["PC-RX", "PC-TX", "SIM900-RX", "SIM900-TX"]
+
+
+def read_records(data):
+    """Yields (time in us, delta in us, channel, data) of every record."""
+    i = 0
+    time = 0
+    while i < len(data):
+        channel = data[i] >> 6
+        length = (data[i] & 0x3f) + 1
+        i += 1
+        delta = 0
+        shift = 0
+        while True:
+            if i >= len(data):
+                raise ValueError("truncated record")
+            delta |= (data[i] & 0x7f) << shift
+            shift += 7
+            i += 1
+            if not data[i - 1] & 0x80:
+                break
+        if i + length > len(data):
+            raise ValueError("truncated record")
+        time += delta
+        yield time, delta, channel, data[i:i + length]
+        i += length
+
+
+def printable(data):
+    """Returns data as text, escaping non-printable characters."""
+    out = []
+    for c in data:
+        if c == 0x0d:
+            out.append("\\r")
+        elif c == 0x0a:
+            out.append("\\n")
+        elif 0x20 <= c < 0x7f and c != 0x5c:
+            out.append(chr(c))
+        else:
+            out.append("\\x%02x" % c)
+    return "".join(out)
+
+
+def main(argv):
+    if len(argv) < 2:
+        print(__doc__)
+        return 1
+    wanted = set(argv[2:])
+    for name in wanted:
+        if name not in CHANNELS:
+            print("Unknown channel %s (%s)" % (name, ", ".join(CHANNELS)))
+            return 1
+    with open(argv[1], "rb") as f:
+        data = f.read()
+    try:
+        for time, delta, channel, block in read_records(data):
+            if wanted and CHANNELS[channel] not in wanted:
+                continue
+            print("%12.6f %+10.6f %-10s %s" % (time / 1e6, delta / 1e6,
+                                               CHANNELS[channel], printable(block)))
+    except ValueError as e:
+        print("Error: %s" % e)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))